@@ -0,0 +1,109 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "csr.h"
+#include "parallel.h"
+
+#define CSR_ROWS_PER_TASK 4096
+
+typedef struct CsrProduct {
+    const CsrMatrix *mat;
+    const double *x;
+    Vector y;
+} CsrProduct;
+
+static void _multiply_rows(void *context, size_t task_idx);
+
+CsrMatrix *build_csr_matrix(size_t n, size_t m, size_t nonzeros_count) {
+    CsrMatrix *mat = (CsrMatrix *) malloc(sizeof(CsrMatrix));
+
+    mat -> n = n;
+    mat -> m = m;
+    mat -> row_starts = (size_t *) calloc(n + 1, sizeof(size_t));
+    /* One extra entry keeps the allocations non-empty for an empty matrix */
+    mat -> columns = (size_t *) malloc((nonzeros_count + 1) * sizeof(size_t));
+    mat -> values = (Vector) malloc((nonzeros_count + 1) * sizeof(double));
+    return mat;
+}
+
+size_t csr_nonzeros_count(const CsrMatrix *mat) {
+    return mat -> row_starts[mat -> n];
+}
+
+Vector csr_row_sums(const CsrMatrix *mat) {
+    size_t i, e;
+    Vector sums = (Vector) calloc(mat -> n, sizeof(double));
+
+    for (i = 0; i < mat -> n; i++) {
+        for (e = mat -> row_starts[i]; e < mat -> row_starts[i + 1]; e++) {
+            sums[i] += mat -> values[e];
+        }
+    }
+    return sums;
+}
+
+Matrix csr_to_dense(const CsrMatrix *mat) {
+    size_t i, e;
+    Matrix dense = build_matrix(mat -> n, mat -> m);
+
+    for (i = 0; i < mat -> n; i++) {
+        for (e = mat -> row_starts[i]; e < mat -> row_starts[i + 1]; e++) {
+            dense[i][mat -> columns[e]] = mat -> values[e];
+        }
+    }
+    return dense;
+}
+
+void csr_multiply_vector(const CsrMatrix *mat, const double *x, Vector y,
+                         size_t threads_count) {
+    CsrProduct product;
+
+    product.mat = mat;
+    product.x = x;
+    product.y = y;
+    parallel_for((mat -> n + CSR_ROWS_PER_TASK - 1) / CSR_ROWS_PER_TASK,
+                 threads_count, _multiply_rows, &product);
+}
+
+void print_csr_matrix(const CsrMatrix *mat) {
+    size_t i, e;
+
+    for (i = 0; i < mat -> n; i++) {
+        for (e = mat -> row_starts[i]; e < mat -> row_starts[i + 1]; e++) {
+            printf("%lu,%lu,%.4f\n", (unsigned long) i,
+                   (unsigned long) mat -> columns[e], mat -> values[e]);
+        }
+    }
+}
+
+void free_csr_matrix(CsrMatrix *mat) {
+    free(mat -> row_starts);
+    free(mat -> columns);
+    free(mat -> values);
+    free(mat);
+}
+
+static void _multiply_rows(void *context, size_t task_idx) {
+    CsrProduct *product = (CsrProduct *) context;
+    const CsrMatrix *mat = product -> mat;
+    const size_t *columns = mat -> columns;
+    const double *values = mat -> values, *x = product -> x;
+    size_t i, e, row_end, start = task_idx * CSR_ROWS_PER_TASK;
+    size_t end = start + CSR_ROWS_PER_TASK;
+    double sum0, sum1, sum2, sum3;
+
+    end = (end < mat -> n) ? end : mat -> n;
+    for (i = start; i < end; i++) {
+        sum0 = sum1 = sum2 = sum3 = 0.0;
+        row_end = mat -> row_starts[i + 1];
+        for (e = mat -> row_starts[i]; e + 4 <= row_end; e += 4) {
+            sum0 += values[e] * x[columns[e]];
+            sum1 += values[e + 1] * x[columns[e + 1]];
+            sum2 += values[e + 2] * x[columns[e + 2]];
+            sum3 += values[e + 3] * x[columns[e + 3]];
+        }
+        for (; e < row_end; e++) {
+            sum0 += values[e] * x[columns[e]];
+        }
+        product -> y[i] = (sum0 + sum1) + (sum2 + sum3);
+    }
+}
@@ -0,0 +1,70 @@
+#ifndef CSR_H
+#define CSR_H
+
+#include "matrix.h"
+#include "vector.h"
+#include <stddef.h>
+
+/**
+ * A sparse n x m matrix in compressed sparse row form. The non-zero entries of
+ * row i are at indices [row_starts[i], row_starts[i + 1]) of columns and
+ * values, sorted by column, so row_starts holds n + 1 indices.
+ */
+typedef struct CsrMatrix {
+    size_t n;
+    size_t m;
+    size_t *row_starts;
+    size_t *columns;
+    Vector values;
+} CsrMatrix;
+
+/**
+ * Receive the order of a sparse matrix and the number of its non-zero entries,
+ * and allocate a CsrMatrix with room for them, where row_starts are zeros and
+ * the columns and values are left for the caller to fill. The function
+ * allocates memory for the matrix, so it's the caller's responsibility to free
+ * it with free_csr_matrix.
+ */
+CsrMatrix *build_csr_matrix(size_t n, size_t m, size_t nonzeros_count);
+
+/**
+ * Receive a sparse matrix and return the number of its non-zero entries.
+ */
+size_t csr_nonzeros_count(const CsrMatrix *mat);
+
+/**
+ * Receive a sparse matrix and return the vector of the sums of its rows. The
+ * function allocates memory for the vector, so it's the caller's
+ * responsibility to free it.
+ */
+Vector csr_row_sums(const CsrMatrix *mat);
+
+/**
+ * Receive a sparse matrix and return it as a dense matrix. The function
+ * allocates memory for the new matrix, so it's the caller's responsibility to
+ * free it.
+ */
+Matrix csr_to_dense(const CsrMatrix *mat);
+
+/**
+ * Receive a sparse n x m matrix, a vector x of length m, a vector y of length
+ * n and a number of threads (0 for default_threads_count()), and set y to the
+ * product of the matrix and x. Blocks of rows are multiplied concurrently, and
+ * every row gathers its entries of x in four independent sums, which the
+ * compiler can keep in vector registers.
+ */
+void csr_multiply_vector(const CsrMatrix *mat, const double *x, Vector y,
+                         size_t threads_count);
+
+/**
+ * Receive a sparse matrix and print its non-zero entries, one per line, as
+ * their row, column and value.
+ */
+void print_csr_matrix(const CsrMatrix *mat);
+
+/**
+ * Receive a sparse matrix and free it.
+ */
+void free_csr_matrix(CsrMatrix *mat);
+
+#endif
@@ -0,0 +1,149 @@
+#include <limits.h>
+#include <math.h>
+#include <stdlib.h>
+#include "grid.h"
+
+/**
+ * Cell coordinates are clamped to this magnitude, so far outliers of a small
+ * cell size don't overflow. Clamped cells only merge cells that are far from
+ * the rest of the points.
+ */
+#define MAX_CELL_COORDINATE (LONG_MAX / 4)
+
+static size_t _hash_cell(const long *cell, size_t dimensions,
+                         size_t buckets_count);
+static bool _same_cell(const long *a, const long *b, size_t dimensions);
+
+GridIndex *build_grid_index(Matrix points, size_t n, size_t m,
+                            double cell_size) {
+    size_t i, j, bucket;
+    size_t *buckets = NULL, *cursors = NULL;
+    double coordinate;
+    GridIndex *grid = (GridIndex *) malloc(sizeof(GridIndex));
+
+    grid -> points = points;
+    grid -> n = n;
+    grid -> m = m;
+    grid -> dimensions = (m < GRID_MAX_DIMENSIONS) ? m : GRID_MAX_DIMENSIONS;
+    grid -> cell_size = cell_size;
+    grid -> squared_distance = vector_kernels(m) -> squared_distance;
+    for (j = 0; j < grid -> dimensions; j++) {
+        grid -> origin[j] = (n > 0) ? points[0][j] : 0.0;
+        for (i = 1; i < n; i++) {
+            grid -> origin[j] = (points[i][j] < grid -> origin[j]) ?
+                                points[i][j] : grid -> origin[j];
+        }
+    }
+
+    grid -> cells = (long *) malloc(
+        (n * grid -> dimensions + 1) * sizeof(long));
+    for (i = 0; i < n; i++) {
+        for (j = 0; j < grid -> dimensions; j++) {
+            coordinate = floor((points[i][j] - grid -> origin[j]) / cell_size);
+            coordinate = (coordinate < MAX_CELL_COORDINATE) ?
+                         coordinate : MAX_CELL_COORDINATE;
+            grid -> cells[i * grid -> dimensions + j] = (long) coordinate;
+        }
+    }
+
+    /* Points are sorted into their buckets, which are at least as many */
+    grid -> buckets_count = 1;
+    while (grid -> buckets_count < n) {
+        grid -> buckets_count *= 2;
+    }
+    grid -> bucket_starts = (size_t *) calloc(grid -> buckets_count + 1,
+                                              sizeof(size_t));
+    buckets = (size_t *) malloc((n + 1) * sizeof(size_t));
+    for (i = 0; i < n; i++) {
+        buckets[i] = _hash_cell(grid -> cells + i * grid -> dimensions,
+                                grid -> dimensions, grid -> buckets_count);
+        ++grid -> bucket_starts[buckets[i] + 1];
+    }
+    for (bucket = 0; bucket < grid -> buckets_count; bucket++) {
+        grid -> bucket_starts[bucket + 1] += grid -> bucket_starts[bucket];
+    }
+    cursors = (size_t *) malloc(grid -> buckets_count * sizeof(size_t));
+    for (bucket = 0; bucket < grid -> buckets_count; bucket++) {
+        cursors[bucket] = grid -> bucket_starts[bucket];
+    }
+    grid -> idxs = (size_t *) malloc((n + 1) * sizeof(size_t));
+    for (i = 0; i < n; i++) {
+        grid -> idxs[cursors[buckets[i]]++] = i;
+    }
+
+    free(cursors);
+    free(buckets);
+    return grid;
+}
+
+size_t grid_radius_neighbors(const GridIndex *grid, size_t idx, double radius,
+                             size_t *neighbors_idxs, Vector squared_distances) {
+    size_t j, e, offset, offsets_count = 1, bucket, neighbor_idx, count = 0;
+    size_t dimensions = grid -> dimensions;
+    long cell[GRID_MAX_DIMENSIONS];
+    const long *own_cell = grid -> cells + idx * dimensions;
+    double distance, squared_radius = radius * radius;
+
+    for (j = 0; j < dimensions; j++) {
+        offsets_count *= 3;
+    }
+
+    /* Every offset is a number in base 3, with a digit per gridded dimension */
+    for (offset = 0; offset < offsets_count; offset++) {
+        e = offset;
+        for (j = 0; j < dimensions; j++) {
+            cell[j] = own_cell[j] + (long) (e % 3) - 1;
+            e /= 3;
+        }
+        bucket = _hash_cell(cell, dimensions, grid -> buckets_count);
+        for (e = grid -> bucket_starts[bucket];
+             e < grid -> bucket_starts[bucket + 1]; e++) {
+            neighbor_idx = grid -> idxs[e];
+            if (neighbor_idx == idx ||
+                !_same_cell(grid -> cells + neighbor_idx * dimensions, cell,
+                            dimensions)) {
+                continue;
+            }
+            distance = grid -> squared_distance(grid -> points[idx],
+                                                grid -> points[neighbor_idx],
+                                                grid -> m);
+            if (distance <= squared_radius) {
+                if (neighbors_idxs != NULL) {
+                    neighbors_idxs[count] = neighbor_idx;
+                    squared_distances[count] = distance;
+                }
+                count++;
+            }
+        }
+    }
+    return count;
+}
+
+void free_grid_index(GridIndex *grid) {
+    free(grid -> cells);
+    free(grid -> bucket_starts);
+    free(grid -> idxs);
+    free(grid);
+}
+
+static size_t _hash_cell(const long *cell, size_t dimensions,
+                         size_t buckets_count) {
+    size_t j, hash = 0;
+
+    for (j = 0; j < dimensions; j++) {
+        hash = (hash ^ (size_t) cell[j]) * 2654435761u;
+        hash ^= hash >> 15;
+    }
+    return hash & (buckets_count - 1);
+}
+
+static bool _same_cell(const long *a, const long *b, size_t dimensions) {
+    size_t j;
+
+    for (j = 0; j < dimensions; j++) {
+        if (a[j] != b[j]) {
+            return false;
+        }
+    }
+    return true;
+}
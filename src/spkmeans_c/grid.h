@@ -0,0 +1,61 @@
+#ifndef GRID_H
+#define GRID_H
+
+#include "matrix.h"
+#include "vector.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+#define GRID_MAX_DIMENSIONS 3
+
+/**
+ * A uniform grid over n points of order m, hashed into buckets. The grid
+ * covers the first dimensions (up to GRID_MAX_DIMENSIONS) coordinates with
+ * cubic cells of side cell_size starting at origin, and cells holds the
+ * dimensions cell coordinates of every point. The points of a cell are in the
+ * same bucket, which has the indices [bucket_starts[b], bucket_starts[b + 1])
+ * of idxs, and may have the points of other cells too. The grid doesn't copy
+ * the points, so they must outlive it.
+ */
+typedef struct GridIndex {
+    Matrix points;
+    size_t n;
+    size_t m;
+    size_t dimensions;
+    double cell_size;
+    double origin[GRID_MAX_DIMENSIONS];
+    long *cells;
+    size_t buckets_count;
+    size_t *bucket_starts;
+    size_t *idxs;
+    SquaredDistanceKernel squared_distance;
+} GridIndex;
+
+/**
+ * Receive n points of order m and a positive cell size, and hash them into a
+ * uniform grid of cells of that size. Points of more than GRID_MAX_DIMENSIONS
+ * coordinates are gridded by their first ones, which still bounds the
+ * distance between points of cells that aren't adjacent. The function
+ * allocates memory for the grid, so it's the caller's responsibility to free
+ * it with free_grid_index.
+ */
+GridIndex *build_grid_index(Matrix points, size_t n, size_t m,
+                            double cell_size);
+
+/**
+ * Receive a grid, the index of one of its points and a radius no larger than
+ * the grid's cell size, and find the other points within the radius of it by
+ * scanning the cells adjacent to its own. If neighbors_idxs and
+ * squared_distances aren't NULL, they are set to the indices of the points
+ * found and their squared distances, in no particular order. Return the
+ * number of points found.
+ */
+size_t grid_radius_neighbors(const GridIndex *grid, size_t idx, double radius,
+                             size_t *neighbors_idxs, Vector squared_distances);
+
+/**
+ * Receive a grid and free it, without freeing its points.
+ */
+void free_grid_index(GridIndex *grid);
+
+#endif
@@ -0,0 +1,714 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "hnsw.h"
+#include "parallel.h"
+
+#define HNSW_POINTS_PER_TASK 256
+
+/**
+ * A max-heap of points keyed by a distance, so the farthest one is at index 0.
+ * A min-heap is kept as a max-heap of the negated distances.
+ */
+typedef struct HnswHeap {
+    size_t *idxs;
+    Vector keys;
+    size_t count;
+    size_t capacity;
+} HnswHeap;
+
+typedef struct HnswCandidate {
+    size_t idx;
+    double distance;
+} HnswCandidate;
+
+/**
+ * The scratch memory of a single thread's searches. A point is visited in the
+ * current search if its visited tag equals visited_tag, so starting a search
+ * doesn't need to clear the tags of all the points.
+ */
+typedef struct HnswSearch {
+    unsigned int *visited;
+    unsigned int visited_tag;
+    HnswHeap candidates;
+    HnswHeap results;
+    HnswCandidate *nearest;
+    size_t nearest_capacity;
+    HnswCandidate *pruned;
+    size_t *selected;
+    size_t *links;
+} HnswSearch;
+
+/**
+ * The searches of the threads running a parallel_for. A task takes a free
+ * search and returns it once it's done, so there are never more searches than
+ * threads.
+ */
+typedef struct HnswSearchPool {
+    const HnswIndex *index;
+    HnswSearch **searches;
+    size_t count;
+    size_t capacity;
+    pthread_mutex_t lock;
+} HnswSearchPool;
+
+typedef struct HnswQueries {
+    HnswSearchPool *pool;
+    size_t neighbors_count;
+    size_t *neighbors_idxs;
+    Vector squared_distances;
+} HnswQueries;
+
+static size_t *_links_of(const HnswIndex *index, size_t idx, size_t layer);
+static size_t _copy_links(const HnswIndex *index, size_t idx, size_t layer,
+                          size_t *links);
+static void _insert_points(void *context, size_t task_idx);
+static void _insert_point(HnswIndex *index, HnswSearch *search, size_t idx);
+static void _link(HnswIndex *index, HnswSearch *search, size_t idx,
+                  size_t neighbor_idx, size_t layer, double distance);
+static size_t _select_neighbors(const HnswIndex *index,
+                                const HnswCandidate *candidates, size_t count,
+                                size_t max_count, size_t *selected);
+static size_t _greedy_closest(const HnswIndex *index, HnswSearch *search,
+                              Vector query, size_t idx, double *distance,
+                              size_t top_layer, size_t bottom_layer);
+static void _start_search(const HnswIndex *index, HnswSearch *search);
+static void _add_entry(HnswSearch *search, size_t idx, double distance);
+static void _search_layer(const HnswIndex *index, HnswSearch *search,
+                          Vector query, size_t layer, size_t ef);
+static size_t _sort_results(HnswSearch *search);
+static size_t _search_nearest(const HnswIndex *index, HnswSearch *search,
+                              Vector query, size_t neighbors_count,
+                              size_t excluded_idx, size_t *neighbors_idxs,
+                              Vector squared_distances);
+static void _query_points(void *context, size_t task_idx);
+static HnswSearch *_build_search(const HnswIndex *index);
+static void _free_search(HnswSearch *search);
+static void _init_search_pool(HnswSearchPool *pool, const HnswIndex *index);
+static HnswSearch *_acquire_search(HnswSearchPool *pool);
+static void _release_search(HnswSearchPool *pool, HnswSearch *search);
+static void _free_search_pool(HnswSearchPool *pool);
+static void _heap_push(HnswHeap *heap, size_t idx, double key);
+static void _heap_pop(HnswHeap *heap);
+static int _compare_candidates(const void *a, const void *b);
+
+void init_hnsw_options(HnswOptions *options) {
+    options -> max_neighbors = HNSW_DEFAULT_MAX_NEIGHBORS;
+    options -> ef_construction = HNSW_DEFAULT_EF_CONSTRUCTION;
+    options -> ef_search = HNSW_DEFAULT_EF_SEARCH;
+    options -> seed = 0;
+    options -> recall_sample_size = HNSW_DEFAULT_RECALL_SAMPLE_SIZE;
+}
+
+HnswIndex *build_hnsw_index(Matrix points, size_t n, size_t dimension,
+                            const HnswOptions *options, size_t threads_count) {
+    size_t i, links_count = 0, max_neighbors = options -> max_neighbors;
+    double level_factor;
+    HnswIndex *index = (HnswIndex *) malloc(sizeof(HnswIndex));
+    HnswSearchPool pool;
+    RandomState rs;
+
+    max_neighbors = (max_neighbors < 2) ? 2 : max_neighbors;
+    index -> points = points;
+    index -> n = n;
+    index -> dimension = dimension;
+    index -> max_neighbors = max_neighbors;
+    index -> ef_construction = options -> ef_construction;
+    index -> ef_search = options -> ef_search;
+    index -> squared_distance = vector_kernels(dimension) -> squared_distance;
+    index -> entry_point = 0;
+    index -> max_level = 0;
+    index -> levels = (size_t *) malloc((n + 1) * sizeof(size_t));
+    index -> links_starts = (size_t *) malloc((n + 1) * sizeof(size_t));
+    index -> locks = (pthread_mutex_t *) malloc(
+        (n + 1) * sizeof(pthread_mutex_t));
+    pthread_mutex_init(&index -> entry_lock, NULL);
+
+    /* The layer of a point is drawn from an exponential distribution */
+    seed_random_state(&rs, options -> seed);
+    level_factor = 1.0 / log((double) max_neighbors);
+    for (i = 0; i < n; i++) {
+        index -> levels[i] = (size_t) floor(
+            -log(1.0 - random_double(&rs)) * level_factor);
+        index -> links_starts[i] = links_count;
+        links_count += 2 * max_neighbors + 1 +
+                       index -> levels[i] * (max_neighbors + 1);
+        pthread_mutex_init(&index -> locks[i], NULL);
+    }
+    index -> links = (size_t *) malloc((links_count + 1) * sizeof(size_t));
+    for (i = 0; i < n; i++) {
+        memset(index -> links + index -> links_starts[i], 0,
+               (2 * max_neighbors + 1 + index -> levels[i] *
+                (max_neighbors + 1)) * sizeof(size_t));
+    }
+    if (n == 0) {
+        return index;
+    }
+
+    /* The first point is the entry point the rest are inserted from */
+    index -> max_level = index -> levels[0];
+    _init_search_pool(&pool, index);
+    parallel_for((n - 1 + HNSW_POINTS_PER_TASK - 1) / HNSW_POINTS_PER_TASK,
+                 threads_count, _insert_points, &pool);
+    _free_search_pool(&pool);
+    return index;
+}
+
+size_t hnsw_nearest(const HnswIndex *index, Vector query,
+                    size_t neighbors_count, size_t excluded_idx,
+                    size_t *neighbors_idxs, Vector squared_distances) {
+    size_t count;
+    HnswSearch *search = NULL;
+
+    if (neighbors_count == 0 || index -> n == 0) {
+        return 0;
+    }
+    search = _build_search(index);
+    count = _search_nearest(index, search, query, neighbors_count,
+                            excluded_idx, neighbors_idxs, squared_distances);
+    _free_search(search);
+    return count;
+}
+
+void hnsw_all_nearest(const HnswIndex *index, size_t neighbors_count,
+                      size_t threads_count, size_t *neighbors_idxs,
+                      Vector squared_distances) {
+    HnswSearchPool pool;
+    HnswQueries queries;
+
+    if (neighbors_count == 0 || index -> n == 0) {
+        return;
+    }
+    _init_search_pool(&pool, index);
+    queries.pool = &pool;
+    queries.neighbors_count = neighbors_count;
+    queries.neighbors_idxs = neighbors_idxs;
+    queries.squared_distances = squared_distances;
+    parallel_for((index -> n + HNSW_POINTS_PER_TASK - 1) / HNSW_POINTS_PER_TASK,
+                 threads_count, _query_points, &queries);
+    _free_search_pool(&pool);
+}
+
+double hnsw_recall(const HnswIndex *index, size_t neighbors_count,
+                   size_t sample_size, RandomState *rs) {
+    size_t i, j, s, query_idx, count, found_count = 0;
+    double distance;
+    size_t *idxs = NULL;
+    Vector distances = NULL;
+    HnswHeap exact;
+    HnswSearch *search = NULL;
+
+    neighbors_count = (neighbors_count < index -> n) ?
+                      neighbors_count : index -> n - 1;
+    if (neighbors_count == 0 || sample_size == 0 || index -> n < 2) {
+        return 1.0;
+    }
+
+    idxs = (size_t *) malloc(neighbors_count * sizeof(size_t));
+    distances = (Vector) malloc(neighbors_count * sizeof(double));
+    exact.idxs = NULL;
+    exact.keys = NULL;
+    exact.count = 0;
+    exact.capacity = 0;
+    search = _build_search(index);
+    for (s = 0; s < sample_size; s++) {
+        query_idx = random_index(rs, index -> n);
+
+        /* The farthest of the exact neighbors bounds the ones found */
+        exact.count = 0;
+        for (j = 0; j < index -> n; j++) {
+            if (j == query_idx) {
+                continue;
+            }
+            distance = index -> squared_distance(
+                index -> points[j], index -> points[query_idx],
+                index -> dimension);
+            if (exact.count < neighbors_count) {
+                _heap_push(&exact, j, distance);
+            } else if (distance < exact.keys[0]) {
+                _heap_pop(&exact);
+                _heap_push(&exact, j, distance);
+            }
+        }
+
+        count = _search_nearest(index, search, index -> points[query_idx],
+                                neighbors_count, query_idx, idxs, distances);
+        for (i = 0; i < count; i++) {
+            found_count += (distances[i] <= exact.keys[0]);
+        }
+    }
+
+    _free_search(search);
+    free(exact.idxs);
+    free(exact.keys);
+    free(idxs);
+    free(distances);
+    return (double) found_count / (double) (neighbors_count * sample_size);
+}
+
+void free_hnsw_index(HnswIndex *index) {
+    size_t i;
+
+    for (i = 0; i < index -> n; i++) {
+        pthread_mutex_destroy(&index -> locks[i]);
+    }
+    pthread_mutex_destroy(&index -> entry_lock);
+    free(index -> locks);
+    free(index -> links);
+    free(index -> links_starts);
+    free(index -> levels);
+    free(index);
+}
+
+/**
+ * Return the links block of a point in a layer: the first slot holds the
+ * number of links, and the links follow it.
+ */
+static size_t *_links_of(const HnswIndex *index, size_t idx, size_t layer) {
+    size_t *links = index -> links + index -> links_starts[idx];
+
+    if (layer == 0) {
+        return links;
+    }
+    return links + 2 * index -> max_neighbors + 1 +
+           (layer - 1) * (index -> max_neighbors + 1);
+}
+
+/**
+ * Copy the links of a point in a layer under its lock, so a concurrent
+ * insertion doesn't change them while they are read. Return their number.
+ */
+static size_t _copy_links(const HnswIndex *index, size_t idx, size_t layer,
+                          size_t *links) {
+    size_t count;
+    const size_t *block = _links_of(index, idx, layer);
+
+    pthread_mutex_lock(&index -> locks[idx]);
+    count = block[0];
+    memcpy(links, block + 1, count * sizeof(size_t));
+    pthread_mutex_unlock(&index -> locks[idx]);
+    return count;
+}
+
+static void _insert_points(void *context, size_t task_idx) {
+    HnswSearchPool *pool = (HnswSearchPool *) context;
+    HnswIndex *index = (HnswIndex *) pool -> index;
+    HnswSearch *search = _acquire_search(pool);
+    size_t i, start = 1 + task_idx * HNSW_POINTS_PER_TASK;
+    size_t end = start + HNSW_POINTS_PER_TASK;
+
+    end = (end < index -> n) ? end : index -> n;
+    for (i = start; i < end; i++) {
+        _insert_point(index, search, i);
+    }
+    _release_search(pool, search);
+}
+
+static void _insert_point(HnswIndex *index, HnswSearch *search, size_t idx) {
+    size_t i, layer, entry_point, max_level, count, selected_count;
+    size_t level = index -> levels[idx];
+    size_t *links = NULL;
+    double distance;
+    Vector query = index -> points[idx];
+
+    pthread_mutex_lock(&index -> entry_lock);
+    entry_point = index -> entry_point;
+    max_level = index -> max_level;
+    pthread_mutex_unlock(&index -> entry_lock);
+
+    distance = index -> squared_distance(query, index -> points[entry_point],
+                                         index -> dimension);
+    if (max_level > level) {
+        entry_point = _greedy_closest(index, search, query, entry_point,
+                                      &distance, max_level, level);
+    }
+
+    _start_search(index, search);
+    search -> visited[idx] = search -> visited_tag;
+    _add_entry(search, entry_point, distance);
+    for (layer = (level < max_level) ? level : max_level; ; layer--) {
+        _search_layer(index, search, query, layer, index -> ef_construction);
+        count = _sort_results(search);
+        selected_count = _select_neighbors(index, search -> nearest, count,
+                                           index -> max_neighbors,
+                                           search -> selected);
+
+        links = _links_of(index, idx, layer);
+        pthread_mutex_lock(&index -> locks[idx]);
+        links[0] = selected_count;
+        memcpy(links + 1, search -> selected, selected_count * sizeof(size_t));
+        pthread_mutex_unlock(&index -> locks[idx]);
+        for (i = 0; i < selected_count; i++) {
+            _link(index, search, search -> selected[i], idx, layer,
+                  index -> squared_distance(
+                      query, index -> points[search -> selected[i]],
+                      index -> dimension));
+        }
+        if (layer == 0) {
+            break;
+        }
+
+        /* The nearest points found are the entry points of the next layer */
+        _start_search(index, search);
+        search -> visited[idx] = search -> visited_tag;
+        for (i = 0; i < count; i++) {
+            _add_entry(search, search -> nearest[i].idx,
+                       search -> nearest[i].distance);
+        }
+    }
+
+    pthread_mutex_lock(&index -> entry_lock);
+    if (level > index -> max_level) {
+        index -> max_level = level;
+        index -> entry_point = idx;
+    }
+    pthread_mutex_unlock(&index -> entry_lock);
+}
+
+/**
+ * Add a link from a point to a new neighbor in a layer. A point with a full
+ * block keeps the neighbors the heuristic selects out of its links and the new
+ * one.
+ */
+static void _link(HnswIndex *index, HnswSearch *search, size_t idx,
+                  size_t neighbor_idx, size_t layer, double distance) {
+    size_t i, count;
+    size_t max_count = (layer == 0) ? 2 * index -> max_neighbors :
+                                      index -> max_neighbors;
+    size_t *links = _links_of(index, idx, layer);
+
+    pthread_mutex_lock(&index -> locks[idx]);
+    count = links[0];
+    if (count < max_count) {
+        links[count + 1] = neighbor_idx;
+        links[0] = count + 1;
+        pthread_mutex_unlock(&index -> locks[idx]);
+        return;
+    }
+
+    for (i = 0; i < count; i++) {
+        search -> pruned[i].idx = links[i + 1];
+        search -> pruned[i].distance = index -> squared_distance(
+            index -> points[idx], index -> points[links[i + 1]],
+            index -> dimension);
+    }
+    search -> pruned[count].idx = neighbor_idx;
+    search -> pruned[count].distance = distance;
+    qsort(search -> pruned, count + 1, sizeof(HnswCandidate),
+          _compare_candidates);
+    links[0] = _select_neighbors(index, search -> pruned, count + 1, max_count,
+                                 links + 1);
+    pthread_mutex_unlock(&index -> locks[idx]);
+}
+
+/**
+ * Select up to max_count neighbors of a point out of candidates sorted by
+ * their distance from it. A candidate is selected only if it's nearer to the
+ * point than to every neighbor selected before it, so the links spread in
+ * different directions instead of crowding into one cluster.
+ */
+static size_t _select_neighbors(const HnswIndex *index,
+                                const HnswCandidate *candidates, size_t count,
+                                size_t max_count, size_t *selected) {
+    size_t i, j, selected_count = 0;
+    bool diverse;
+
+    for (i = 0; i < count && selected_count < max_count; i++) {
+        diverse = true;
+        for (j = 0; j < selected_count && diverse; j++) {
+            diverse = index -> squared_distance(
+                index -> points[candidates[i].idx],
+                index -> points[selected[j]],
+                index -> dimension) >= candidates[i].distance;
+        }
+        if (diverse) {
+            selected[selected_count++] = candidates[i].idx;
+        }
+    }
+    return selected_count;
+}
+
+/**
+ * Walk from a point to the nearest point to the query in every layer from
+ * top_layer down to the one above bottom_layer, and return the last one.
+ */
+static size_t _greedy_closest(const HnswIndex *index, HnswSearch *search,
+                              Vector query, size_t idx, double *distance,
+                              size_t top_layer, size_t bottom_layer) {
+    size_t i, layer, count;
+    double neighbor_distance;
+    bool moved;
+
+    for (layer = top_layer; layer > bottom_layer; layer--) {
+        do {
+            moved = false;
+            count = _copy_links(index, idx, layer, search -> links);
+            for (i = 0; i < count; i++) {
+                neighbor_distance = index -> squared_distance(
+                    query, index -> points[search -> links[i]],
+                    index -> dimension);
+                if (neighbor_distance < *distance) {
+                    *distance = neighbor_distance;
+                    idx = search -> links[i];
+                    moved = true;
+                }
+            }
+        } while (moved);
+    }
+    return idx;
+}
+
+static void _start_search(const HnswIndex *index, HnswSearch *search) {
+    if (++search -> visited_tag == 0) {
+        memset(search -> visited, 0, index -> n * sizeof(unsigned int));
+        search -> visited_tag = 1;
+    }
+    search -> results.count = 0;
+}
+
+static void _add_entry(HnswSearch *search, size_t idx, double distance) {
+    search -> visited[idx] = search -> visited_tag;
+    _heap_push(&search -> results, idx, distance);
+}
+
+/**
+ * Search a layer from the entry points in the results heap, and keep the ef
+ * nearest points found in it. The nearest candidate is expanded next, until
+ * it's farther than every kept point.
+ */
+static void _search_layer(const HnswIndex *index, HnswSearch *search,
+                          Vector query, size_t layer, size_t ef) {
+    size_t i, idx, neighbor_idx, count;
+    double distance;
+    HnswHeap *candidates = &search -> candidates;
+    HnswHeap *results = &search -> results;
+
+    candidates -> count = 0;
+    for (i = 0; i < results -> count; i++) {
+        _heap_push(candidates, results -> idxs[i], -results -> keys[i]);
+    }
+    while (results -> count > ef) {
+        _heap_pop(results);
+    }
+
+    while (candidates -> count > 0) {
+        idx = candidates -> idxs[0];
+        if (-candidates -> keys[0] > results -> keys[0] &&
+            results -> count >= ef) {
+            break;
+        }
+        _heap_pop(candidates);
+
+        count = _copy_links(index, idx, layer, search -> links);
+        for (i = 0; i < count; i++) {
+            neighbor_idx = search -> links[i];
+            if (search -> visited[neighbor_idx] == search -> visited_tag) {
+                continue;
+            }
+            search -> visited[neighbor_idx] = search -> visited_tag;
+            distance = index -> squared_distance(
+                query, index -> points[neighbor_idx], index -> dimension);
+            if (results -> count < ef || distance < results -> keys[0]) {
+                _heap_push(candidates, neighbor_idx, -distance);
+                _heap_push(results, neighbor_idx, distance);
+                if (results -> count > ef) {
+                    _heap_pop(results);
+                }
+            }
+        }
+    }
+}
+
+/**
+ * Empty the results heap into the nearest array, from the nearest point to the
+ * farthest, and return their number.
+ */
+static size_t _sort_results(HnswSearch *search) {
+    size_t i, count = search -> results.count;
+
+    if (count > search -> nearest_capacity) {
+        search -> nearest_capacity = count;
+        search -> nearest = (HnswCandidate *) realloc(
+            search -> nearest, count * sizeof(HnswCandidate));
+    }
+    for (i = count; i > 0; i--) {
+        search -> nearest[i - 1].idx = search -> results.idxs[0];
+        search -> nearest[i - 1].distance = search -> results.keys[0];
+        _heap_pop(&search -> results);
+    }
+    return count;
+}
+
+static size_t _search_nearest(const HnswIndex *index, HnswSearch *search,
+                              Vector query, size_t neighbors_count,
+                              size_t excluded_idx, size_t *neighbors_idxs,
+                              Vector squared_distances) {
+    size_t i, entry_point, count, found_count = 0;
+    size_t ef = (neighbors_count + 1 > index -> ef_search) ?
+                neighbors_count + 1 : index -> ef_search;
+    double distance;
+
+    entry_point = index -> entry_point;
+    distance = index -> squared_distance(query, index -> points[entry_point],
+                                         index -> dimension);
+    entry_point = _greedy_closest(index, search, query, entry_point, &distance,
+                                  index -> max_level, 0);
+
+    _start_search(index, search);
+    _add_entry(search, entry_point, distance);
+    _search_layer(index, search, query, 0, ef);
+    count = _sort_results(search);
+    for (i = 0; i < count && found_count < neighbors_count; i++) {
+        if (search -> nearest[i].idx != excluded_idx) {
+            neighbors_idxs[found_count] = search -> nearest[i].idx;
+            squared_distances[found_count++] = search -> nearest[i].distance;
+        }
+    }
+    return found_count;
+}
+
+static void _query_points(void *context, size_t task_idx) {
+    HnswQueries *queries = (HnswQueries *) context;
+    const HnswIndex *index = queries -> pool -> index;
+    HnswSearch *search = _acquire_search(queries -> pool);
+    size_t i, e, count, k = queries -> neighbors_count;
+    size_t start = task_idx * HNSW_POINTS_PER_TASK;
+    size_t end = start + HNSW_POINTS_PER_TASK;
+
+    end = (end < index -> n) ? end : index -> n;
+    for (i = start; i < end; i++) {
+        count = _search_nearest(index, search, index -> points[i], k, i,
+                                queries -> neighbors_idxs + i * k,
+                                queries -> squared_distances + i * k);
+        for (e = count; e < k; e++) {
+            queries -> neighbors_idxs[i * k + e] = i;
+            queries -> squared_distances[i * k + e] = 0.0;
+        }
+    }
+    _release_search(queries -> pool, search);
+}
+
+static HnswSearch *_build_search(const HnswIndex *index) {
+    size_t max_links = 2 * index -> max_neighbors + 1;
+    HnswSearch *search = (HnswSearch *) malloc(sizeof(HnswSearch));
+
+    search -> visited = (unsigned int *) calloc(index -> n + 1,
+                                                sizeof(unsigned int));
+    search -> visited_tag = 0;
+    search -> candidates.idxs = NULL;
+    search -> candidates.keys = NULL;
+    search -> candidates.count = 0;
+    search -> candidates.capacity = 0;
+    search -> results = search -> candidates;
+    search -> nearest = NULL;
+    search -> nearest_capacity = 0;
+    search -> pruned = (HnswCandidate *) malloc(
+        max_links * sizeof(HnswCandidate));
+    search -> selected = (size_t *) malloc(max_links * sizeof(size_t));
+    search -> links = (size_t *) malloc(max_links * sizeof(size_t));
+    return search;
+}
+
+static void _free_search(HnswSearch *search) {
+    free(search -> visited);
+    free(search -> candidates.idxs);
+    free(search -> candidates.keys);
+    free(search -> results.idxs);
+    free(search -> results.keys);
+    free(search -> nearest);
+    free(search -> pruned);
+    free(search -> selected);
+    free(search -> links);
+    free(search);
+}
+
+static void _init_search_pool(HnswSearchPool *pool, const HnswIndex *index) {
+    pool -> index = index;
+    pool -> searches = NULL;
+    pool -> count = 0;
+    pool -> capacity = 0;
+    pthread_mutex_init(&pool -> lock, NULL);
+}
+
+static HnswSearch *_acquire_search(HnswSearchPool *pool) {
+    HnswSearch *search = NULL;
+
+    pthread_mutex_lock(&pool -> lock);
+    if (pool -> count > 0) {
+        search = pool -> searches[--pool -> count];
+    }
+    pthread_mutex_unlock(&pool -> lock);
+    return (search != NULL) ? search : _build_search(pool -> index);
+}
+
+static void _release_search(HnswSearchPool *pool, HnswSearch *search) {
+    pthread_mutex_lock(&pool -> lock);
+    if (pool -> count == pool -> capacity) {
+        pool -> capacity = 2 * pool -> capacity + 1;
+        pool -> searches = (HnswSearch **) realloc(
+            pool -> searches, pool -> capacity * sizeof(HnswSearch *));
+    }
+    pool -> searches[pool -> count++] = search;
+    pthread_mutex_unlock(&pool -> lock);
+}
+
+static void _free_search_pool(HnswSearchPool *pool) {
+    size_t i;
+
+    for (i = 0; i < pool -> count; i++) {
+        _free_search(pool -> searches[i]);
+    }
+    free(pool -> searches);
+    pthread_mutex_destroy(&pool -> lock);
+}
+
+static void _heap_push(HnswHeap *heap, size_t idx, double key) {
+    size_t i, parent;
+
+    if (heap -> count == heap -> capacity) {
+        heap -> capacity = 2 * heap -> capacity + 16;
+        heap -> idxs = (size_t *) realloc(
+            heap -> idxs, heap -> capacity * sizeof(size_t));
+        heap -> keys = (Vector) realloc(
+            heap -> keys, heap -> capacity * sizeof(double));
+    }
+
+    i = heap -> count++;
+    while (i > 0 && heap -> keys[(parent = (i - 1) / 2)] < key) {
+        heap -> idxs[i] = heap -> idxs[parent];
+        heap -> keys[i] = heap -> keys[parent];
+        i = parent;
+    }
+    heap -> idxs[i] = idx;
+    heap -> keys[i] = key;
+}
+
+static void _heap_pop(HnswHeap *heap) {
+    size_t i = 0, child, count = --heap -> count;
+    size_t idx = heap -> idxs[count];
+    double key = heap -> keys[count];
+
+    while ((child = 2 * i + 1) < count) {
+        if (child + 1 < count && heap -> keys[child + 1] > heap -> keys[child]) {
+            child++;
+        }
+        if (heap -> keys[child] <= key) {
+            break;
+        }
+        heap -> idxs[i] = heap -> idxs[child];
+        heap -> keys[i] = heap -> keys[child];
+        i = child;
+    }
+    heap -> idxs[i] = idx;
+    heap -> keys[i] = key;
+}
+
+static int _compare_candidates(const void *a, const void *b) {
+    double x = ((const HnswCandidate *) a) -> distance;
+    double y = ((const HnswCandidate *) b) -> distance;
+    return (x > y) - (y > x);
+}
@@ -0,0 +1,111 @@
+#ifndef HNSW_H
+#define HNSW_H
+
+#include "matrix.h"
+#include "rng.h"
+#include "vector.h"
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define HNSW_DEFAULT_MAX_NEIGHBORS 16
+#define HNSW_DEFAULT_EF_CONSTRUCTION 200
+#define HNSW_DEFAULT_EF_SEARCH 50
+#define HNSW_DEFAULT_RECALL_SAMPLE_SIZE 100
+#define HNSW_NO_EXCLUSION ((size_t) -1)
+
+/**
+ * The options of a HNSW index: the maximal number of neighbors of a point in
+ * every layer above the base one (M, where the base layer allows 2M), the
+ * number of candidates searched when inserting a point (efConstruction) and
+ * when querying (efSearch), the seed of the random layers of the points, and
+ * the number of points to measure the recall on when asked for it.
+ */
+typedef struct HnswOptions {
+    size_t max_neighbors;
+    size_t ef_construction;
+    size_t ef_search;
+    uint32_t seed;
+    size_t recall_sample_size;
+} HnswOptions;
+
+/**
+ * A hierarchical navigable small world index over n points of the given
+ * dimension, for approximate nearest neighbors queries. The index doesn't copy
+ * the points, so they must outlive it. Point i is in layers 0 to levels[i],
+ * and its links in every layer are a block of the links pool starting at
+ * links_starts[i]: the base layer's block has room for 2M links and every
+ * other layer's block for M links, and the first slot of a block holds the
+ * number of links in it. Every point has a lock guarding its links while the
+ * index is built concurrently.
+ */
+typedef struct HnswIndex {
+    Matrix points;
+    size_t n;
+    size_t dimension;
+    size_t max_neighbors;
+    size_t ef_construction;
+    size_t ef_search;
+    size_t *levels;
+    size_t *links_starts;
+    size_t *links;
+    pthread_mutex_t *locks;
+    pthread_mutex_t entry_lock;
+    size_t entry_point;
+    size_t max_level;
+    SquaredDistanceKernel squared_distance;
+} HnswIndex;
+
+/**
+ * Receive HNSW options and set them to the defaults.
+ */
+void init_hnsw_options(HnswOptions *options);
+
+/**
+ * Receive n points of the given dimension, HNSW options and a number of
+ * threads (0 for default_threads_count()), and build a HNSW index over the
+ * points. The first point is inserted alone, and the rest are inserted
+ * concurrently, so the links of the index depend on the number of threads.
+ * The function allocates memory for the index, so it's the caller's
+ * responsibility to free it with free_hnsw_index.
+ */
+HnswIndex *build_hnsw_index(Matrix points, size_t n, size_t dimension,
+                            const HnswOptions *options, size_t threads_count);
+
+/**
+ * Receive a HNSW index, a query point, the number of neighbors to find and the
+ * index of a point to leave out (or HNSW_NO_EXCLUSION), and set
+ * neighbors_idxs and squared_distances to the indices of the approximately
+ * nearest points of the index and their squared distances from the query,
+ * from the nearest to the farthest. Return the number of neighbors found.
+ */
+size_t hnsw_nearest(const HnswIndex *index, Vector query,
+                    size_t neighbors_count, size_t excluded_idx,
+                    size_t *neighbors_idxs, Vector squared_distances);
+
+/**
+ * Receive a HNSW index, a number of neighbors and a number of threads, and
+ * find the approximately nearest neighbors_count neighbors of every point of
+ * the index other than itself, concurrently. Point i's neighbors and their
+ * squared distances are set to slot i of neighbors_idxs and squared_distances,
+ * and slots of neighbors that weren't found are set to i itself.
+ */
+void hnsw_all_nearest(const HnswIndex *index, size_t neighbors_count,
+                      size_t threads_count, size_t *neighbors_idxs,
+                      Vector squared_distances);
+
+/**
+ * Receive a HNSW index, a number of neighbors, a sample size and a random
+ * state, and return the recall of the index's queries: the fraction of the
+ * exact nearest neighbors_count neighbors (found by brute force) of
+ * sample_size randomly chosen points that hnsw_nearest finds.
+ */
+double hnsw_recall(const HnswIndex *index, size_t neighbors_count,
+                   size_t sample_size, RandomState *rs);
+
+/**
+ * Receive a HNSW index and free it, without freeing its points.
+ */
+void free_hnsw_index(HnswIndex *index);
+
+#endif
@@ -4,6 +4,9 @@
 
 #define MAX_ROTATIONS 100
 #define EPSILON 0.00001
+#define JACOBI_LANES 8
+#define MAX_SWEEPS 50
+#define SWEEPS_TOLERANCE 1e-24
 #define SIGN(x) (((x) < 0) ? (-1) : (1))
 #define _is_negative_zero(x) ((x == 0.0 && signbit(x) != 0) || \
                               (x > -0.0001 && x < 0.0))
@@ -11,9 +14,32 @@
 #include <math.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include "jacobi.h"
+#include "parallel.h"
+
+/*
+ * The matrices of a group are interleaved: entry (i, j) of lane l of a group
+ * of width matrices of order n is at index _lane_idx(n, width, i, j, l). Only
+ * the last group may be narrower than JACOBI_LANES, so a batch of a single
+ * matrix, like the projected matrices of lanczos, is solved in place without
+ * padding every entry to a whole group.
+ */
+#define _lane_idx(n, width, i, j, l) ((((i) * (n)) + (j)) * (width) + (l))
+
+typedef struct JacobiBatchContext {
+    const double *matrices;
+    size_t batch_size;
+    size_t n;
+    JacobiBatchResult *result;
+} JacobiBatchContext;
 
 static void _unsign_zero_in_jacobi_result(JacobiResult *jr, size_t n);
+static void _unsign_zero_in_eigenpairs(Vector eigenvalues, Vector eigenvectors,
+                                       size_t n);
+static void _jacobi_group(void *context, size_t group_idx);
+static void _rotate_lanes(Vector a, Vector v, size_t n, size_t width,
+                          size_t p, size_t q, const bool *active);
 
 JacobiResult *jacobi(Matrix sym_mat, size_t n) {
     size_t iter;
@@ -53,7 +79,6 @@ JacobiResult *jacobi(Matrix sym_mat, size_t n) {
         v = v_new;
     }
 
-    res = (JacobiResult *) malloc(sizeof(JacobiResult));
     res -> eigenvectors = transpose(v, n, n);
     res -> eigenvalues = matrix_diagonal_values(a, n);
 
@@ -66,6 +91,35 @@ JacobiResult *jacobi(Matrix sym_mat, size_t n) {
     return res;
 }
 
+JacobiBatchResult *jacobi_batched(const double *matrices, size_t batch_size,
+                                  size_t n, size_t threads_count) {
+    JacobiBatchContext context;
+    JacobiBatchResult *res = (JacobiBatchResult *) malloc(sizeof(JacobiBatchResult));
+
+    res -> batch_size = batch_size;
+    res -> n = n;
+    res -> eigenvalues = (Vector) calloc(batch_size * n + 1, sizeof(double));
+    res -> eigenvectors = (Vector) calloc(batch_size * n * n + 1, sizeof(double));
+    res -> converged = (bool *) calloc(batch_size + 1, sizeof(bool));
+    res -> sweeps = (size_t *) calloc(batch_size + 1, sizeof(size_t));
+
+    context.matrices = matrices;
+    context.batch_size = batch_size;
+    context.n = n;
+    context.result = res;
+    parallel_for((batch_size + JACOBI_LANES - 1) / JACOBI_LANES, threads_count,
+                 _jacobi_group, &context);
+    return res;
+}
+
+void free_jacobi_batch_result(JacobiBatchResult *result) {
+    free(result -> eigenvalues);
+    free(result -> eigenvectors);
+    free(result -> converged);
+    free(result -> sweeps);
+    free(result);
+}
+
 Coordinate *get_pivot_coord(Matrix mat, size_t n) {
     size_t i, j;
     Coordinate *res = (Coordinate *) malloc(sizeof(Coordinate));
@@ -156,13 +210,161 @@ double off_diagonal_square(Matrix mat, size_t n) {
 }
 
 static void _unsign_zero_in_jacobi_result(JacobiResult *jr, size_t n) {
+    _unsign_zero_in_eigenpairs(jr -> eigenvalues,
+                               matrix_values(jr -> eigenvectors, n), n);
+}
+
+static void _unsign_zero_in_eigenpairs(Vector eigenvalues, Vector eigenvectors,
+                                       size_t n) {
     size_t i, j;
     for (i = 0; i < n; i++) {
-        if (_is_negative_zero(jr -> eigenvalues[i])) {
-            jr -> eigenvalues[i] = 0.0;
+        if (_is_negative_zero(eigenvalues[i])) {
+            eigenvalues[i] = 0.0;
+            for (j = 0; j < n; j++) {
+               eigenvectors[i * n + j] = -(eigenvectors[i * n + j]);
+            }
+        }
+    }
+}
+
+static void _jacobi_group(void *context, size_t group_idx) {
+    size_t i, j, l, p, q, sweep, active_count;
+    size_t first = group_idx * JACOBI_LANES;
+    bool active[JACOBI_LANES];
+    double off[JACOBI_LANES], norm[JACOBI_LANES];
+    JacobiBatchContext *batch = (JacobiBatchContext *) context;
+    JacobiBatchResult *res = batch -> result;
+    size_t n = batch -> n;
+    size_t lanes = batch -> batch_size - first;
+    Vector a = NULL, v = NULL;
+
+    if (lanes > JACOBI_LANES) {
+        lanes = JACOBI_LANES;
+    }
+    a = (Vector) calloc(n * n * lanes, sizeof(double));
+    v = (Vector) calloc(n * n * lanes, sizeof(double));
+
+    for (l = 0; l < lanes; l++) {
+        norm[l] = 0.0;
+        for (i = 0; i < n; i++) {
+            v[_lane_idx(n, lanes, i, i, l)] = 1.0;
+        }
+    }
+    for (l = 0; l < lanes; l++) {
+        for (i = 0; i < n; i++) {
             for (j = 0; j < n; j++) {
-               jr -> eigenvectors[i][j] = -(jr -> eigenvectors[i][j]);
+                a[_lane_idx(n, lanes, i, j, l)] = batch -> matrices[((first + l) * n + i) * n + j];
+                norm[l] += a[_lane_idx(n, lanes, i, j, l)] * a[_lane_idx(n, lanes, i, j, l)];
+            }
+        }
+    }
+
+    for (sweep = 0; sweep <= MAX_SWEEPS; sweep++) {
+        for (l = 0; l < lanes; l++) {
+            off[l] = 0.0;
+        }
+        for (i = 0; i < n; i++) {
+            for (j = i + 1; j < n; j++) {
+                for (l = 0; l < lanes; l++) {
+                    off[l] += 2 * a[_lane_idx(n, lanes, i, j, l)] * a[_lane_idx(n, lanes, i, j, l)];
+                }
+            }
+        }
+
+        active_count = 0;
+        for (l = 0; l < lanes; l++) {
+            active[l] = off[l] > SWEEPS_TOLERANCE * norm[l];
+            if (active[l]) {
+                active_count++;
+            } else if (!res -> converged[first + l]) {
+                res -> converged[first + l] = true;
+                res -> sweeps[first + l] = sweep;
             }
         }
+        if (active_count == 0 || sweep == MAX_SWEEPS) {
+            break;
+        }
+
+        for (p = 0; p < n; p++) {
+            for (q = p + 1; q < n; q++) {
+                _rotate_lanes(a, v, n, lanes, p, q, active);
+            }
+        }
+    }
+
+    for (l = 0; l < lanes; l++) {
+        Vector eigenvalues = res -> eigenvalues + (first + l) * n;
+        Vector eigenvectors = res -> eigenvectors + (first + l) * n * n;
+
+        if (!res -> converged[first + l]) {
+            res -> sweeps[first + l] = MAX_SWEEPS;
+        }
+        for (i = 0; i < n; i++) {
+            eigenvalues[i] = a[_lane_idx(n, lanes, i, i, l)];
+            for (j = 0; j < n; j++) {
+                /* The eigenvectors are the columns of v, so they're transposed */
+                eigenvectors[i * n + j] = v[_lane_idx(n, lanes, j, i, l)];
+            }
+        }
+        _unsign_zero_in_eigenpairs(eigenvalues, eigenvectors, n);
+    }
+
+    free(a);
+    free(v);
+}
+
+static void _rotate_lanes(Vector a, Vector v, size_t n, size_t width,
+                          size_t p, size_t q, const bool *active) {
+    size_t r, l;
+    double c[JACOBI_LANES], s[JACOBI_LANES];
+    double app[JACOBI_LANES], aqq[JACOBI_LANES], apq[JACOBI_LANES];
+
+    /* The same parameters as get_jacobi_parameters, where lanes that don't
+     * rotate get the identity rotation instead of branching */
+    for (l = 0; l < width; l++) {
+        bool rotate = active[l] && a[_lane_idx(n, width, p, q, l)] != 0.0;
+        double pivot = rotate ? a[_lane_idx(n, width, p, q, l)] : 1.0;
+        double theta = (a[_lane_idx(n, width, q, q, l)] - a[_lane_idx(n, width, p, p, l)]) / (2 * pivot);
+        double t = SIGN(theta) / (fabs(theta) + sqrt(theta * theta + 1.0));
+
+        c[l] = rotate ? 1.0 / sqrt(t * t + 1.0) : 1.0;
+        s[l] = rotate ? t * c[l] : 0.0;
+        app[l] = a[_lane_idx(n, width, p, p, l)];
+        aqq[l] = a[_lane_idx(n, width, q, q, l)];
+        apq[l] = rotate ? a[_lane_idx(n, width, p, q, l)] : 0.0;
+    }
+
+    /* The same updates as jacobi_transform_matrix and
+     * jacobi_calc_eigenvectors_iteration, in place */
+    for (r = 0; r < n; r++) {
+        if (r != p && r != q) {
+            for (l = 0; l < width; l++) {
+                double arp = a[_lane_idx(n, width, r, p, l)];
+                double arq = a[_lane_idx(n, width, r, q, l)];
+
+                a[_lane_idx(n, width, r, p, l)] = c[l] * arp - s[l] * arq;
+                a[_lane_idx(n, width, p, r, l)] = a[_lane_idx(n, width, r, p, l)];
+                a[_lane_idx(n, width, r, q, l)] = c[l] * arq + s[l] * arp;
+                a[_lane_idx(n, width, q, r, l)] = a[_lane_idx(n, width, r, q, l)];
+            }
+        }
+        for (l = 0; l < width; l++) {
+            double vrp = v[_lane_idx(n, width, r, p, l)];
+            double vrq = v[_lane_idx(n, width, r, q, l)];
+
+            v[_lane_idx(n, width, r, p, l)] = c[l] * vrp - s[l] * vrq;
+            v[_lane_idx(n, width, r, q, l)] = c[l] * vrq + s[l] * vrp;
+        }
+    }
+
+    for (l = 0; l < width; l++) {
+        double cc = c[l] * c[l], ss = s[l] * s[l], sc = 2 * s[l] * c[l];
+
+        a[_lane_idx(n, width, p, p, l)] = cc * app[l] + ss * aqq[l] - sc * apq[l];
+        a[_lane_idx(n, width, q, q, l)] = ss * app[l] + cc * aqq[l] + sc * apq[l];
+        if (apq[l] != 0.0) {
+            a[_lane_idx(n, width, p, q, l)] = 0.0;
+            a[_lane_idx(n, width, q, p, l)] = 0.0;
+        }
     }
 }
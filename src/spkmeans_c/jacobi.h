@@ -2,6 +2,7 @@
 #define JACOBI_H
 
 #include "matrix.h"
+#include <stdbool.h>
 #include <stddef.h>
 
 typedef struct JacobiParameters {
@@ -16,6 +17,24 @@ typedef struct JacobiResult {
     Matrix eigenvectors;
 } JacobiResult;
 
+/**
+ * The result of jacobi_batched for batch_size symmetric matrices of order n.
+ * eigenvalues holds the n eigenvalues of every matrix, one matrix after the
+ * other, and eigenvectors holds the n x n eigenvectors of every matrix, laid
+ * out like the values of JacobiResult's eigenvectors, meaning row i of a
+ * matrix is the eigenvector of its eigenvalue i. converged tells for every
+ * matrix whether its off diagonal square became negligible before the sweeps
+ * limit, and sweeps holds the number of sweeps each matrix took.
+ */
+typedef struct JacobiBatchResult {
+    size_t batch_size;
+    size_t n;
+    Vector eigenvalues;
+    Vector eigenvectors;
+    bool *converged;
+    size_t *sweeps;
+} JacobiBatchResult;
+
 /**
  * Receive a symmetric matrix and run the Jacobi algorithm to return the
  * eigenvectors and eigenvalues of the matrix. The function allocates memory for
@@ -30,6 +49,27 @@ typedef struct JacobiResult {
  */
 JacobiResult *jacobi(Matrix sym_mat, size_t n);
 
+/**
+ * Receive batch_size symmetric matrices of order n, stored one after the other
+ * in row major order, and return the eigenvalues and eigenvectors of each,
+ * using threads_count threads (0 for default_threads_count()). Instead of
+ * running jacobi on every matrix, the matrices are processed in groups of
+ * JACOBI_LANES, interleaved so that entry (i, j) of all matrices in a group is
+ * contiguous, and the cyclic Jacobi method applies the rotations of every
+ * (i, j) pair to all matrices of the group at once, in loops the compiler can
+ * vectorize. A matrix that converged keeps going through the group's loops with
+ * an identity rotation, until all matrices of its group converged. The
+ * function allocates memory for the JacobiBatchResult instance, so it's the
+ * caller's responsibility to free it with free_jacobi_batch_result.
+ */
+JacobiBatchResult *jacobi_batched(const double *matrices, size_t batch_size,
+                                  size_t n, size_t threads_count);
+
+/**
+ * Receive a result of jacobi_batched and free it.
+ */
+void free_jacobi_batch_result(JacobiBatchResult *result);
+
 /**
  * Receive a symmetric matrix, and return the pivot coordinate for it, which is
  * the off-diagonal values with the largest absolute value.
@@ -0,0 +1,265 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <math.h>
+#include <stdlib.h>
+#include "kdtree.h"
+
+/**
+ * The state of a single nearest neighbors query. The found neighbors are kept
+ * as a max-heap by their squared distances, so the farthest one is at index 0.
+ */
+typedef struct KdSearch {
+    const KdTree *tree;
+    Vector query;
+    size_t excluded_idx;
+    size_t capacity;
+    size_t count;
+    size_t *idxs;
+    Vector squared_distances;
+} KdSearch;
+
+static size_t _build_node(KdTree *tree, size_t start, size_t end);
+static size_t _widest_dimension(const KdTree *tree, size_t start, size_t end);
+static void _select(KdTree *tree, size_t start, size_t end, size_t nth,
+                    size_t dimension);
+static void _search_node(KdSearch *search, size_t node_idx);
+static void _push_neighbor(KdSearch *search, size_t idx, double distance);
+static void _sift_down(size_t *idxs, Vector distances, size_t count, size_t i);
+
+KdTree *build_kd_tree(Matrix points, size_t n, size_t m) {
+    size_t i;
+    KdTree *tree = (KdTree *) malloc(sizeof(KdTree));
+
+    tree -> points = points;
+    tree -> n = n;
+    tree -> m = m;
+    tree -> squared_distance = vector_kernels(m) -> squared_distance;
+    tree -> idxs = (size_t *) malloc((n + 1) * sizeof(size_t));
+    for (i = 0; i < n; i++) {
+        tree -> idxs[i] = i;
+    }
+
+    /*
+     * Inner nodes are split at the median, so every leaf has more than
+     * KD_TREE_LEAF_SIZE / 2 points (unless the tree is smaller), which bounds
+     * the number of nodes.
+     */
+    tree -> nodes = (KdNode *) malloc(
+        2 * (n / (KD_TREE_LEAF_SIZE / 2) + 1) * sizeof(KdNode));
+    tree -> nodes_count = 0;
+    _build_node(tree, 0, n);
+    return tree;
+}
+
+size_t kd_tree_nearest(const KdTree *tree, Vector query, size_t neighbors_count,
+                       size_t excluded_idx, size_t *neighbors_idxs,
+                       Vector squared_distances) {
+    size_t i, count, swap_idx;
+    double swap_distance;
+    KdSearch search;
+
+    search.tree = tree;
+    search.query = query;
+    search.excluded_idx = excluded_idx;
+    search.capacity = neighbors_count;
+    search.count = 0;
+    search.idxs = neighbors_idxs;
+    search.squared_distances = squared_distances;
+    if (neighbors_count > 0 && tree -> n > 0) {
+        _search_node(&search, 0);
+    }
+
+    /* Sort the heap from the nearest to the farthest */
+    count = search.count;
+    for (i = count; i > 1; i--) {
+        swap_idx = neighbors_idxs[0];
+        neighbors_idxs[0] = neighbors_idxs[i - 1];
+        neighbors_idxs[i - 1] = swap_idx;
+        swap_distance = squared_distances[0];
+        squared_distances[0] = squared_distances[i - 1];
+        squared_distances[i - 1] = swap_distance;
+        _sift_down(neighbors_idxs, squared_distances, i - 1, 0);
+    }
+    return count;
+}
+
+void free_kd_tree(KdTree *tree) {
+    free(tree -> idxs);
+    free(tree -> nodes);
+    free(tree);
+}
+
+static size_t _build_node(KdTree *tree, size_t start, size_t end) {
+    size_t node_idx = tree -> nodes_count++;
+    size_t mid, dimension;
+    KdNode *node = &tree -> nodes[node_idx];
+
+    node -> start = start;
+    node -> end = end;
+    node -> left = 0;
+    node -> right = 0;
+    node -> split_dimension = 0;
+    node -> split_value = 0.0;
+    if (end - start <= KD_TREE_LEAF_SIZE) {
+        return node_idx;
+    }
+
+    dimension = _widest_dimension(tree, start, end);
+    mid = start + (end - start) / 2;
+    _select(tree, start, end, mid, dimension);
+
+    node -> split_dimension = dimension;
+    node -> split_value = tree -> points[tree -> idxs[mid]][dimension];
+    node -> left = _build_node(tree, start, mid);
+    node -> right = _build_node(tree, mid, end);
+    return node_idx;
+}
+
+static size_t _widest_dimension(const KdTree *tree, size_t start, size_t end) {
+    size_t i, j, widest = 0;
+    double value, min_value, max_value, max_spread = -1.0;
+
+    for (j = 0; j < tree -> m; j++) {
+        min_value = INFINITY;
+        max_value = -INFINITY;
+        for (i = start; i < end; i++) {
+            value = tree -> points[tree -> idxs[i]][j];
+            min_value = (value < min_value) ? value : min_value;
+            max_value = (value > max_value) ? value : max_value;
+        }
+        if (max_value - min_value > max_spread) {
+            max_spread = max_value - min_value;
+            widest = j;
+        }
+    }
+    return widest;
+}
+
+/**
+ * Reorder idxs[start, end) so that idxs[nth] is the point that would be there
+ * if the range was sorted by the given coordinate, with smaller or equal
+ * points before it and greater or equal points after it. Every round splits
+ * the range in three around a pivot, so repeated values don't slow it down.
+ */
+static void _select(KdTree *tree, size_t start, size_t end, size_t nth,
+                    size_t dimension) {
+    size_t lower, i, upper, swap;
+    size_t *idxs = tree -> idxs;
+    double pivot, value;
+
+    while (end - start > 1) {
+        pivot = tree -> points[idxs[start + (end - start) / 2]][dimension];
+        lower = start;
+        i = start;
+        upper = end;
+        while (i < upper) {
+            value = tree -> points[idxs[i]][dimension];
+            if (value < pivot) {
+                swap = idxs[i];
+                idxs[i++] = idxs[lower];
+                idxs[lower++] = swap;
+            } else if (value > pivot) {
+                swap = idxs[i];
+                idxs[i] = idxs[--upper];
+                idxs[upper] = swap;
+            } else {
+                i++;
+            }
+        }
+
+        if (nth < lower) {
+            end = lower;
+        } else if (nth >= upper) {
+            start = upper;
+        } else {
+            return;
+        }
+    }
+}
+
+static void _search_node(KdSearch *search, size_t node_idx) {
+    size_t i, idx, near, far;
+    double diff;
+    const KdTree *tree = search -> tree;
+    const KdNode *node = &tree -> nodes[node_idx];
+
+    if (node -> left == 0) {
+        for (i = node -> start; i < node -> end; i++) {
+            idx = tree -> idxs[i];
+            if (idx != search -> excluded_idx) {
+                _push_neighbor(search, idx, tree -> squared_distance(
+                    tree -> points[idx], search -> query, tree -> m));
+            }
+        }
+        return;
+    }
+
+    /*
+     * The left child has the points up to the split value and the right one
+     * those from it, so the far child can only have a nearer point than the
+     * farthest found if the query is close enough to the split.
+     */
+    diff = search -> query[node -> split_dimension] - node -> split_value;
+    near = (diff < 0) ? node -> left : node -> right;
+    far = (diff < 0) ? node -> right : node -> left;
+    _search_node(search, near);
+    if (search -> count < search -> capacity ||
+        diff * diff < search -> squared_distances[0]) {
+        _search_node(search, far);
+    }
+}
+
+static void _push_neighbor(KdSearch *search, size_t idx, double distance) {
+    size_t i, parent, swap_idx;
+    double swap_distance;
+    size_t *idxs = search -> idxs;
+    Vector distances = search -> squared_distances;
+
+    if (search -> count < search -> capacity) {
+        i = search -> count++;
+        idxs[i] = idx;
+        distances[i] = distance;
+        while (i > 0 && distances[(parent = (i - 1) / 2)] < distances[i]) {
+            swap_idx = idxs[i];
+            idxs[i] = idxs[parent];
+            idxs[parent] = swap_idx;
+            swap_distance = distances[i];
+            distances[i] = distances[parent];
+            distances[parent] = swap_distance;
+            i = parent;
+        }
+    } else if (distance < distances[0]) {
+        idxs[0] = idx;
+        distances[0] = distance;
+        _sift_down(idxs, distances, search -> count, 0);
+    }
+}
+
+static void _sift_down(size_t *idxs, Vector distances, size_t count, size_t i) {
+    size_t largest, child, swap_idx;
+    double swap_distance;
+
+    for (;;) {
+        largest = i;
+        child = 2 * i + 1;
+        if (child < count && distances[child] > distances[largest]) {
+            largest = child;
+        }
+        if (child + 1 < count && distances[child + 1] > distances[largest]) {
+            largest = child + 1;
+        }
+        if (largest == i) {
+            return;
+        }
+
+        swap_idx = idxs[i];
+        idxs[i] = idxs[largest];
+        idxs[largest] = swap_idx;
+        swap_distance = distances[i];
+        distances[i] = distances[largest];
+        distances[largest] = swap_distance;
+        i = largest;
+    }
+}
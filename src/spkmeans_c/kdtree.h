@@ -0,0 +1,66 @@
+#ifndef KDTREE_H
+#define KDTREE_H
+
+#include "matrix.h"
+#include "vector.h"
+#include <stddef.h>
+
+#define KD_TREE_LEAF_SIZE 16
+#define KD_TREE_NO_EXCLUSION ((size_t) -1)
+
+/**
+ * A node of a KD-tree, which covers the points at indices [start, end) of the
+ * tree's idxs. An inner node splits them at split_value of coordinate
+ * split_dimension into its left and right children (indices into the tree's
+ * nodes), and a leaf has no children, so left and right are 0.
+ */
+typedef struct KdNode {
+    size_t start;
+    size_t end;
+    size_t split_dimension;
+    double split_value;
+    size_t left;
+    size_t right;
+} KdNode;
+
+/**
+ * A KD-tree over n points of order m. The tree doesn't copy the points, so
+ * they must outlive it. idxs is a permutation of the point indices, where
+ * every node covers a contiguous range, and nodes[0] is the root.
+ */
+typedef struct KdTree {
+    Matrix points;
+    size_t n;
+    size_t m;
+    size_t *idxs;
+    KdNode *nodes;
+    size_t nodes_count;
+    SquaredDistanceKernel squared_distance;
+} KdTree;
+
+/**
+ * Receive n points of order m and build a KD-tree over them, by splitting
+ * every node at the median of its widest coordinate until it has at most
+ * KD_TREE_LEAF_SIZE points. The function allocates memory for the tree, so
+ * it's the caller's responsibility to free it with free_kd_tree.
+ */
+KdTree *build_kd_tree(Matrix points, size_t n, size_t m);
+
+/**
+ * Receive a KD-tree, a query point, the number of neighbors to find and the
+ * index of a point to leave out (or KD_TREE_NO_EXCLUSION), and set
+ * neighbors_idxs and squared_distances to the indices of the nearest points
+ * of the tree and their squared distances from the query, from the nearest to
+ * the farthest. Return the number of neighbors found, which is smaller than
+ * neighbors_count if the tree has fewer points.
+ */
+size_t kd_tree_nearest(const KdTree *tree, Vector query, size_t neighbors_count,
+                       size_t excluded_idx, size_t *neighbors_idxs,
+                       Vector squared_distances);
+
+/**
+ * Receive a KD-tree and free it, without freeing its points.
+ */
+void free_kd_tree(KdTree *tree);
+
+#endif
@@ -2,26 +2,224 @@
 #define _GNU_SOURCE
 #endif
 
+#define YINYANG_CENTROIDS_PER_GROUP 10
+#define YINYANG_GROUPING_ITERATIONS 5
+#define AUTO_HAMERLY_MAX_K 32
+#define AUTO_HAMERLY_MAX_K_LOW_DIMENSION 128
+#define AUTO_LOW_DIMENSION 8
+#define KMEANS_MIN_BLOCK_SIZE 1024
+#define KMEANS_MAX_BLOCKS 64
+
 #include <math.h>
+#include <string.h>
 #include "kmeans.h"
+#include "parallel.h"
+
+/**
+ * The state shared by the K-means engines. The centroids are stored
+ * contiguously, k rows of vector_size values each, and new_centroids is the
+ * second buffer the update step writes into before the two are swapped.
+ * The vectors are split to blocks_count blocks of block_size vectors, and
+ * every block has its own k centroid sums and cluster sizes accumulators.
+ * kernels are the vector kernels of vector_size, looked up once per fit.
+ * If assign_block_vectors is set, every block runs it on its vectors before
+ * summing them, so the assignment step shares the update step's blocks.
+ */
+typedef struct KmeansState KmeansState;
+
+/**
+ * The assignment step of an engine, which assigns the vectors [start, end) of
+ * block block_idx to clusters, with the engine's own state in the engine field
+ * of the K-means state.
+ */
+typedef void (*BlockAssignment)(KmeansState *state, size_t block_idx,
+                                size_t start, size_t end);
+
+struct KmeansState {
+    Vector *vectors;
+    size_t vectors_count;
+    size_t vector_size;
+    const VectorKernels *kernels;
+    size_t k;
+    size_t iter;
+    double squared_epsilon;
+    size_t batch_size;
+    uint32_t seed;
+    Vector centroids;
+    Vector new_centroids;
+    Vector squared_centroid_shifts;
+    size_t *cluster_mapping;
+    size_t *cluster_sizes;
+    size_t threads_count;
+    size_t block_size;
+    size_t blocks_count;
+    Vector block_centroid_sums;
+    size_t *block_cluster_sizes;
+    size_t reduction_stride;
+    BlockAssignment assign_block_vectors;
+    void *engine;
+    Vector block_inertias;
+    size_t iterations;
+    bool converged;
+    KmeansStatistics statistics;
+};
+
+/**
+ * The bounds of Elkan's engine: an upper bound and k lower bounds per vector,
+ * and the centroids' distances and shifts the assignment step of iteration
+ * compares them against. Every block counts its distance computations in its
+ * own slot of block_computed.
+ */
+typedef struct ElkanBounds {
+    size_t iteration;
+    Vector upper_bounds;
+    Vector lower_bounds;
+    Vector half_centroid_distances;
+    Vector half_min_centroid_distances;
+    Vector centroid_shifts;
+    size_t *block_computed;
+} ElkanBounds;
+
+/**
+ * The bounds of Hamerly's engine: an upper bound and a lower bound per vector,
+ * the centroids' half distances to their closest ones, and their shifts, of
+ * which the largest two (and the index of the largest) move the lower bounds.
+ */
+typedef struct HamerlyBounds {
+    size_t iteration;
+    Vector upper_bounds;
+    Vector lower_bounds;
+    Vector half_min_centroid_distances;
+    Vector centroid_shifts;
+    double max_shift;
+    double second_max_shift;
+    size_t max_shift_idx;
+    size_t *block_computed;
+} HamerlyBounds;
+
+/**
+ * The bounds of the Yinyang engine: an upper bound and groups_count group
+ * bounds per vector, the grouping of the centroids, their shifts and the
+ * largest shift in every group.
+ */
+typedef struct YinyangBounds {
+    size_t iteration;
+    size_t groups_count;
+    Vector upper_bounds;
+    Vector group_bounds;
+    Vector centroid_shifts;
+    Vector group_max_shifts;
+    size_t *centroid_groups;
+    size_t *group_starts;
+    size_t *group_members;
+    size_t *block_computed;
+} YinyangBounds;
+
+/**
+ * The shared context of the restarts run by fit_multi. The vectors are only
+ * read, and every restart writes its initial centroids indices, fitted
+ * centroids and inertia to its own slot of restart_idxs, restart_centroids
+ * and inertias.
+ */
+typedef struct RestartsContext {
+    Vector *vectors;
+    size_t vectors_count;
+    size_t vector_size;
+    size_t k;
+    SeedingMode mode;
+    KmeansOptions options;
+    size_t *restart_idxs;
+    Vector restart_centroids;
+    Vector inertias;
+} RestartsContext;
+
+/**
+ * The shared context of the block tasks of kmeans_parallel. Every round, each
+ * block of block_size vectors brings D(x) up to date against the candidates
+ * from new_candidates_start on and sums its cost into block_costs, and then
+ * samples its vectors into its own slice of sampled_idxs, with a random state
+ * of its own seeded by round_seed + its index.
+ */
+typedef struct SamplingContext {
+    Vector *vectors;
+    size_t vectors_count;
+    size_t vector_size;
+    SquaredDistanceKernel distance_kernel;
+    size_t block_size;
+    size_t *candidates_idxs;
+    size_t new_candidates_start;
+    size_t candidates_count;
+    Vector min_distances;
+    size_t *nearest_candidate;
+    Vector block_costs;
+    double cost;
+    double oversampling_factor;
+    uint32_t round_seed;
+    size_t *sampled_idxs;
+    size_t *block_samples_counts;
+} SamplingContext;
 
-static size_t assign_vector_to_cluster(Vector vector, Cluster *clusters,
-                                       size_t vector_size, size_t k);
-static bool update_centroid_of_cluster(Cluster *cluster, Vector *vectors,
-                                       size_t *cluster_mapping,
-                                       size_t cluster_idx, size_t vectors_count,
-                                       size_t vector_size, double epsilon);
+static size_t assign_vector_to_cluster(Vector vector, Vector centroids,
+                                       size_t vector_size, size_t k,
+                                       const VectorKernels *kernels);
+static void accumulate_block(void *context, size_t block_idx);
+static void reduce_blocks(void *context, size_t pair_idx);
+static void assign_block(void *context, size_t block_idx);
+static void measure_block(void *context, size_t block_idx);
+static bool update_centroids(KmeansState *state);
+/**
+ * Receive the state of an engine, and set in half_distances (if not NULL) half
+ * the distance between every two centroids, as a k x k table, and in
+ * half_min_distances half the distance from every centroid to its closest one.
+ */
+static void compute_half_centroid_distances(KmeansState *state,
+                                            Vector half_distances,
+                                            Vector half_min_distances);
+/**
+ * Receive the state of an engine after an update step, and set in shifts the
+ * distance every centroid moved in it.
+ */
+static void compute_centroid_shifts(KmeansState *state, Vector shifts);
+static void lloyd(KmeansState *state);
+static void lloyd_assign(KmeansState *state, size_t block_idx, size_t start,
+                         size_t end);
+static void elkan(KmeansState *state);
+static void elkan_assign(KmeansState *state, size_t block_idx, size_t start,
+                         size_t end);
+static void hamerly(KmeansState *state);
+static void hamerly_assign(KmeansState *state, size_t block_idx, size_t start,
+                           size_t end);
+static void yinyang(KmeansState *state);
+static void yinyang_assign(KmeansState *state, size_t block_idx, size_t start,
+                           size_t end);
+static void minibatch(KmeansState *state);
+static void update_sampling_block(void *context, size_t block_idx);
+static void sample_block(void *context, size_t block_idx);
+static void complete_candidates(SamplingContext *context, size_t blocks_count,
+                                size_t k, RandomState *rs,
+                                size_t *candidates_count,
+                                size_t threads_count);
+static void group_centroids(KmeansState *state, size_t groups_count,
+                            size_t *centroid_groups, size_t *group_starts,
+                            size_t *group_members);
+static void weighted_kmeanspp(Vector *vectors, Vector vector_weights,
+                              size_t vectors_count, size_t vector_size,
+                              size_t k, SeedingMode mode, RandomState *rs,
+                              size_t *centroids_idxs);
+static void run_restart(void *context, size_t restart_idx);
+static size_t search_cumulative_weights(Vector cumulative_weights,
+                                        size_t count, double value);
 
-static size_t assign_vector_to_cluster(Vector vector, Cluster *clusters,
-                                       size_t vector_size, size_t k) {
+static size_t assign_vector_to_cluster(Vector vector, Vector centroids,
+                                       size_t vector_size, size_t k,
+                                       const VectorKernels *kernels) {
     size_t i = 0, assigned_cluster_idx = 0;
     double min_distance = INFINITY;
-    Vector centroid = NULL;
     double distance;
 
     for (i = 0; i < k; i++) {
-        centroid = clusters[i].centroid;
-        distance = euclidean_distance(centroid, vector, vector_size);
+        distance = kernels -> squared_distance(centroids + i * vector_size,
+                                               vector, vector_size);
 
         if (distance < min_distance) {
             min_distance = distance;
@@ -32,55 +230,1284 @@ static size_t assign_vector_to_cluster(Vector vector, Cluster *clusters,
     return assigned_cluster_idx;
 }
 
-static bool update_centroid_of_cluster(Cluster *cluster, Vector *vectors,
-                                       size_t *cluster_mapping,
-                                       size_t cluster_idx, size_t vectors_count,
-                                       size_t vector_size, double epsilon) {
-    size_t i, j, cluster_size = 0;
+static void accumulate_block(void *context, size_t block_idx) {
+    KmeansState *state = (KmeansState *) context;
+    size_t i, c;
+    size_t d = state -> vector_size, k = state -> k;
+    size_t start = block_idx * state -> block_size;
+    size_t end = start + state -> block_size;
+    Vector sums = state -> block_centroid_sums + block_idx * k * d;
+    size_t *sizes = state -> block_cluster_sizes + block_idx * k;
+
+    end = (end < state -> vectors_count) ? end : state -> vectors_count;
+    memset(sums, 0, k * d * sizeof(double));
+    memset(sizes, 0, k * sizeof(size_t));
+
+    if (state -> assign_block_vectors != NULL) {
+        state -> assign_block_vectors(state, block_idx, start, end);
+    }
+    for (i = start; i < end; i++) {
+        c = state -> cluster_mapping[i];
+        ++sizes[c];
+        state -> kernels -> add_vector(sums + c * d, state -> vectors[i], d);
+    }
+}
+
+static void reduce_blocks(void *context, size_t pair_idx) {
+    KmeansState *state = (KmeansState *) context;
+    size_t i, k = state -> k, kd = state -> k * state -> vector_size;
+    size_t target = pair_idx * 2 * state -> reduction_stride;
+    size_t source = target + state -> reduction_stride;
+
+    if (source >= state -> blocks_count) {
+        return;
+    }
+
+    for (i = 0; i < kd; i++) {
+        state -> block_centroid_sums[target * kd + i] +=
+            state -> block_centroid_sums[source * kd + i];
+    }
+    for (i = 0; i < k; i++) {
+        state -> block_cluster_sizes[target * k + i] +=
+            state -> block_cluster_sizes[source * k + i];
+    }
+}
+
+static void assign_block(void *context, size_t block_idx) {
+    KmeansState *state = (KmeansState *) context;
+    size_t i, start = block_idx * state -> block_size;
+    size_t end = start + state -> block_size;
+
+    end = (end < state -> vectors_count) ? end : state -> vectors_count;
+    for (i = start; i < end; i++) {
+        state -> cluster_mapping[i] = assign_vector_to_cluster(
+            state -> vectors[i], state -> centroids, state -> vector_size,
+            state -> k, state -> kernels);
+    }
+}
+
+static void measure_block(void *context, size_t block_idx) {
+    KmeansState *state = (KmeansState *) context;
+    size_t i, d = state -> vector_size, start = block_idx * state -> block_size;
+    size_t end = start + state -> block_size;
+    double inertia = 0.0;
+
+    end = (end < state -> vectors_count) ? end : state -> vectors_count;
+    for (i = start; i < end; i++) {
+        inertia += state -> kernels -> squared_distance(
+            state -> vectors[i],
+            state -> centroids + state -> cluster_mapping[i] * d, d);
+    }
+    state -> block_inertias[block_idx] = inertia;
+}
+
+static bool update_centroids(KmeansState *state) {
+    size_t i, j, stride;
+    size_t d = state -> vector_size, blocks_count = state -> blocks_count;
+    bool done = true;
+    Vector centroid = NULL, swap = NULL;
+
+    /*
+     * Every block of vectors is summed into its own accumulator, and the
+     * accumulators are then added up pairwise in a fixed tree order. The
+     * blocks only depend on the number of vectors, so the centroids are the
+     * same for any number of threads.
+     */
+    parallel_for(blocks_count, state -> threads_count, accumulate_block, state);
+    for (stride = 1; stride < blocks_count; stride *= 2) {
+        state -> reduction_stride = stride;
+        parallel_for((blocks_count + 2 * stride - 1) / (2 * stride),
+                     state -> threads_count, reduce_blocks, state);
+    }
+
+    memcpy(state -> cluster_sizes, state -> block_cluster_sizes,
+           state -> k * sizeof(size_t));
+    for (i = 0; i < state -> k; i++) {
+        centroid = state -> new_centroids + i * d;
+        if (state -> cluster_sizes[i] == 0) {
+            /* An empty cluster keeps its previous centroid */
+            memcpy(centroid, state -> centroids + i * d, d * sizeof(double));
+        } else {
+            for (j = 0; j < d; j++) {
+                centroid[j] = state -> block_centroid_sums[i * d + j] /
+                              state -> cluster_sizes[i];
+            }
+        }
+
+        state -> squared_centroid_shifts[i] =
+            state -> kernels -> squared_distance(
+                centroid, state -> centroids + i * d, d);
+        done &= state -> squared_centroid_shifts[i] < state -> squared_epsilon;
+    }
+
+    swap = state -> centroids;
+    state -> centroids = state -> new_centroids;
+    state -> new_centroids = swap;
+    ++(state -> iterations);
+    state -> converged = done;
+    return done;
+}
+
+static void compute_half_centroid_distances(KmeansState *state,
+                                            Vector half_distances,
+                                            Vector half_min_distances) {
+    size_t a, c, k = state -> k, d = state -> vector_size;
+    double distance;
+
+    for (c = 0; c < k; c++) {
+        half_min_distances[c] = INFINITY;
+    }
+    for (c = 0; c < k; c++) {
+        if (half_distances != NULL) {
+            half_distances[c * k + c] = 0.0;
+        }
+        for (a = c + 1; a < k; a++) {
+            distance = sqrt(state -> kernels -> squared_distance(
+                state -> centroids + c * d, state -> centroids + a * d, d)) / 2;
+            if (half_distances != NULL) {
+                half_distances[c * k + a] = distance;
+                half_distances[a * k + c] = distance;
+            }
+            if (distance < half_min_distances[c]) {
+                half_min_distances[c] = distance;
+            }
+            if (distance < half_min_distances[a]) {
+                half_min_distances[a] = distance;
+            }
+        }
+    }
+}
+
+static void compute_centroid_shifts(KmeansState *state, Vector shifts) {
+    size_t c;
+
+    for (c = 0; c < state -> k; c++) {
+        shifts[c] = sqrt(state -> squared_centroid_shifts[c]);
+    }
+}
+
+static void lloyd(KmeansState *state) {
+    size_t i;
+    bool done = false;
+
+    state -> assign_block_vectors = lloyd_assign;
+    for (i = 0; i < state -> iter && !done; i++) {
+        state -> statistics.distance_computations += state -> vectors_count * state -> k;
+        done = update_centroids(state);
+    }
+    state -> assign_block_vectors = NULL;
+}
+
+static void lloyd_assign(KmeansState *state, size_t block_idx, size_t start,
+                         size_t end) {
+    size_t j;
+
+    (void) block_idx;
+    for (j = start; j < end; j++) {
+        state -> cluster_mapping[j] = assign_vector_to_cluster(
+            state -> vectors[j], state -> centroids, state -> vector_size,
+            state -> k, state -> kernels);
+    }
+}
+
+static void elkan(KmeansState *state) {
+    size_t i, b, n = state -> vectors_count, k = state -> k, computed = 0;
     bool done = false;
-    double distance = INFINITY;
+    ElkanBounds bounds;
+
+    bounds.upper_bounds = (Vector) malloc(n * sizeof(double));
+    bounds.lower_bounds = (Vector) malloc(n * k * sizeof(double));
+    bounds.half_centroid_distances = (Vector) malloc(k * k * sizeof(double));
+    bounds.half_min_centroid_distances = (Vector) malloc(k * sizeof(double));
+    bounds.centroid_shifts = (Vector) malloc(k * sizeof(double));
+    bounds.block_computed = (size_t *) calloc(state -> blocks_count,
+                                              sizeof(size_t));
+    state -> engine = &bounds;
+    state -> assign_block_vectors = elkan_assign;
+
+    for (i = 0; i < state -> iter && !done; i++) {
+        bounds.iteration = i;
+        if (i > 0) {
+            compute_centroid_shifts(state, bounds.centroid_shifts);
+            compute_half_centroid_distances(
+                state, bounds.half_centroid_distances,
+                bounds.half_min_centroid_distances);
+        }
+        done = update_centroids(state);
+    }
 
-    Vector old_centroid = (*cluster).centroid;
-    Vector new_centroid = calloc(vector_size, sizeof(double));
+    state -> assign_block_vectors = NULL;
+    state -> engine = NULL;
+    for (b = 0; b < state -> blocks_count; b++) {
+        computed += bounds.block_computed[b];
+    }
+    state -> statistics.distance_computations += computed;
+    state -> statistics.skipped_distance_computations += i * n * k - computed;
+
+    free(bounds.upper_bounds);
+    free(bounds.lower_bounds);
+    free(bounds.half_centroid_distances);
+    free(bounds.half_min_centroid_distances);
+    free(bounds.centroid_shifts);
+    free(bounds.block_computed);
+}
 
-    for (i = 0; i < vectors_count; i++) {
-        if (cluster_mapping[i] != cluster_idx) {
+static void elkan_assign(KmeansState *state, size_t block_idx, size_t start,
+                         size_t end) {
+    ElkanBounds *bounds = (ElkanBounds *) state -> engine;
+    size_t j, c, a, d = state -> vector_size, k = state -> k, computed = 0;
+    bool upper_bound_tight;
+    double squared_distance, assigned_squared_distance;
+    SquaredDistanceKernel distance_kernel =
+        state -> kernels -> squared_distance;
+    Vector vector = NULL;
+    Vector upper_bounds = bounds -> upper_bounds;
+    Vector lower_bounds = bounds -> lower_bounds;
+    const double *half_centroid_distances = bounds -> half_centroid_distances;
+    const double *half_min_centroid_distances =
+        bounds -> half_min_centroid_distances;
+    const double *centroid_shifts = bounds -> centroid_shifts;
+
+    for (j = start; j < end; j++) {
+        vector = state -> vectors[j];
+        if (bounds -> iteration == 0) {
+            /* The first assignment computes every distance to set the bounds */
+            assigned_squared_distance = INFINITY;
+            for (c = 0; c < k; c++) {
+                squared_distance = distance_kernel(
+                    vector, state -> centroids + c * d, d);
+                lower_bounds[j * k + c] = sqrt(squared_distance);
+                if (squared_distance < assigned_squared_distance) {
+                    assigned_squared_distance = squared_distance;
+                    state -> cluster_mapping[j] = c;
+                }
+            }
+            upper_bounds[j] = sqrt(assigned_squared_distance);
+            computed += k;
             continue;
         }
 
-        ++cluster_size;
-        for (j = 0; j < vector_size; j++) {
-            new_centroid[j] += vectors[i][j];
+        /* The bounds follow the centroids' moves in the last update step */
+        a = state -> cluster_mapping[j];
+        upper_bounds[j] += centroid_shifts[a];
+        for (c = 0; c < k; c++) {
+            lower_bounds[j * k + c] -= centroid_shifts[c];
+            if (lower_bounds[j * k + c] < 0.0) {
+                lower_bounds[j * k + c] = 0.0;
+            }
         }
+
+        /*
+         * All comparisons against the bounds are strict, so a centroid is
+         * skipped only if it can't even tie with the assigned one, which keeps
+         * the assignments identical to Lloyd's.
+         */
+        if (upper_bounds[j] < half_min_centroid_distances[a]) {
+            continue;
+        }
+
+        upper_bound_tight = false;
+        assigned_squared_distance = 0.0;
+        for (c = 0; c < k; c++) {
+            if (c == a || upper_bounds[j] < lower_bounds[j * k + c] ||
+                upper_bounds[j] < half_centroid_distances[a * k + c]) {
+                continue;
+            }
+
+            if (!upper_bound_tight) {
+                assigned_squared_distance = distance_kernel(
+                    vector, state -> centroids + a * d, d);
+                upper_bounds[j] = sqrt(assigned_squared_distance);
+                lower_bounds[j * k + a] = upper_bounds[j];
+                upper_bound_tight = true;
+                ++computed;
+                if (upper_bounds[j] < lower_bounds[j * k + c] ||
+                    upper_bounds[j] < half_centroid_distances[a * k + c]) {
+                    continue;
+                }
+            }
+
+            squared_distance = distance_kernel(
+                vector, state -> centroids + c * d, d);
+            lower_bounds[j * k + c] = sqrt(squared_distance);
+            ++computed;
+            if (squared_distance < assigned_squared_distance ||
+                (squared_distance == assigned_squared_distance && c < a)) {
+                a = c;
+                assigned_squared_distance = squared_distance;
+                upper_bounds[j] = lower_bounds[j * k + c];
+            }
+        }
+        state -> cluster_mapping[j] = a;
     }
+    bounds -> block_computed[block_idx] += computed;
+}
+
+static void hamerly(KmeansState *state) {
+    size_t i, b, c, n = state -> vectors_count, k = state -> k, computed = 0;
+    bool done = false;
+    HamerlyBounds bounds;
+
+    bounds.upper_bounds = (Vector) malloc(n * sizeof(double));
+    bounds.lower_bounds = (Vector) malloc(n * sizeof(double));
+    bounds.half_min_centroid_distances = (Vector) malloc(k * sizeof(double));
+    bounds.centroid_shifts = (Vector) malloc(k * sizeof(double));
+    bounds.block_computed = (size_t *) calloc(state -> blocks_count,
+                                              sizeof(size_t));
+    state -> engine = &bounds;
+    state -> assign_block_vectors = hamerly_assign;
 
-    for (i = 0; i < vector_size; i++) {
-        new_centroid[i] /= cluster_size;
+    for (i = 0; i < state -> iter && !done; i++) {
+        bounds.iteration = i;
+        if (i > 0) {
+            compute_centroid_shifts(state, bounds.centroid_shifts);
+            bounds.max_shift = 0.0;
+            bounds.second_max_shift = 0.0;
+            bounds.max_shift_idx = 0;
+            for (c = 0; c < k; c++) {
+                if (bounds.centroid_shifts[c] > bounds.max_shift) {
+                    bounds.second_max_shift = bounds.max_shift;
+                    bounds.max_shift = bounds.centroid_shifts[c];
+                    bounds.max_shift_idx = c;
+                } else if (bounds.centroid_shifts[c] >
+                           bounds.second_max_shift) {
+                    bounds.second_max_shift = bounds.centroid_shifts[c];
+                }
+            }
+            compute_half_centroid_distances(
+                state, NULL, bounds.half_min_centroid_distances);
+        }
+        done = update_centroids(state);
     }
 
-    distance = euclidean_distance(new_centroid, old_centroid, vector_size);
-    done = distance < epsilon;
-    (*cluster).centroid = new_centroid;
-    free(old_centroid);
-    return done;
+    state -> assign_block_vectors = NULL;
+    state -> engine = NULL;
+    for (b = 0; b < state -> blocks_count; b++) {
+        computed += bounds.block_computed[b];
+    }
+    state -> statistics.distance_computations += computed;
+    state -> statistics.skipped_distance_computations += i * n * k - computed;
+
+    free(bounds.upper_bounds);
+    free(bounds.lower_bounds);
+    free(bounds.half_min_centroid_distances);
+    free(bounds.centroid_shifts);
+    free(bounds.block_computed);
+}
+
+static void hamerly_assign(KmeansState *state, size_t block_idx, size_t start,
+                           size_t end) {
+    HamerlyBounds *bounds = (HamerlyBounds *) state -> engine;
+    size_t j, c, a, assigned, d = state -> vector_size, k = state -> k;
+    size_t computed = 0;
+    double squared_distance, assigned_squared_distance = 0.0;
+    double closest_squared_distance, second_squared_distance, bound;
+    SquaredDistanceKernel distance_kernel =
+        state -> kernels -> squared_distance;
+    Vector vector = NULL;
+    Vector upper_bounds = bounds -> upper_bounds;
+    Vector lower_bounds = bounds -> lower_bounds;
+    const double *half_min_centroid_distances =
+        bounds -> half_min_centroid_distances;
+
+    for (j = start; j < end; j++) {
+        assigned = (bounds -> iteration > 0) ? state -> cluster_mapping[j] : k;
+        vector = state -> vectors[j];
+        if (bounds -> iteration > 0) {
+            /* The bounds follow the centroids' moves in the last update step */
+            upper_bounds[j] += bounds -> centroid_shifts[assigned];
+            lower_bounds[j] -= (assigned == bounds -> max_shift_idx) ?
+                               bounds -> second_max_shift :
+                               bounds -> max_shift;
+
+            /* Strict comparisons keep the assignments identical to Lloyd's */
+            bound = (half_min_centroid_distances[assigned] > lower_bounds[j])
+                        ? half_min_centroid_distances[assigned]
+                        : lower_bounds[j];
+            if (upper_bounds[j] < bound) {
+                continue;
+            }
+
+            assigned_squared_distance = distance_kernel(
+                vector, state -> centroids + assigned * d, d);
+            upper_bounds[j] = sqrt(assigned_squared_distance);
+            ++computed;
+            if (upper_bounds[j] < bound) {
+                continue;
+            }
+        }
+
+        /* Find the closest and second closest centroids */
+        a = 0;
+        closest_squared_distance = INFINITY;
+        second_squared_distance = INFINITY;
+        for (c = 0; c < k; c++) {
+            if (c == assigned) {
+                squared_distance = assigned_squared_distance;
+            } else {
+                squared_distance = distance_kernel(
+                    vector, state -> centroids + c * d, d);
+                ++computed;
+            }
+
+            if (squared_distance < closest_squared_distance) {
+                second_squared_distance = closest_squared_distance;
+                closest_squared_distance = squared_distance;
+                a = c;
+            } else if (squared_distance < second_squared_distance) {
+                second_squared_distance = squared_distance;
+            }
+        }
+
+        state -> cluster_mapping[j] = a;
+        upper_bounds[j] = sqrt(closest_squared_distance);
+        lower_bounds[j] = sqrt(second_squared_distance);
+    }
+    bounds -> block_computed[block_idx] += computed;
+}
+
+static void yinyang(KmeansState *state) {
+    size_t i, b, c, g, m, n = state -> vectors_count, k = state -> k;
+    size_t t = k / YINYANG_CENTROIDS_PER_GROUP, computed = 0;
+    bool done = false;
+    YinyangBounds bounds;
+
+    t = (t == 0) ? 1 : t;
+    bounds.groups_count = t;
+    bounds.upper_bounds = (Vector) malloc(n * sizeof(double));
+    bounds.centroid_shifts = (Vector) malloc(k * sizeof(double));
+    bounds.centroid_groups = (size_t *) malloc(k * sizeof(size_t));
+    bounds.group_starts = (size_t *) malloc((t + 1) * sizeof(size_t));
+    bounds.group_members = (size_t *) malloc(k * sizeof(size_t));
+    bounds.group_bounds = (Vector) malloc(n * t * sizeof(double));
+    bounds.group_max_shifts = (Vector) malloc(t * sizeof(double));
+    bounds.block_computed = (size_t *) calloc(state -> blocks_count,
+                                              sizeof(size_t));
+    group_centroids(state, t, bounds.centroid_groups, bounds.group_starts,
+                    bounds.group_members);
+    state -> engine = &bounds;
+    state -> assign_block_vectors = yinyang_assign;
+
+    for (i = 0; i < state -> iter && !done; i++) {
+        bounds.iteration = i;
+        if (i > 0) {
+            compute_centroid_shifts(state, bounds.centroid_shifts);
+            for (g = 0; g < t; g++) {
+                bounds.group_max_shifts[g] = 0.0;
+                for (m = bounds.group_starts[g];
+                     m < bounds.group_starts[g + 1]; m++) {
+                    c = bounds.group_members[m];
+                    if (bounds.centroid_shifts[c] >
+                        bounds.group_max_shifts[g]) {
+                        bounds.group_max_shifts[g] = bounds.centroid_shifts[c];
+                    }
+                }
+            }
+        }
+        done = update_centroids(state);
+    }
+
+    state -> assign_block_vectors = NULL;
+    state -> engine = NULL;
+    for (b = 0; b < state -> blocks_count; b++) {
+        computed += bounds.block_computed[b];
+    }
+    state -> statistics.distance_computations += computed;
+    state -> statistics.skipped_distance_computations += i * n * k - computed;
+
+    free(bounds.upper_bounds);
+    free(bounds.centroid_shifts);
+    free(bounds.centroid_groups);
+    free(bounds.group_starts);
+    free(bounds.group_members);
+    free(bounds.group_bounds);
+    free(bounds.group_max_shifts);
+    free(bounds.block_computed);
+}
+
+static void yinyang_assign(KmeansState *state, size_t block_idx, size_t start,
+                           size_t end) {
+    YinyangBounds *bounds = (YinyangBounds *) state -> engine;
+    size_t j, c, g, m, a, old_assigned, d = state -> vector_size;
+    size_t k = state -> k, t = bounds -> groups_count, computed = 0;
+    double squared_distance, assigned_squared_distance, distance;
+    double assigned_distance, old_assigned_distance, global_bound, bound;
+    double new_group_bound;
+    SquaredDistanceKernel distance_kernel =
+        state -> kernels -> squared_distance;
+    Vector vector = NULL;
+    Vector upper_bounds = bounds -> upper_bounds;
+    Vector group_bounds = bounds -> group_bounds;
+    const double *centroid_shifts = bounds -> centroid_shifts;
+    const double *group_max_shifts = bounds -> group_max_shifts;
+    const size_t *centroid_groups = bounds -> centroid_groups;
+    const size_t *group_starts = bounds -> group_starts;
+    const size_t *group_members = bounds -> group_members;
+
+    for (j = start; j < end; j++) {
+        vector = state -> vectors[j];
+        if (bounds -> iteration == 0) {
+            /*
+             * The first assignment computes every distance, and bounds every
+             * group by its closest centroid other than the assigned one.
+             */
+            a = 0;
+            assigned_squared_distance = INFINITY;
+            for (g = 0; g < t; g++) {
+                group_bounds[j * t + g] = INFINITY;
+            }
+            for (c = 0; c < k; c++) {
+                squared_distance = distance_kernel(
+                    vector, state -> centroids + c * d, d);
+                if (squared_distance < assigned_squared_distance) {
+                    if (assigned_squared_distance < INFINITY) {
+                        bound = sqrt(assigned_squared_distance);
+                        g = centroid_groups[a];
+                        if (bound < group_bounds[j * t + g]) {
+                            group_bounds[j * t + g] = bound;
+                        }
+                    }
+                    assigned_squared_distance = squared_distance;
+                    a = c;
+                } else {
+                    bound = sqrt(squared_distance);
+                    g = centroid_groups[c];
+                    if (bound < group_bounds[j * t + g]) {
+                        group_bounds[j * t + g] = bound;
+                    }
+                }
+            }
+            state -> cluster_mapping[j] = a;
+            upper_bounds[j] = sqrt(assigned_squared_distance);
+            computed += k;
+            continue;
+        }
+
+        /* The bounds follow the centroids' moves in the last update step */
+        old_assigned = state -> cluster_mapping[j];
+        upper_bounds[j] += centroid_shifts[old_assigned];
+        global_bound = INFINITY;
+        for (g = 0; g < t; g++) {
+            group_bounds[j * t + g] -= group_max_shifts[g];
+            if (group_bounds[j * t + g] < global_bound) {
+                global_bound = group_bounds[j * t + g];
+            }
+        }
+
+        /* Strict comparisons keep the assignments identical to Lloyd's */
+        if (upper_bounds[j] < global_bound) {
+            continue;
+        }
+
+        assigned_squared_distance = distance_kernel(
+            vector, state -> centroids + old_assigned * d, d);
+        assigned_distance = sqrt(assigned_squared_distance);
+        old_assigned_distance = assigned_distance;
+        upper_bounds[j] = assigned_distance;
+        ++computed;
+        if (upper_bounds[j] < global_bound) {
+            continue;
+        }
+
+        a = old_assigned;
+        for (g = 0; g < t; g++) {
+            if (group_bounds[j * t + g] > assigned_distance) {
+                continue;
+            }
+
+            new_group_bound = INFINITY;
+            for (m = group_starts[g]; m < group_starts[g + 1]; m++) {
+                c = group_members[m];
+                if (c == old_assigned) {
+                    continue;
+                }
+
+                /* The group bound before the shift, minus c's own */
+                bound = group_bounds[j * t + g] + group_max_shifts[g] -
+                        centroid_shifts[c];
+                if (bound > assigned_distance) {
+                    if (bound < new_group_bound) {
+                        new_group_bound = bound;
+                    }
+                    continue;
+                }
+
+                squared_distance = distance_kernel(
+                    vector, state -> centroids + c * d, d);
+                distance = sqrt(squared_distance);
+                ++computed;
+                if (squared_distance < assigned_squared_distance ||
+                    (squared_distance == assigned_squared_distance &&
+                     c < a)) {
+                    /* The replaced centroid now bounds its group */
+                    if (a != old_assigned) {
+                        if (centroid_groups[a] == g) {
+                            if (assigned_distance < new_group_bound) {
+                                new_group_bound = assigned_distance;
+                            }
+                        } else if (assigned_distance <
+                                   group_bounds[j * t + centroid_groups[a]]) {
+                            group_bounds[j * t + centroid_groups[a]] =
+                                assigned_distance;
+                        }
+                    }
+                    a = c;
+                    assigned_squared_distance = squared_distance;
+                    assigned_distance = distance;
+                } else if (distance < new_group_bound) {
+                    new_group_bound = distance;
+                }
+            }
+            group_bounds[j * t + g] = new_group_bound;
+        }
+
+        if (a != old_assigned) {
+            g = centroid_groups[old_assigned];
+            if (old_assigned_distance < group_bounds[j * t + g]) {
+                group_bounds[j * t + g] = old_assigned_distance;
+            }
+        }
+        state -> cluster_mapping[j] = a;
+        upper_bounds[j] = assigned_distance;
+    }
+    bounds -> block_computed[block_idx] += computed;
+}
+
+static void minibatch(KmeansState *state) {
+    size_t i, j, c, b;
+    size_t n = state -> vectors_count, d = state -> vector_size, k = state -> k;
+    size_t batch_size = (state -> batch_size < n) ? state -> batch_size : n;
+    size_t computed = 0;
+    size_t *batch = (size_t *) malloc(batch_size * sizeof(size_t));
+    size_t *batch_mapping = (size_t *) malloc(batch_size * sizeof(size_t));
+    size_t *centroid_counts = (size_t *) calloc(k, sizeof(size_t));
+    bool done = false;
+    double learning_rate;
+    Vector centroid = NULL, vector = NULL;
+    Vector previous_centroids = state -> new_centroids;
+    RandomState rs;
+
+    seed_random_state(&rs, state -> seed);
+
+    for (i = 0; i < state -> iter && !done; i++) {
+        for (b = 0; b < batch_size; b++) {
+            batch[b] = random_index(&rs, n);
+            batch_mapping[b] = assign_vector_to_cluster(
+                state -> vectors[batch[b]], state -> centroids, d, k,
+                state -> kernels);
+        }
+        computed += batch_size * k;
+
+        /*
+         * Move every centroid towards its batch vectors with a per-centroid
+         * learning rate of 1 / (number of vectors it was assigned so far).
+         */
+        memcpy(previous_centroids, state -> centroids, k * d * sizeof(double));
+        for (b = 0; b < batch_size; b++) {
+            c = batch_mapping[b];
+            centroid = state -> centroids + c * d;
+            vector = state -> vectors[batch[b]];
+            learning_rate = 1.0 / (double) (++centroid_counts[c]);
+            for (j = 0; j < d; j++) {
+                centroid[j] += learning_rate * (vector[j] - centroid[j]);
+            }
+        }
+
+        done = true;
+        for (c = 0; c < k; c++) {
+            done &= state -> kernels -> squared_distance(
+                state -> centroids + c * d, previous_centroids + c * d,
+                d) < state -> squared_epsilon;
+        }
+    }
+
+    /* Label the full dataset once with the final centroids */
+    parallel_for(state -> blocks_count, state -> threads_count, assign_block,
+                 state);
+    memset(state -> cluster_sizes, 0, k * sizeof(size_t));
+    for (j = 0; j < n; j++) {
+        ++(state -> cluster_sizes[state -> cluster_mapping[j]]);
+    }
+    computed += n * k;
+
+    state -> statistics.distance_computations += computed;
+    state -> statistics.skipped_distance_computations +=
+        (i * n * k > computed) ? i * n * k - computed : 0;
+    state -> iterations = i;
+    state -> converged = done;
+
+    free(batch);
+    free(batch_mapping);
+    free(centroid_counts);
+}
+
+static void group_centroids(KmeansState *state, size_t groups_count,
+                            size_t *centroid_groups, size_t *group_starts,
+                            size_t *group_members) {
+    size_t i, c, g, j;
+    size_t k = state -> k, d = state -> vector_size;
+    size_t *group_sizes = (size_t *) calloc(groups_count, sizeof(size_t));
+    Vector group_centers = (Vector) malloc(groups_count * d * sizeof(double));
+    Vector center = NULL;
+
+    /* Group the initial centroids with a few Lloyd iterations of their own */
+    memcpy(group_centers, state -> centroids, groups_count * d * sizeof(double));
+    for (i = 0; i < YINYANG_GROUPING_ITERATIONS; i++) {
+        for (c = 0; c < k; c++) {
+            centroid_groups[c] = assign_vector_to_cluster(
+                state -> centroids + c * d, group_centers, d, groups_count,
+                state -> kernels);
+        }
+
+        memset(group_sizes, 0, groups_count * sizeof(size_t));
+        for (c = 0; c < k; c++) {
+            ++group_sizes[centroid_groups[c]];
+        }
+        for (g = 0; g < groups_count; g++) {
+            if (group_sizes[g] > 0) {
+                memset(group_centers + g * d, 0, d * sizeof(double));
+            }
+        }
+        for (c = 0; c < k; c++) {
+            center = group_centers + centroid_groups[c] * d;
+            for (j = 0; j < d; j++) {
+                center[j] += state -> centroids[c * d + j] /
+                             group_sizes[centroid_groups[c]];
+            }
+        }
+    }
+
+    group_starts[0] = 0;
+    for (g = 0; g < groups_count; g++) {
+        group_starts[g + 1] = group_starts[g] + group_sizes[g];
+        group_sizes[g] = group_starts[g];
+    }
+    for (c = 0; c < k; c++) {
+        group_members[group_sizes[centroid_groups[c]]++] = c;
+    }
+
+    free(group_sizes);
+    free(group_centers);
+}
+
+void init_kmeans_options(KmeansOptions *options) {
+    options -> algorithm = LLOYD;
+    options -> iter = DEFAULT_ITERATIONS_COUNT;
+    options -> epsilon = DEFAULT_EPSILON;
+    options -> batch_size = 0;
+    options -> seed = 0;
+    options -> threads_count = 0;
+}
+
+KmeansAlgorithm select_kmeans_algorithm(KmeansAlgorithm algorithm, size_t k,
+                                        size_t vector_size) {
+    if (algorithm != AUTO) {
+        return algorithm;
+    }
+    if (k <= AUTO_HAMERLY_MAX_K ||
+        (k <= AUTO_HAMERLY_MAX_K_LOW_DIMENSION &&
+         vector_size <= AUTO_LOW_DIMENSION)) {
+        return HAMERLY;
+    }
+    return YINYANG;
 }
 
 void fit(Cluster *clusters, Vector *vectors, size_t vectors_count,
          size_t vector_size, size_t k, size_t iter, double epsilon) {
-    size_t *cluster_mapping = (size_t *) calloc(vectors_count, sizeof(size_t));
+    KmeansOptions options;
+
+    init_kmeans_options(&options);
+    options.iter = iter;
+    options.epsilon = epsilon;
+    fit_with_options(clusters, vectors, vectors_count, vector_size, k,
+                     &options, NULL);
+}
+
+void fit_with_options(Cluster *clusters, Vector *vectors, size_t vectors_count,
+                      size_t vector_size, size_t k,
+                      const KmeansOptions *options,
+                      KmeansResult *result) {
+    size_t i;
+    KmeansState state;
+
+    state.vectors = vectors;
+    state.vectors_count = vectors_count;
+    state.vector_size = vector_size;
+    state.kernels = vector_kernels(vector_size);
+    state.k = k;
+    state.iter = options -> iter;
+    /* A non-positive epsilon can't be reached, like the unsquared check */
+    state.squared_epsilon = (options -> epsilon > 0) ?
+        options -> epsilon * options -> epsilon : 0.0;
+    state.batch_size = options -> batch_size;
+    state.seed = options -> seed;
+    state.threads_count = (options -> threads_count > 0) ?
+        options -> threads_count : default_threads_count();
+    state.block_size = (vectors_count + KMEANS_MAX_BLOCKS - 1) / KMEANS_MAX_BLOCKS;
+    state.block_size = (state.block_size < KMEANS_MIN_BLOCK_SIZE) ?
+        KMEANS_MIN_BLOCK_SIZE : state.block_size;
+    state.blocks_count = (vectors_count + state.block_size - 1) / state.block_size;
+    state.block_centroid_sums = (Vector) malloc(
+        state.blocks_count * k * vector_size * sizeof(double));
+    state.block_cluster_sizes = (size_t *) malloc(
+        state.blocks_count * k * sizeof(size_t));
+    state.reduction_stride = 1;
+    state.assign_block_vectors = NULL;
+    state.engine = NULL;
+    state.centroids = (Vector) malloc(k * vector_size * sizeof(double));
+    state.new_centroids = (Vector) malloc(k * vector_size * sizeof(double));
+    state.squared_centroid_shifts = (Vector) malloc(k * sizeof(double));
+    state.cluster_mapping = (size_t *) calloc(vectors_count, sizeof(size_t));
+    state.cluster_sizes = (size_t *) calloc(k, sizeof(size_t));
+    state.block_inertias = (Vector) malloc(state.blocks_count * sizeof(double));
+    state.iterations = 0;
+    state.converged = false;
+    state.statistics.distance_computations = 0;
+    state.statistics.skipped_distance_computations = 0;
+
+    for (i = 0; i < k; i++) {
+        memcpy(state.centroids + i * vector_size, clusters[i].centroid,
+               vector_size * sizeof(double));
+    }
+
+    if (options -> batch_size > 0) {
+        minibatch(&state);
+    } else {
+        switch (select_kmeans_algorithm(options -> algorithm, k, vector_size)) {
+        case ELKAN:
+            elkan(&state);
+            break;
+        case HAMERLY:
+            hamerly(&state);
+            break;
+        case YINYANG:
+            yinyang(&state);
+            break;
+        default:
+            lloyd(&state);
+            break;
+        }
+    }
+
+    for (i = 0; i < k; i++) {
+        memcpy(clusters[i].centroid, state.centroids + i * vector_size,
+               vector_size * sizeof(double));
+    }
+    if (result != NULL) {
+        /* The blocks partial sums are added in order, like the centroids */
+        parallel_for(state.blocks_count, state.threads_count, measure_block,
+                     &state);
+        result -> inertia = 0.0;
+        for (i = 0; i < state.blocks_count; i++) {
+            result -> inertia += state.block_inertias[i];
+        }
+
+        result -> labels = state.cluster_mapping;
+        result -> cluster_sizes = state.cluster_sizes;
+        result -> iterations = state.iterations;
+        result -> converged = state.converged;
+        result -> statistics = state.statistics;
+        state.cluster_mapping = NULL;
+        state.cluster_sizes = NULL;
+    }
+
+    free(state.centroids);
+    free(state.new_centroids);
+    free(state.squared_centroid_shifts);
+    free(state.cluster_mapping);
+    free(state.cluster_sizes);
+    free(state.block_centroid_sums);
+    free(state.block_cluster_sizes);
+    free(state.block_inertias);
+}
+
+void free_kmeans_result(KmeansResult *result) {
+    free(result -> labels);
+    free(result -> cluster_sizes);
+}
+
+size_t fit_multi(Cluster *clusters, Vector *vectors, size_t vectors_count,
+                 size_t vector_size, size_t k, size_t restarts_count,
+                 SeedingMode mode, const KmeansOptions *options,
+                 size_t *centroids_idxs, Vector inertias) {
+    size_t i, best_idx = 0, threads_count;
+    RestartsContext context;
+
+    threads_count = (options -> threads_count > 0) ?
+        options -> threads_count : default_threads_count();
+
+    context.vectors = vectors;
+    context.vectors_count = vectors_count;
+    context.vector_size = vector_size;
+    context.k = k;
+    context.mode = mode;
+    context.options = *options;
+    /* Threads left over by the restarts are split between their fits */
+    context.options.threads_count = (threads_count > restarts_count) ?
+        threads_count / restarts_count : 1;
+    context.restart_idxs = (size_t *) malloc(
+        restarts_count * k * sizeof(size_t));
+    context.restart_centroids = (Vector) malloc(
+        restarts_count * k * vector_size * sizeof(double));
+    context.inertias = (Vector) malloc(restarts_count * sizeof(double));
+
+    parallel_for(restarts_count, threads_count, run_restart, &context);
+
+    for (i = 1; i < restarts_count; i++) {
+        if (context.inertias[i] < context.inertias[best_idx]) {
+            best_idx = i;
+        }
+    }
+
+    for (i = 0; i < k; i++) {
+        memcpy(clusters[i].centroid,
+               context.restart_centroids + (best_idx * k + i) * vector_size,
+               vector_size * sizeof(double));
+    }
+    if (centroids_idxs != NULL) {
+        memcpy(centroids_idxs, context.restart_idxs + best_idx * k,
+               k * sizeof(size_t));
+    }
+    if (inertias != NULL) {
+        memcpy(inertias, context.inertias, restarts_count * sizeof(double));
+    }
+
+    free(context.restart_idxs);
+    free(context.restart_centroids);
+    free(context.inertias);
+    return best_idx;
+}
+
+void kmeanspp(Vector *vectors, size_t vectors_count, size_t vector_size,
+              size_t k, SeedingMode mode, RandomState *rs,
+              size_t *centroids_idxs) {
+    weighted_kmeanspp(vectors, NULL, vectors_count, vector_size, k, mode, rs,
+                      centroids_idxs);
+}
+
+void kmeans_parallel(Vector *vectors, size_t vectors_count, size_t vector_size,
+                     size_t k, size_t rounds, double oversampling_factor,
+                     RandomState *rs, size_t *centroids_idxs,
+                     size_t threads_count) {
+    size_t i, j, b, c, round, blocks_count, candidates_count = 0;
+    size_t *candidates_idxs = NULL, *chosen_candidates = NULL;
+    Vector candidates_weights = NULL;
+    Vector *candidates = NULL;
+    SamplingContext context;
+
+    if (rounds == 0) {
+        rounds = (size_t) ceil(log((double) vectors_count));
+        rounds = (rounds == 0) ? 1 : rounds;
+    }
+    if (oversampling_factor <= 0.0) {
+        oversampling_factor = KMEANS_PARALLEL_OVERSAMPLING * k;
+    }
+
+    /* The blocks only depend on vectors_count, like those of fit_with_options */
+    context.block_size = (vectors_count + KMEANS_MAX_BLOCKS - 1) /
+                         KMEANS_MAX_BLOCKS;
+    context.block_size = (context.block_size < KMEANS_MIN_BLOCK_SIZE) ?
+                         KMEANS_MIN_BLOCK_SIZE : context.block_size;
+    blocks_count = (vectors_count + context.block_size - 1) /
+                   context.block_size;
+
+    candidates_idxs = (size_t *) malloc(vectors_count * sizeof(size_t));
+    context.vectors = vectors;
+    context.vectors_count = vectors_count;
+    context.vector_size = vector_size;
+    context.distance_kernel = vector_kernels(vector_size) -> squared_distance;
+    context.candidates_idxs = candidates_idxs;
+    context.oversampling_factor = oversampling_factor;
+    context.nearest_candidate = (size_t *) calloc(vectors_count,
+                                                  sizeof(size_t));
+    context.min_distances = (Vector) malloc(vectors_count * sizeof(double));
+    context.block_costs = (Vector) malloc((blocks_count + 1) * sizeof(double));
+    context.sampled_idxs = (size_t *) malloc(vectors_count * sizeof(size_t));
+    context.block_samples_counts = (size_t *) malloc(
+        (blocks_count + 1) * sizeof(size_t));
+    for (j = 0; j < vectors_count; j++) {
+        context.min_distances[j] = INFINITY;
+    }
+
+    candidates_idxs[candidates_count++] = random_index(rs, vectors_count);
+    context.new_candidates_start = 0;
+
+    for (round = 0; round <= rounds; round++) {
+        /*
+         * Bring D(x) up to date against the candidates sampled in the previous
+         * round only, and compute the current cost of the candidate set. The
+         * blocks' costs are summed in order, so the cost doesn't depend on the
+         * number of threads.
+         */
+        context.candidates_count = candidates_count;
+        parallel_for(blocks_count, threads_count, update_sampling_block,
+                     &context);
+        context.cost = 0.0;
+        for (b = 0; b < blocks_count; b++) {
+            context.cost += context.block_costs[b];
+        }
+
+        if (round == rounds || context.cost == 0.0) {
+            break;
+        }
+
+        /* Sample every vector independently with probability l * D(x) / cost */
+        context.round_seed = random_uint32(rs);
+        parallel_for(blocks_count, threads_count, sample_block, &context);
+        context.new_candidates_start = candidates_count;
+        for (b = 0; b < blocks_count; b++) {
+            for (i = 0; i < context.block_samples_counts[b]; i++) {
+                candidates_idxs[candidates_count++] =
+                    context.sampled_idxs[b * context.block_size + i];
+            }
+        }
+    }
+
+    /* Weight each candidate by the number of vectors it's closest to */
+    candidates = (Vector *) malloc(candidates_count * sizeof(Vector));
+    candidates_weights = (Vector) calloc(candidates_count, sizeof(double));
+    for (c = 0; c < candidates_count; c++) {
+        candidates[c] = vectors[candidates_idxs[c]];
+    }
+    for (j = 0; j < vectors_count; j++) {
+        candidates_weights[context.nearest_candidate[j]] += 1.0;
+    }
+
+    chosen_candidates = (size_t *) malloc(k * sizeof(size_t));
+    if (candidates_count >= k) {
+        weighted_kmeanspp(candidates, candidates_weights, candidates_count,
+                          vector_size, k, STANDARD_SEEDING, rs,
+                          chosen_candidates);
+        for (i = 0; i < k; i++) {
+            centroids_idxs[i] = candidates_idxs[chosen_candidates[i]];
+        }
+    } else {
+        complete_candidates(&context, blocks_count, k, rs, &candidates_count,
+                            threads_count);
+        memcpy(centroids_idxs, candidates_idxs, k * sizeof(size_t));
+    }
+
+    free(chosen_candidates);
+    free(candidates_weights);
+    free(candidates);
+    free(context.block_samples_counts);
+    free(context.sampled_idxs);
+    free(context.block_costs);
+    free(context.min_distances);
+    free(context.nearest_candidate);
+    free(candidates_idxs);
+}
+
+static void update_sampling_block(void *context, size_t block_idx) {
+    SamplingContext *sampling = (SamplingContext *) context;
+    size_t j, c, start = block_idx * sampling -> block_size;
+    size_t end = start + sampling -> block_size;
+    double distance, cost = 0.0;
+
+    end = (end < sampling -> vectors_count) ? end : sampling -> vectors_count;
+    for (j = start; j < end; j++) {
+        for (c = sampling -> new_candidates_start;
+             c < sampling -> candidates_count; c++) {
+            distance = sampling -> distance_kernel(
+                sampling -> vectors[j],
+                sampling -> vectors[sampling -> candidates_idxs[c]],
+                sampling -> vector_size);
+            if (distance < sampling -> min_distances[j]) {
+                sampling -> min_distances[j] = distance;
+                sampling -> nearest_candidate[j] = c;
+            }
+        }
+        cost += sampling -> min_distances[j];
+    }
+    sampling -> block_costs[block_idx] = cost;
+}
+
+/**
+ * Complete the candidates of kmeans_parallel to k with K-means++ draws over
+ * all the vectors, proportionally to D(x), which is 0 for the candidates so
+ * none of them is drawn again. This happens when the rounds sampled fewer
+ * than k candidates, as a small oversampling_factor or few rounds can do.
+ * Only once every vector is at distance 0 from the candidates, meaning there
+ * are fewer than k distinct vectors, are the rest drawn uniformly among the
+ * vectors that aren't candidates yet, which duplicates some of them.
+ */
+static void complete_candidates(SamplingContext *context, size_t blocks_count,
+                                size_t k, RandomState *rs,
+                                size_t *candidates_count,
+                                size_t threads_count) {
+    size_t j, b, skipped, chosen_idx = 0, n = context -> vectors_count;
+    size_t *candidates_idxs = context -> candidates_idxs;
+    double target, cost;
+    bool *is_candidate = (bool *) calloc(n, sizeof(bool));
+
+    for (j = 0; j < *candidates_count; j++) {
+        is_candidate[candidates_idxs[j]] = true;
+    }
+
+    while (*candidates_count < k) {
+        cost = 0.0;
+        for (b = 0; b < blocks_count; b++) {
+            cost += context -> block_costs[b];
+        }
+
+        if (cost > 0.0) {
+            target = random_double(rs) * cost;
+            for (j = 0; j < n; j++) {
+                if (context -> min_distances[j] > 0.0) {
+                    chosen_idx = j;
+                    if (target < context -> min_distances[j]) {
+                        break;
+                    }
+                    target -= context -> min_distances[j];
+                }
+            }
+        } else {
+            skipped = random_index(rs, n - *candidates_count);
+            for (j = 0; j < n; j++) {
+                if (!is_candidate[j]) {
+                    chosen_idx = j;
+                    if (skipped == 0) {
+                        break;
+                    }
+                    skipped--;
+                }
+            }
+        }
+
+        is_candidate[chosen_idx] = true;
+        candidates_idxs[(*candidates_count)++] = chosen_idx;
+        context -> new_candidates_start = *candidates_count - 1;
+        context -> candidates_count = *candidates_count;
+        parallel_for(blocks_count, threads_count, update_sampling_block,
+                     context);
+    }
+
+    free(is_candidate);
+}
+
+static void sample_block(void *context, size_t block_idx) {
+    SamplingContext *sampling = (SamplingContext *) context;
+    size_t j, count = 0, start = block_idx * sampling -> block_size;
+    size_t end = start + sampling -> block_size;
+    RandomState rs;
+
+    end = (end < sampling -> vectors_count) ? end : sampling -> vectors_count;
+    seed_random_state(&rs, sampling -> round_seed + (uint32_t) block_idx);
+    for (j = start; j < end; j++) {
+        if (random_double(&rs) * sampling -> cost <
+            sampling -> oversampling_factor * sampling -> min_distances[j]) {
+            sampling -> sampled_idxs[start + count++] = j;
+        }
+    }
+    sampling -> block_samples_counts[block_idx] = count;
+}
+
+static void weighted_kmeanspp(Vector *vectors, Vector vector_weights,
+                              size_t vectors_count, size_t vector_size,
+                              size_t k, SeedingMode mode, RandomState *rs,
+                              size_t *centroids_idxs) {
     size_t i, j;
-    bool done = false;
+    double distance, total_weight = 0.0;
+    SquaredDistanceKernel distance_kernel =
+        vector_kernels(vector_size) -> squared_distance;
+    Vector centroid = NULL;
+    Vector min_distances = (Vector) malloc(vectors_count * sizeof(double));
+    Vector weights = (Vector) malloc(vectors_count * sizeof(double));
+    Vector cumulative_weights = (Vector) malloc(vectors_count * sizeof(double));
+
+    for (j = 0; j < vectors_count; j++) {
+        min_distances[j] = INFINITY;
+    }
 
-    for (i = 0; i < iter && !done; i++) {
+    if (vector_weights == NULL) {
+        centroids_idxs[0] = random_index(rs, vectors_count);
+    } else {
         for (j = 0; j < vectors_count; j++) {
-            cluster_mapping[j] = assign_vector_to_cluster(vectors[j], clusters, vector_size, k);
+            total_weight += vector_weights[j];
+            cumulative_weights[j] = total_weight;
         }
+        centroids_idxs[0] = search_cumulative_weights(
+            cumulative_weights, vectors_count,
+            random_double(rs) * total_weight);
+    }
 
-        done = true;
-        for (j = 0; j < k; j++) {
-            done &= update_centroid_of_cluster(&clusters[j], vectors, cluster_mapping, j, vectors_count, vector_size, epsilon);
+    for (i = 1; i < k; i++) {
+        /*
+         * Only the distances to the newest centroid can lower D(x), so a single
+         * pass updates D(x) and builds its prefix sums at the same time.
+         */
+        centroid = vectors[centroids_idxs[i - 1]];
+        total_weight = 0.0;
+        for (j = 0; j < vectors_count; j++) {
+            distance = distance_kernel(vectors[j], centroid, vector_size);
+            if (distance < min_distances[j]) {
+                min_distances[j] = distance;
+                weights[j] = (mode == NUMPY_COMPATIBLE_SEEDING) ? sqrt(distance)
+                                                                : distance;
+                if (vector_weights != NULL) {
+                    weights[j] *= vector_weights[j];
+                }
+            }
+            total_weight += weights[j];
+            cumulative_weights[j] = total_weight;
         }
+
+        if (total_weight == 0.0) {
+            centroids_idxs[i] = random_index(rs, vectors_count);
+            continue;
+        }
+
+        /* Same as np.random.choice(N, p=weights / sum(weights)) */
+        centroids_idxs[i] = search_cumulative_weights(
+            cumulative_weights, vectors_count,
+            random_double(rs) * total_weight);
+    }
+
+    free(min_distances);
+    free(weights);
+    free(cumulative_weights);
+}
+
+static void run_restart(void *context, size_t restart_idx) {
+    RestartsContext *restarts = (RestartsContext *) context;
+    size_t i, k = restarts -> k, d = restarts -> vector_size;
+    size_t *idxs = restarts -> restart_idxs + restart_idx * k;
+    Vector centroids = restarts -> restart_centroids + restart_idx * k * d;
+    Cluster *clusters = (Cluster *) malloc(k * sizeof(Cluster));
+    KmeansOptions options = restarts -> options;
+    KmeansResult result;
+    RandomState rs;
+
+    options.seed += (uint32_t) restart_idx;
+    seed_random_state(&rs, options.seed);
+    kmeanspp(restarts -> vectors, restarts -> vectors_count, d, k,
+             restarts -> mode, &rs, idxs);
+
+    for (i = 0; i < k; i++) {
+        clusters[i].centroid = centroids + i * d;
+        memcpy(clusters[i].centroid, restarts -> vectors[idxs[i]],
+               d * sizeof(double));
     }
 
-    free(cluster_mapping);
+    fit_with_options(clusters, restarts -> vectors, restarts -> vectors_count,
+                     d, k, &options, &result);
+    restarts -> inertias[restart_idx] = result.inertia;
+
+    free_kmeans_result(&result);
+    free(clusters);
+}
+
+static size_t search_cumulative_weights(Vector cumulative_weights,
+                                        size_t count, double value) {
+    size_t low = 0, high = count - 1, middle;
+
+    while (low < high) {
+        middle = low + (high - low) / 2;
+        if (cumulative_weights[middle] > value) {
+            high = middle;
+        } else {
+            low = middle + 1;
+        }
+    }
+    return low;
 }
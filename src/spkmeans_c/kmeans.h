@@ -1,6 +1,7 @@
 #ifndef KMEANS_H
 #define KMEANS_H
 
+#include "rng.h"
 #include "vector.h"
 #include <stdbool.h>
 #include <stddef.h>
@@ -8,19 +9,174 @@
 
 #define DEFAULT_ITERATIONS_COUNT 300
 #define DEFAULT_EPSILON 0
+#define KMEANS_PARALLEL_OVERSAMPLING 2
+
+typedef enum SeedingMode {
+    STANDARD_SEEDING,
+    NUMPY_COMPATIBLE_SEEDING
+} SeedingMode;
+
+typedef enum KmeansAlgorithm {
+    LLOYD,
+    ELKAN,
+    HAMERLY,
+    YINYANG,
+    AUTO
+} KmeansAlgorithm;
 
 typedef struct Cluster {
     Vector centroid;
 } Cluster;
 
+typedef struct KmeansOptions {
+    KmeansAlgorithm algorithm;
+    size_t iter;
+    double epsilon;
+    size_t batch_size;
+    uint32_t seed;
+    size_t threads_count;
+} KmeansOptions;
+
+/**
+ * Counters of the vector to centroid distances an engine computed, and of
+ * those it skipped out of the vectors_count * k per iteration Lloyd's
+ * algorithm computes.
+ */
+typedef struct KmeansStatistics {
+    size_t distance_computations;
+    size_t skipped_distance_computations;
+} KmeansStatistics;
+
+/**
+ * The outcome of a fit besides the centroids: the cluster every vector was
+ * assigned to in the last assignment step (vectors_count labels), the number
+ * of vectors in every cluster (k sizes), the inertia (the sum of squared
+ * distances of the vectors from the final centroids of their clusters), the
+ * number of iterations run, whether they stopped because all centroids moved
+ * less than epsilon, and the distance computations counters.
+ */
+typedef struct KmeansResult {
+    size_t *labels;
+    size_t *cluster_sizes;
+    double inertia;
+    size_t iterations;
+    bool converged;
+    KmeansStatistics statistics;
+} KmeansResult;
+
+/**
+ * Receive a KmeansOptions instance and set it to the default options, which
+ * run Lloyd's algorithm on the full dataset for DEFAULT_ITERATIONS_COUNT
+ * iterations with DEFAULT_EPSILON, using a thread per online processor.
+ */
+void init_kmeans_options(KmeansOptions *options);
+
+/**
+ * Receive an algorithm, the value k and the size of each vector, and return the
+ * engine fit_with_options runs for them. For AUTO, HAMERLY is chosen for small
+ * k (or moderate k with low dimension), where its O(n) bounds are the
+ * cheapest, and YINYANG otherwise, keeping the bounds memory at O(n * k / 10)
+ * instead of ELKAN's O(n * k).
+ */
+KmeansAlgorithm select_kmeans_algorithm(KmeansAlgorithm algorithm, size_t k,
+                                        size_t vector_size);
+
 /**
  * Receive an array of initial clusters, an array of vectors to
  * cluster, the number of vectors, the size of each vector, the value k, number
  * of iterations and an epsilon value, and partition the vectors to clusters,
- * using the K-means algorithm. The return value is void, and the new clusters
- * are set in the passed clusters array.
+ * using the K-means algorithm. The return value is void, and the new centroids
+ * are copied into the centroids of the passed clusters array.
+ * Each iteration sums the vectors of all clusters in a single pass, and the
+ * algorithm stops early once no centroid moved by epsilon or more.
  */
 void fit(Cluster *clusters, Vector *vectors, size_t vectors_count,
          size_t vector_size, size_t k, size_t iter, double epsilon);
 
+/**
+ * The same as fit, but the number of iterations, epsilon and the engine
+ * running the iterations are taken from the passed options. All engines give
+ * the same clusters as LLOYD, but skip distance computations using the
+ * triangle inequality:
+ * - ELKAN keeps an upper bound and k lower bounds per vector.
+ * - HAMERLY keeps an upper bound and a single lower bound per vector.
+ * - YINYANG splits the centroids to k / 10 groups, and keeps an upper bound
+ *   and a lower bound per group for every vector.
+ * - AUTO picks one of the above using select_kmeans_algorithm.
+ * If batch_size is positive, the algorithm is ignored, and mini-batch K-means
+ * runs instead: every iteration moves the centroids towards batch_size vectors
+ * sampled with a generator seeded by seed, using a per-centroid learning rate
+ * of 1 / (number of vectors assigned to the centroid so far). The clusters
+ * are close to those of the full algorithm, but not the same.
+ * The assignment step of the full engines, bounds updates included, and the
+ * update step of all engines are split to fixed blocks of vectors over
+ * threads_count threads (or one per online processor if 0), and the results
+ * don't depend on the number of threads.
+ * If result isn't NULL, it's set with the outcome of the fit, and its labels
+ * and cluster_sizes arrays are allocated, to be freed with free_kmeans_result.
+ */
+void fit_with_options(Cluster *clusters, Vector *vectors, size_t vectors_count,
+                      size_t vector_size, size_t k,
+                      const KmeansOptions *options,
+                      KmeansResult *result);
+
+/**
+ * Receive a KmeansResult set by fit_with_options, and free its arrays.
+ */
+void free_kmeans_result(KmeansResult *result);
+
+/**
+ * Receive the same arguments as fit_with_options, a number of restarts and a
+ * seeding mode, and run restarts_count independent K-means++ seedings and fits
+ * concurrently, over options -> threads_count threads (or one per online
+ * processor if 0). Restart r seeds its random state, and its mini-batches,
+ * with options -> seed + r, so with NUMPY_COMPATIBLE_SEEDING and seed 0 the
+ * first restart reproduces kmeanspp.py. The vectors are only read.
+ * The centroids of the restart with the lowest inertia are set in clusters,
+ * and the index of that restart is returned. If centroids_idxs isn't NULL, the
+ * k initial centroids indices of that restart are set in it, and if inertias
+ * isn't NULL, the inertia of every restart is set in it.
+ */
+size_t fit_multi(Cluster *clusters, Vector *vectors, size_t vectors_count,
+                 size_t vector_size, size_t k, size_t restarts_count,
+                 SeedingMode mode, const KmeansOptions *options,
+                 size_t *centroids_idxs, Vector inertias);
+
+/**
+ * Receive an array of vectors, the number of vectors, the size of each vector,
+ * the value k, a seeding mode and a random state, and choose k initial
+ * centroids out of the vectors using the K-means++ algorithm. The indices of
+ * the chosen vectors are set in the passed centroids_idxs array, which must be
+ * able to hold k values.
+ * In STANDARD_SEEDING mode, vectors are sampled proportionally to their squared
+ * distance from the closest chosen centroid. In NUMPY_COMPATIBLE_SEEDING mode,
+ * they are sampled proportionally to the distance itself, so a random state
+ * seeded like np.random.seed reproduces the choices of kmeanspp.py.
+ */
+void kmeanspp(Vector *vectors, size_t vectors_count, size_t vector_size,
+              size_t k, SeedingMode mode, RandomState *rs,
+              size_t *centroids_idxs);
+
+/**
+ * Receive an array of vectors, the number of vectors, the size of each vector,
+ * the value k, the number of rounds, an oversampling factor and a random state,
+ * and choose k initial centroids out of the vectors using the K-means||
+ * (scalable K-means++) algorithm. The indices of the chosen vectors are set in
+ * the passed centroids_idxs array, which must be able to hold k values.
+ * Each round passes once over the vectors, and samples every vector
+ * independently with probability proportional to its squared distance from the
+ * candidates chosen so far, oversampling_factor candidates in expectation. The
+ * weighted candidates are then reclustered down to k with K-means++.
+ * The passes are split to the fixed blocks of fit_with_options over
+ * threads_count threads (or one per online processor if 0), and every block
+ * samples with a random state of its own, seeded from rs every round, so the
+ * choices don't depend on the number of threads.
+ * If rounds is 0, ceil(ln(vectors_count)) rounds are used, and if
+ * oversampling_factor isn't positive, KMEANS_PARALLEL_OVERSAMPLING * k is used.
+ */
+void kmeans_parallel(Vector *vectors, size_t vectors_count, size_t vector_size,
+                     size_t k, size_t rounds, double oversampling_factor,
+                     RandomState *rs, size_t *centroids_idxs,
+                     size_t threads_count);
+
 #endif
@@ -0,0 +1,346 @@
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "jacobi.h"
+#include "lanczos.h"
+#include "rng.h"
+
+/**
+ * A residual this small relative to the product it was taken from means the
+ * basis already spans an invariant subspace, so a random vector replaces it.
+ */
+#define BREAKDOWN_TOLERANCE 1e-12
+
+typedef struct RitzValue {
+    double value;
+    size_t idx;
+} RitzValue;
+
+static void _dense_eigenpairs(LinearOperator op, void *context, size_t n,
+                              LanczosResult *result);
+static void _ritz_pairs(Vector projection, size_t size, size_t total,
+                        JacobiBatchResult **ritz, RitzValue *order,
+                        Vector residuals);
+static void _combine_basis(Matrix basis, const JacobiBatchResult *ritz,
+                           const RitzValue *order, size_t count, size_t size,
+                           size_t n, Matrix combined);
+static void _add_basis_vector(Matrix basis, size_t count, size_t n, Vector w,
+                              double product_norm, Vector projections,
+                              RandomState *rs);
+static void _orthogonalize(Matrix basis, size_t count, size_t n, Vector w,
+                           Vector projections);
+static double _dot(const double *x, const double *y, size_t n);
+static int _compare_ritz_values(const void *a, const void *b);
+
+void init_lanczos_options(LanczosOptions *options) {
+    options -> krylov_size = 0;
+    options -> max_restarts = LANCZOS_DEFAULT_MAX_RESTARTS;
+    options -> tolerance = LANCZOS_DEFAULT_TOLERANCE;
+    options -> seed = 0;
+}
+
+LanczosResult *lanczos(LinearOperator op, void *context, size_t n, size_t k,
+                       const LanczosOptions *options) {
+    size_t i, j, r, count, kept, size, block_size, total;
+    double scale, product_norm;
+    bool converged;
+    Matrix basis = NULL, combined = NULL;
+    Vector w = NULL, projections = NULL, projection = NULL, residuals = NULL;
+    RitzValue *order = NULL;
+    JacobiBatchResult *ritz = NULL;
+    LanczosResult *result = (LanczosResult *) malloc(sizeof(LanczosResult));
+    RandomState rs;
+
+    k = (k < n) ? k : n;
+    result -> k = k;
+    result -> eigenvalues = (Vector) calloc(k + 1, sizeof(double));
+    result -> eigenvectors = build_matrix(k, n);
+    result -> converged = true;
+    result -> restarts = 0;
+    result -> products = 0;
+    if (k == 0) {
+        return result;
+    }
+
+    /*
+     * The basis starts from a block of k vectors, so an eigenvalue repeated up
+     * to k times (like the zero eigenvalue of a graph with k components) has
+     * all of its eigenvectors found, which a single start vector can't do.
+     */
+    block_size = k;
+    size = (options -> krylov_size > 0) ? options -> krylov_size :
+           4 * k + LANCZOS_MIN_KRYLOV_SIZE;
+    size = (size > 2 * k + 1) ? size : 2 * k + 1;
+    if (size + block_size >= n) {
+        _dense_eigenpairs(op, context, n, result);
+        return result;
+    }
+
+    total = size + block_size;
+    basis = build_matrix(total, n);
+    combined = build_matrix(size, n);
+    w = (Vector) malloc(n * sizeof(double));
+    projections = (Vector) calloc(total, sizeof(double));
+    projection = (Vector) calloc(total * total, sizeof(double));
+    residuals = (Vector) malloc(size * sizeof(double));
+    order = (RitzValue *) malloc(size * sizeof(RitzValue));
+    seed_random_state(&rs, options -> seed);
+
+    for (count = 0; count < block_size; count++) {
+        memset(w, 0, n * sizeof(double));
+        _add_basis_vector(basis, count, n, w, 0.0, projections, &rs);
+    }
+
+    /*
+     * Every basis vector's product is orthogonalized against the whole basis,
+     * and the projections it had onto it are its column of the projected
+     * matrix, so the projected matrix stays exact across restarts.
+     */
+    j = 0;
+    for (;;) {
+        for (; j < size; j++) {
+            op(context, basis[j], w);
+            result -> products++;
+            product_norm = sqrt(_dot(w, w, n));
+            for (i = 0; i < count; i++) {
+                projections[i] = 0.0;
+            }
+            _orthogonalize(basis, count, n, w, projections);
+            for (i = 0; i < count; i++) {
+                projection[i * total + j] = projections[i];
+                projection[j * total + i] = projections[i];
+            }
+            _add_basis_vector(basis, count, n, w, product_norm, projections,
+                              &rs);
+            projection[count * total + j] = projections[count];
+            projection[j * total + count] = projections[count];
+            count++;
+        }
+
+        _ritz_pairs(projection, size, total, &ritz, order, residuals);
+        scale = (fabs(order[0].value) > fabs(order[size - 1].value)) ?
+                fabs(order[0].value) : fabs(order[size - 1].value);
+        converged = true;
+        for (i = 0; i < k; i++) {
+            converged = converged &&
+                        residuals[i] <= options -> tolerance * scale;
+        }
+        if (converged || result -> restarts >= options -> max_restarts) {
+            break;
+        }
+
+        /* Restart from the Ritz vectors of the smallest Ritz values */
+        kept = k + (size - k - block_size) / 2;
+        _combine_basis(basis, ritz, order, kept, size, n, combined);
+        memcpy(matrix_values(basis, total), matrix_values(combined, size),
+               kept * n * sizeof(double));
+        for (r = 0; r < block_size; r++) {
+            memcpy(basis[kept + r], basis[size + r], n * sizeof(double));
+        }
+        memset(projection, 0, total * total * sizeof(double));
+        for (i = 0; i < kept; i++) {
+            projection[i * total + i] = order[i].value;
+        }
+        free_jacobi_batch_result(ritz);
+        j = kept;
+        count = kept + block_size;
+        result -> restarts++;
+    }
+
+    result -> converged = converged;
+    _combine_basis(basis, ritz, order, k, size, n, result -> eigenvectors);
+    for (i = 0; i < k; i++) {
+        result -> eigenvalues[i] = order[i].value;
+    }
+
+    free_jacobi_batch_result(ritz);
+    free(order);
+    free(residuals);
+    free(projection);
+    free(projections);
+    free(w);
+    free_matrix(combined, size);
+    free_matrix(basis, total);
+    return result;
+}
+
+void free_lanczos_result(LanczosResult *result) {
+    free(result -> eigenvalues);
+    free_matrix(result -> eigenvectors, result -> k);
+    free(result);
+}
+
+/**
+ * Find the eigenpairs of an operator too small for a Krylov basis to save
+ * anything, from its dense matrix.
+ */
+static void _dense_eigenpairs(LinearOperator op, void *context, size_t n,
+                              LanczosResult *result) {
+    size_t i, j;
+    Vector dense = (Vector) calloc(n * n, sizeof(double));
+    Vector unit = (Vector) calloc(n, sizeof(double));
+    Vector column = (Vector) malloc(n * sizeof(double));
+    RitzValue *order = (RitzValue *) malloc(n * sizeof(RitzValue));
+    JacobiBatchResult *eigenpairs = NULL;
+
+    for (j = 0; j < n; j++) {
+        unit[j] = 1.0;
+        op(context, unit, column);
+        unit[j] = 0.0;
+        for (i = 0; i < n; i++) {
+            dense[i * n + j] += column[i] / 2;
+            dense[j * n + i] += column[i] / 2;
+        }
+    }
+    result -> products = n;
+
+    eigenpairs = jacobi_batched(dense, 1, n, 1);
+    for (i = 0; i < n; i++) {
+        order[i].value = eigenpairs -> eigenvalues[i];
+        order[i].idx = i;
+    }
+    qsort(order, n, sizeof(RitzValue), _compare_ritz_values);
+    for (i = 0; i < result -> k; i++) {
+        result -> eigenvalues[i] = order[i].value;
+        memcpy(result -> eigenvectors[i],
+               eigenpairs -> eigenvectors + order[i].idx * n,
+               n * sizeof(double));
+    }
+    result -> converged = eigenpairs -> converged[0];
+
+    free_jacobi_batch_result(eigenpairs);
+    free(order);
+    free(column);
+    free(unit);
+    free(dense);
+}
+
+/**
+ * Find the eigenpairs of the leading size x size block of the projected
+ * matrix, whose rows are total entries apart, order them by their values, and
+ * set residuals to the norms of their Ritz vectors' residuals, which are the
+ * products of their eigenvectors and the block below it.
+ */
+static void _ritz_pairs(Vector projection, size_t size, size_t total,
+                        JacobiBatchResult **ritz, RitzValue *order,
+                        Vector residuals) {
+    size_t i, r;
+    double coupling;
+    const double *eigenvector = NULL;
+    Vector block = (Vector) malloc(size * size * sizeof(double));
+
+    for (i = 0; i < size; i++) {
+        memcpy(block + i * size, projection + i * total,
+               size * sizeof(double));
+    }
+    *ritz = jacobi_batched(block, 1, size, 1);
+    for (i = 0; i < size; i++) {
+        order[i].value = (*ritz) -> eigenvalues[i];
+        order[i].idx = i;
+    }
+    qsort(order, size, sizeof(RitzValue), _compare_ritz_values);
+
+    for (i = 0; i < size; i++) {
+        eigenvector = (*ritz) -> eigenvectors + order[i].idx * size;
+        residuals[i] = 0.0;
+        for (r = size; r < total; r++) {
+            coupling = _dot(projection + r * total, eigenvector, size);
+            residuals[i] += coupling * coupling;
+        }
+        residuals[i] = sqrt(residuals[i]);
+    }
+
+    free(block);
+}
+
+/**
+ * Set the first count rows of combined to the Ritz vectors of the count
+ * smallest Ritz values, as combinations of the first size basis vectors.
+ */
+static void _combine_basis(Matrix basis, const JacobiBatchResult *ritz,
+                           const RitzValue *order, size_t count, size_t size,
+                           size_t n, Matrix combined) {
+    size_t i, j, l;
+    double coefficient;
+    const double *eigenvector = NULL;
+
+    for (i = 0; i < count; i++) {
+        eigenvector = ritz -> eigenvectors + order[i].idx * size;
+        memset(combined[i], 0, n * sizeof(double));
+        for (j = 0; j < size; j++) {
+            coefficient = eigenvector[j];
+            for (l = 0; l < n; l++) {
+                combined[i][l] += coefficient * basis[j][l];
+            }
+        }
+    }
+}
+
+/**
+ * Make w, already orthogonal to the first count basis vectors, basis vector
+ * count, and set projections[count] to its norm before it was normalized. If
+ * it's negligible next to the norm of the product it was taken from, the basis
+ * spans an invariant subspace, so a random vector orthogonal to the basis
+ * replaces it, and its norm is 0.
+ */
+static void _add_basis_vector(Matrix basis, size_t count, size_t n, Vector w,
+                              double product_norm, Vector projections,
+                              RandomState *rs) {
+    size_t l;
+    double norm = sqrt(_dot(w, w, n));
+
+    if (norm > BREAKDOWN_TOLERANCE * product_norm && norm > 0) {
+        for (l = 0; l < n; l++) {
+            basis[count][l] = w[l] / norm;
+        }
+        projections[count] = norm;
+        return;
+    }
+
+    for (l = 0; l < n; l++) {
+        w[l] = random_double(rs) - 0.5;
+    }
+    _orthogonalize(basis, count, n, w, projections);
+    norm = sqrt(_dot(w, w, n));
+    for (l = 0; l < n; l++) {
+        basis[count][l] = w[l] / norm;
+    }
+    projections[count] = 0.0;
+}
+
+/**
+ * Subtract from w its projections onto the first count basis vectors, twice
+ * so the rounding errors of the first pass don't leave w off orthogonal, and
+ * add the projections to the first count entries of projections.
+ */
+static void _orthogonalize(Matrix basis, size_t count, size_t n, Vector w,
+                           Vector projections) {
+    size_t i, l, pass;
+    double projected;
+
+    for (pass = 0; pass < 2; pass++) {
+        for (i = 0; i < count; i++) {
+            projected = _dot(w, basis[i], n);
+            projections[i] += projected;
+            for (l = 0; l < n; l++) {
+                w[l] -= projected * basis[i][l];
+            }
+        }
+    }
+}
+
+static double _dot(const double *x, const double *y, size_t n) {
+    size_t l;
+    double sum = 0.0;
+
+    for (l = 0; l < n; l++) {
+        sum += x[l] * y[l];
+    }
+    return sum;
+}
+
+static int _compare_ritz_values(const void *a, const void *b) {
+    double x = ((const RitzValue *) a) -> value;
+    double y = ((const RitzValue *) b) -> value;
+    return (x > y) - (y > x);
+}
@@ -0,0 +1,74 @@
+#ifndef LANCZOS_H
+#define LANCZOS_H
+
+#include "matrix.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define LANCZOS_MIN_KRYLOV_SIZE 24
+#define LANCZOS_DEFAULT_MAX_RESTARTS 200
+#define LANCZOS_DEFAULT_TOLERANCE 1e-10
+
+/**
+ * A symmetric linear operator of order n, given by its products with vectors:
+ * it receives its context and a vector x of length n, and sets y to the
+ * product of the operator and x.
+ */
+typedef void (*LinearOperator)(void *context, const double *x, Vector y);
+
+/**
+ * The options of lanczos: the number of basis vectors kept between restarts
+ * (0 picks one from k), the maximal number of restarts, the tolerance of the
+ * residuals relative to the largest eigenvalue found, and the seed of the
+ * random start vector.
+ */
+typedef struct LanczosOptions {
+    size_t krylov_size;
+    size_t max_restarts;
+    double tolerance;
+    uint32_t seed;
+} LanczosOptions;
+
+/**
+ * The result of lanczos: the k smallest eigenvalues in ascending order, and
+ * the k x n matrix of their unit eigenvectors, meaning row i is the
+ * eigenvector of eigenvalue i. converged tells whether all the residuals got
+ * within the tolerance before the restarts limit, restarts is the number of
+ * restarts it took, and products is the number of products with the operator.
+ */
+typedef struct LanczosResult {
+    size_t k;
+    Vector eigenvalues;
+    Matrix eigenvectors;
+    bool converged;
+    size_t restarts;
+    size_t products;
+} LanczosResult;
+
+/**
+ * Receive Lanczos options and set them to the defaults.
+ */
+void init_lanczos_options(LanczosOptions *options);
+
+/**
+ * Receive a symmetric linear operator, its context, its order n, a number k
+ * of eigenpairs and Lanczos options, and find the k smallest eigenvalues of
+ * the operator and their eigenvectors with the thick-restart Lanczos method.
+ * The operator is only used through its products with vectors, so it never
+ * has to be stored densely. Every new basis vector is orthogonalized against
+ * all the others, the eigenpairs of the small projected matrix are found with
+ * jacobi_batched, and the basis is restarted from the Ritz vectors of the
+ * smallest Ritz values until their residuals are small enough. The function
+ * allocates memory for the result, so it's the caller's responsibility to
+ * free it with free_lanczos_result.
+ */
+LanczosResult *lanczos(LinearOperator op, void *context, size_t n, size_t k,
+                       const LanczosOptions *options);
+
+/**
+ * Receive a result of lanczos and free it.
+ */
+void free_lanczos_result(LanczosResult *result);
+
+#endif
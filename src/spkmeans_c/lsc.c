@@ -0,0 +1,247 @@
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "csr.h"
+#include "jacobi.h"
+#include "kdtree.h"
+#include "kmeans.h"
+#include "lsc.h"
+#include "parallel.h"
+#include "rng.h"
+
+#define LSC_ROWS_PER_TASK 256
+
+/**
+ * The shared context of the coding tasks of lsc. Every task finds the nearest
+ * landmarks of the datapoints of its rows, and fills their rows of z, which
+ * all have the same number of entries.
+ */
+typedef struct LscContext {
+    Matrix data_points;
+    size_t n;
+    const KdTree *tree;
+    size_t nearest_landmarks;
+    CsrMatrix *z;
+} LscContext;
+
+typedef struct LscEigenvalue {
+    double value;
+    size_t idx;
+} LscEigenvalue;
+
+static void _choose_landmarks(Matrix data_points, size_t n, size_t m,
+                              size_t landmarks_count,
+                              const LscOptions *options, size_t threads_count,
+                              Matrix landmarks);
+static void _code_rows(void *context, size_t task_idx);
+static void _sort_row(size_t *columns, Vector values, size_t count);
+static int _compare_descending_eigenvalues(const void *a, const void *b);
+
+void init_lsc_options(LscOptions *options) {
+    options -> landmarks_count = LSC_DEFAULT_LANDMARKS_COUNT;
+    options -> nearest_landmarks = LSC_DEFAULT_NEAREST_LANDMARKS;
+    options -> seed = 0;
+}
+
+LscResult *lsc(Matrix data_points, size_t n, size_t m, size_t count,
+               const LscOptions *options, size_t threads_count) {
+    size_t i, a, b, e, j, p, r, start, end, tasks_count;
+    double norm;
+    Vector column_scales = NULL, gram = NULL, eigenvector = NULL;
+    LscEigenvalue *order = NULL;
+    JacobiBatchResult *eigenpairs = NULL;
+    KdTree *tree = NULL;
+    LscContext context;
+    LscResult *result = (LscResult *) malloc(sizeof(LscResult));
+
+    p = (options -> landmarks_count < n) ? options -> landmarks_count : n;
+    r = (options -> nearest_landmarks < p) ? options -> nearest_landmarks : p;
+    r = (r > 0) ? r : 1;
+    count = (count < p) ? count : p;
+    result -> count = count;
+    result -> landmarks_count = p;
+    result -> landmarks = build_matrix(p, m);
+    result -> eigenvalues = (Vector) calloc(count + 1, sizeof(double));
+    result -> eigenvectors = build_matrix(count, n);
+    if (p == 0) {
+        return result;
+    }
+    _choose_landmarks(data_points, n, m, p, options, threads_count,
+                      result -> landmarks);
+
+    tree = build_kd_tree(result -> landmarks, p, m);
+    context.data_points = data_points;
+    context.n = n;
+    context.tree = tree;
+    context.nearest_landmarks = r;
+    context.z = build_csr_matrix(n, p, n * r);
+    for (i = 0; i <= n; i++) {
+        context.z -> row_starts[i] = i * r;
+    }
+    tasks_count = (n + LSC_ROWS_PER_TASK - 1) / LSC_ROWS_PER_TASK;
+    parallel_for(tasks_count, threads_count, _code_rows, &context);
+    free_kd_tree(tree);
+
+    /*
+     * Z becomes Z D^-1/2, so the rows of Z' Z'^T sum to 1: the row sums of Z
+     * are 1, and Z'^T 1 = D^-1/2 Z^T 1 = D^1/2 1. A landmark no datapoint is
+     * coded by has an empty column, which stays empty.
+     */
+    column_scales = (Vector) calloc(p, sizeof(double));
+    for (e = 0; e < n * r; e++) {
+        column_scales[context.z -> columns[e]] += context.z -> values[e];
+    }
+    for (b = 0; b < p; b++) {
+        column_scales[b] = (column_scales[b] > 0) ?
+                           1.0 / sqrt(column_scales[b]) : 0.0;
+    }
+    for (e = 0; e < n * r; e++) {
+        context.z -> values[e] *= column_scales[context.z -> columns[e]];
+    }
+
+    /*
+     * The left singular vectors of Z' are Z' times its right singular
+     * vectors, which are the eigenvectors of the p x p gram matrix Z'^T Z',
+     * summed in O(n * r^2) out of the rows of Z'.
+     */
+    gram = (Vector) calloc(p * p, sizeof(double));
+    for (i = 0; i < n; i++) {
+        start = context.z -> row_starts[i];
+        end = context.z -> row_starts[i + 1];
+        for (a = start; a < end; a++) {
+            for (b = start; b < end; b++) {
+                gram[context.z -> columns[a] * p + context.z -> columns[b]] +=
+                    context.z -> values[a] * context.z -> values[b];
+            }
+        }
+    }
+    eigenpairs = jacobi_batched(gram, 1, p, 1);
+    order = (LscEigenvalue *) malloc(p * sizeof(LscEigenvalue));
+    for (b = 0; b < p; b++) {
+        order[b].value = eigenpairs -> eigenvalues[b];
+        order[b].idx = b;
+    }
+    qsort(order, p, sizeof(LscEigenvalue), _compare_descending_eigenvalues);
+
+    for (j = 0; j < count; j++) {
+        result -> eigenvalues[j] = 1.0 - order[j].value;
+        eigenvector = eigenpairs -> eigenvectors + order[j].idx * p;
+        csr_multiply_vector(context.z, eigenvector, result -> eigenvectors[j],
+                            threads_count);
+        norm = 0.0;
+        for (i = 0; i < n; i++) {
+            norm += result -> eigenvectors[j][i] * result -> eigenvectors[j][i];
+        }
+        norm = sqrt(norm);
+        for (i = 0; i < n && norm > 0; i++) {
+            result -> eigenvectors[j][i] /= norm;
+        }
+    }
+
+    free(order);
+    free_jacobi_batch_result(eigenpairs);
+    free(gram);
+    free(column_scales);
+    free_csr_matrix(context.z);
+    return result;
+}
+
+void free_lsc_result(LscResult *result) {
+    free(result -> eigenvalues);
+    free_matrix(result -> eigenvectors, result -> count);
+    free_matrix(result -> landmarks, result -> landmarks_count);
+    free(result);
+}
+
+/**
+ * Set landmarks to the centroids of landmarks_count clusters of the
+ * datapoints, seeded with K-means++ and moved by LSC_KMEANS_ITERATIONS
+ * iterations of fit_with_options.
+ */
+static void _choose_landmarks(Matrix data_points, size_t n, size_t m,
+                              size_t landmarks_count,
+                              const LscOptions *options, size_t threads_count,
+                              Matrix landmarks) {
+    size_t a;
+    size_t *idxs = (size_t *) malloc(landmarks_count * sizeof(size_t));
+    Cluster *clusters = (Cluster *) malloc(landmarks_count * sizeof(Cluster));
+    KmeansOptions kmeans_options;
+    RandomState rs;
+
+    seed_random_state(&rs, options -> seed);
+    kmeanspp(data_points, n, m, landmarks_count, STANDARD_SEEDING, &rs, idxs);
+    for (a = 0; a < landmarks_count; a++) {
+        clusters[a].centroid = landmarks[a];
+        memcpy(landmarks[a], data_points[idxs[a]], m * sizeof(double));
+    }
+
+    init_kmeans_options(&kmeans_options);
+    kmeans_options.algorithm = AUTO;
+    kmeans_options.iter = LSC_KMEANS_ITERATIONS;
+    kmeans_options.seed = options -> seed;
+    kmeans_options.threads_count = threads_count;
+    fit_with_options(clusters, data_points, n, m, landmarks_count,
+                     &kmeans_options, NULL);
+
+    free(clusters);
+    free(idxs);
+}
+
+/**
+ * Code the datapoints of a task by their nearest landmarks, with gaussian
+ * weights normalized to sum to 1. The weights are taken relative to the
+ * nearest landmark, which the normalization cancels, so a datapoint far from
+ * all the landmarks doesn't underflow to a row of zeros.
+ */
+static void _code_rows(void *context, size_t task_idx) {
+    LscContext *lsc = (LscContext *) context;
+    size_t i, e, r = lsc -> nearest_landmarks;
+    size_t start = task_idx * LSC_ROWS_PER_TASK;
+    size_t end = start + LSC_ROWS_PER_TASK;
+    size_t *columns = NULL;
+    double sum;
+    Vector values = NULL;
+
+    end = (end < lsc -> n) ? end : lsc -> n;
+    for (i = start; i < end; i++) {
+        columns = lsc -> z -> columns + i * r;
+        values = lsc -> z -> values + i * r;
+        kd_tree_nearest(lsc -> tree, lsc -> data_points[i], r,
+                        KD_TREE_NO_EXCLUSION, columns, values);
+        sum = 0.0;
+        for (e = r; e > 0; e--) {
+            values[e - 1] = exp(-(values[e - 1] - values[0]) / 2);
+            sum += values[e - 1];
+        }
+        for (e = 0; e < r; e++) {
+            values[e] /= sum;
+        }
+        _sort_row(columns, values, r);
+    }
+}
+
+/**
+ * Sort the entries of a row by their columns with an insertion sort, since a
+ * row only has a few of them.
+ */
+static void _sort_row(size_t *columns, Vector values, size_t count) {
+    size_t e, f, column;
+    double value;
+
+    for (e = 1; e < count; e++) {
+        column = columns[e];
+        value = values[e];
+        for (f = e; f > 0 && columns[f - 1] > column; f--) {
+            columns[f] = columns[f - 1];
+            values[f] = values[f - 1];
+        }
+        columns[f] = column;
+        values[f] = value;
+    }
+}
+
+static int _compare_descending_eigenvalues(const void *a, const void *b) {
+    double x = ((const LscEigenvalue *) a) -> value;
+    double y = ((const LscEigenvalue *) b) -> value;
+    return (x < y) - (y < x);
+}
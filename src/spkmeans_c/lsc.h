@@ -0,0 +1,69 @@
+#ifndef LSC_H
+#define LSC_H
+
+#include "matrix.h"
+#include <stddef.h>
+#include <stdint.h>
+
+#define LSC_DEFAULT_LANDMARKS_COUNT 100
+#define LSC_DEFAULT_NEAREST_LANDMARKS 5
+#define LSC_KMEANS_ITERATIONS 10
+
+/**
+ * The options of lsc: the number p of landmarks, the number r of nearest
+ * landmarks every datapoint is coded by, and the seed of the K-means++ seeding
+ * of the landmarks.
+ */
+typedef struct LscOptions {
+    size_t landmarks_count;
+    size_t nearest_landmarks;
+    uint32_t seed;
+} LscOptions;
+
+/**
+ * The result of lsc: the count smallest eigenvalues of the Laplacian of the
+ * landmarks graph in ascending order, and the count x n matrix of their unit
+ * eigenvectors, meaning row i is the eigenvector of eigenvalue i, along with
+ * the landmarks_count x m matrix of the landmarks.
+ */
+typedef struct LscResult {
+    size_t count;
+    Vector eigenvalues;
+    Matrix eigenvectors;
+    size_t landmarks_count;
+    Matrix landmarks;
+} LscResult;
+
+/**
+ * Receive LSC options and set them to the defaults:
+ * LSC_DEFAULT_LANDMARKS_COUNT landmarks, LSC_DEFAULT_NEAREST_LANDMARKS nearest
+ * landmarks and a seed of 0.
+ */
+void init_lsc_options(LscOptions *options);
+
+/**
+ * Receive n datapoints of order m, a number count of eigenpairs, LSC options
+ * and a number of threads, and run landmark-based spectral clustering: choose
+ * p landmarks with LSC_KMEANS_ITERATIONS iterations of fit_with_options from a
+ * K-means++ seeding, and code every datapoint by its r nearest landmarks,
+ * found with a KD-tree, as the sparse n x p matrix Z of their gaussian weights
+ * exp(-||x_i - u_j||^2 / 2), normalized to sum to 1 in every row. The graph
+ * W = Z' Z'^T of Z' = Z D^-1/2, where D holds the column sums of Z, has all
+ * its degrees 1, so its Laplacian I - W has the eigenvectors of the largest
+ * singular values s of Z', with the eigenvalues 1 - s^2. They are found from
+ * the p x p matrix Z'^T Z', which is decomposed with jacobi_batched. It takes
+ * O(n * p * m) time for the landmarks and O(n * r^2 + p^3) time for the rest,
+ * spread on threads_count threads (0 for default_threads_count()) where it can
+ * be, and at most p eigenpairs are found. The function allocates memory for
+ * the result, so it's the caller's responsibility to free it with
+ * free_lsc_result.
+ */
+LscResult *lsc(Matrix data_points, size_t n, size_t m, size_t count,
+               const LscOptions *options, size_t threads_count);
+
+/**
+ * Receive a result of lsc and free it.
+ */
+void free_lsc_result(LscResult *result);
+
+#endif
@@ -8,15 +8,18 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include "matrix.h"
 #include "strutils.h"
 
 Matrix build_matrix(size_t n, size_t m) {
     size_t i;
-    Matrix mat = (Matrix) malloc(n * sizeof(Vector));
+    /* The row pointers are followed by the n * m values in a single block */
+    Matrix mat = (Matrix) calloc(1, n * sizeof(Vector) + n * m * sizeof(double));
+    Vector values = matrix_values(mat, n);
 
     for (i = 0; i < n; i++) {
-        mat[i] = (Vector) calloc(m, sizeof(double));
+        mat[i] = values + i * m;
     }
     return mat;
 }
@@ -32,10 +35,10 @@ Matrix build_identity_matrix(size_t n) {
 }
 
 Matrix build_matrix_from_file(char *filename, size_t *n, size_t *m) {
-    size_t i, line_len;
+    size_t i, line_len, capacity = 0;
     char *line = NULL;
     char *line_idx = NULL;
-    Vector vector = NULL;
+    Vector values = NULL;
     Matrix mat = NULL;
     FILE *file = fopen(filename, "r");
     if (file == NULL) {
@@ -44,23 +47,25 @@ Matrix build_matrix_from_file(char *filename, size_t *n, size_t *m) {
 
     *m = 0;
     *n = 0;
-    mat = (Matrix) malloc(sizeof(Vector));
 
     while (getline(&line, &line_len, file) != -1) {
         if (*m == 0) {
            *m = strcount(line, COMMA) + 1;
         }
 
-        vector = (Vector) calloc(*m, sizeof(double));
+        /* The values are read to a growing buffer, and copied once at the end */
+        if ((*n + 1) * (*m) > capacity) {
+            capacity = (capacity == 0) ? *m : 2 * capacity;
+            values = (Vector) realloc(values, capacity * sizeof(double));
+        }
         line_idx = line;
 
         for (i = 0; i < (*m); i++) {
-            vector[i] = strtod(line_idx, &line_idx);
+            values[(*n) * (*m) + i] = strtod(line_idx, &line_idx);
             if (*line_idx != COMMA && *line_idx != LINE_FEED &&
                 *line_idx != CARRIAGE_RETURN) {
                     free(line);
-                    free(vector);
-                    free_matrix(mat, *n);
+                    free(values);
                     fclose(file);
                     return NULL;
             }
@@ -70,10 +75,15 @@ Matrix build_matrix_from_file(char *filename, size_t *n, size_t *m) {
             }
         }
 
-        mat = (Matrix) realloc(mat, (++(*n)) * sizeof(Vector));
-        mat[(*n) - 1] = vector;
+        ++(*n);
+    }
+
+    mat = build_matrix(*n, *m);
+    if (*n > 0) {
+        memcpy(matrix_values(mat, *n), values, (*n) * (*m) * sizeof(double));
     }
 
+    free(values);
     free(line);
     fclose(file);
     return mat;
@@ -159,10 +169,11 @@ void print_transposed_matrix(Matrix mat, size_t n, size_t m) {
     }
 }
 
+Vector matrix_values(Matrix mat, size_t n) {
+    return (Vector) (mat + n);
+}
+
 void free_matrix(Matrix mat, size_t n) {
-    size_t i;
-    for (i = 0; i < n; i++) {
-        free(mat[i]);
-    }
+    (void) n;
     free(mat);
 }
@@ -14,7 +14,9 @@ typedef struct Coordinate {
 /**
  * Build a zero matrix from the given order.
  * The function allocates memory for the matrix, so it's the caller's
- * responsibility to free it.
+ * responsibility to free it. The row pointers and the n * m values are
+ * allocated as a single block, with the values stored in row order right after
+ * the n row pointers (see matrix_values).
  */
 Matrix build_matrix(size_t n, size_t m);
 
@@ -79,7 +81,14 @@ void print_matrix(Matrix mat, size_t n, size_t m);
 void print_transposed_matrix(Matrix mat, size_t n, size_t m);
 
 /**
- * Receive a square matrix and its order and free it.
+ * Receive a matrix built by build_matrix and its number of rows, and return
+ * its n * m contiguous values, which are in row order unless its row pointers
+ * were reordered.
+ */
+Vector matrix_values(Matrix mat, size_t n);
+
+/**
+ * Receive a matrix built by build_matrix and its number of rows and free it.
  */
 void free_matrix(Matrix mat, size_t n);
 
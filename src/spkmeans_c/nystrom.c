@@ -0,0 +1,373 @@
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "jacobi.h"
+#include "kmeans.h"
+#include "nystrom.h"
+#include "parallel.h"
+#include "rng.h"
+#include "vector.h"
+
+#define NYSTROM_ROWS_PER_TASK 256
+
+/**
+ * Eigenvalues of the landmarks block this small relative to its largest one
+ * are treated as zeros by its pseudoinverse, since repeated or nearly
+ * repeated landmarks make it singular.
+ */
+#define PSEUDOINVERSE_TOLERANCE 1e-12
+
+/**
+ * The shared context of the tasks of nystrom. Every row task fills the rows of
+ * the affinities c of its datapoints to the landmarks, or extends the
+ * eigenvectors of the landmarks to them, and every gram task fills a row of
+ * the gram matrix of the columns of c, out of the rows of its transpose.
+ */
+typedef struct NystromContext {
+    Matrix data_points;
+    size_t n;
+    size_t m;
+    Matrix landmarks;
+    size_t landmarks_count;
+    GaussianWeightsKernel gaussian_weights;
+    Matrix c;
+    Matrix transposed_c;
+    Vector gram;
+    Matrix landmarks_eigenvectors;
+    Vector inverse_sqrt_degrees;
+    Matrix eigenvectors;
+    size_t count;
+} NystromContext;
+
+typedef struct NystromEigenvalue {
+    double value;
+    size_t idx;
+} NystromEigenvalue;
+
+static void _sample_landmarks(Matrix data_points, size_t n, size_t m,
+                              size_t landmarks_count,
+                              const NystromOptions *options, size_t *idxs);
+static void _fill_affinity_rows(void *context, size_t task_idx);
+static void _fill_gram_row(void *context, size_t row_idx);
+static void _extend_eigenvectors(void *context, size_t task_idx);
+static Vector _landmarks_block(Matrix c, const size_t *idxs,
+                               size_t landmarks_count);
+static Vector _pseudoinverse_power(Vector block, size_t l, double power);
+static void _multiply_blocks(const double *x, const double *y, size_t l,
+                             Vector product);
+static int _compare_descending_eigenvalues(const void *a, const void *b);
+
+void init_nystrom_options(NystromOptions *options) {
+    options -> landmarks_count = NYSTROM_DEFAULT_LANDMARKS_COUNT;
+    options -> sampling = UNIFORM_LANDMARKS;
+    options -> seed = 0;
+}
+
+NystromResult *nystrom(Matrix data_points, size_t n, size_t m, size_t count,
+                       const NystromOptions *options, size_t threads_count) {
+    size_t i, a, b, j, l, tasks_count;
+    double norm, degree;
+    Vector block = NULL, pseudoinverse = NULL, column_sums = NULL;
+    Vector degrees_coefficients = NULL, reduced = NULL;
+    NystromEigenvalue *order = NULL;
+    JacobiBatchResult *eigenpairs = NULL;
+    NystromContext context;
+    NystromResult *result = (NystromResult *) malloc(sizeof(NystromResult));
+
+    l = (options -> landmarks_count < n) ? options -> landmarks_count : n;
+    count = (count < l) ? count : l;
+    result -> count = count;
+    result -> landmarks_count = l;
+    result -> landmarks_idxs = (size_t *) malloc((l + 1) * sizeof(size_t));
+    result -> eigenvalues = (Vector) calloc(count + 1, sizeof(double));
+    result -> eigenvectors = build_matrix(count, n);
+    if (l == 0) {
+        return result;
+    }
+    _sample_landmarks(data_points, n, m, l, options, result -> landmarks_idxs);
+
+    context.data_points = data_points;
+    context.n = n;
+    context.m = m;
+    context.landmarks_count = l;
+    context.landmarks = (Matrix) malloc(l * sizeof(Vector));
+    for (a = 0; a < l; a++) {
+        context.landmarks[a] = data_points[result -> landmarks_idxs[a]];
+    }
+    context.gaussian_weights = vector_kernels(m) -> gaussian_weights;
+    context.c = build_matrix(n, l);
+    tasks_count = (n + NYSTROM_ROWS_PER_TASK - 1) / NYSTROM_ROWS_PER_TASK;
+    parallel_for(tasks_count, threads_count, _fill_affinity_rows, &context);
+
+    /*
+     * The affinities include the affinity 1 of every datapoint to itself, a
+     * self loop that leaves D - W as is but keeps the landmarks block A
+     * positive semidefinite. The degrees are the row sums of C A^+ C^T, and
+     * never below the self loop's 1.
+     */
+    block = _landmarks_block(context.c, result -> landmarks_idxs, l);
+    pseudoinverse = _pseudoinverse_power(block, l, -1.0);
+    column_sums = (Vector) calloc(l, sizeof(double));
+    degrees_coefficients = (Vector) calloc(l, sizeof(double));
+    for (i = 0; i < n; i++) {
+        for (b = 0; b < l; b++) {
+            column_sums[b] += context.c[i][b];
+        }
+    }
+    for (a = 0; a < l; a++) {
+        for (b = 0; b < l; b++) {
+            degrees_coefficients[a] +=
+                pseudoinverse[a * l + b] * column_sums[b];
+        }
+    }
+    context.inverse_sqrt_degrees = (Vector) malloc(n * sizeof(double));
+    for (i = 0; i < n; i++) {
+        degree = 0.0;
+        for (b = 0; b < l; b++) {
+            degree += context.c[i][b] * degrees_coefficients[b];
+        }
+        context.inverse_sqrt_degrees[i] = 1.0 / sqrt((degree > 1.0) ? degree :
+                                                                      1.0);
+    }
+    free(pseudoinverse);
+    free(block);
+
+    /* C becomes the landmarks' columns of D^-1/2 (W + I) D^-1/2 */
+    for (i = 0; i < n; i++) {
+        for (b = 0; b < l; b++) {
+            context.c[i][b] *= context.inverse_sqrt_degrees[i] *
+                context.inverse_sqrt_degrees[result -> landmarks_idxs[b]];
+        }
+    }
+
+    /*
+     * The eigenvectors of the approximation C A^+ C^T are C A^+1/2 times the
+     * eigenvectors of A^+1/2 C^T C A^+1/2, which are orthogonal unlike the
+     * eigenvectors of A extended through C, and their eigenvalues are the
+     * same, so they don't need to be rescaled from the landmarks to all the
+     * datapoints. It costs the O(n * l^2) gram matrix C^T C, which makes them
+     * far more accurate for a given l.
+     */
+    block = _landmarks_block(context.c, result -> landmarks_idxs, l);
+    pseudoinverse = _pseudoinverse_power(block, l, -0.5);
+    context.transposed_c = transpose(context.c, l, n);
+    context.gram = (Vector) malloc(l * l * sizeof(double));
+    parallel_for(l, threads_count, _fill_gram_row, &context);
+    reduced = (Vector) malloc(l * l * sizeof(double));
+    _multiply_blocks(pseudoinverse, context.gram, l, block);
+    _multiply_blocks(block, pseudoinverse, l, reduced);
+    for (a = 0; a < l; a++) {
+        for (b = 0; b < a; b++) {
+            reduced[a * l + b] = reduced[b * l + a] =
+                (reduced[a * l + b] + reduced[b * l + a]) / 2;
+        }
+    }
+    eigenpairs = jacobi_batched(reduced, 1, l, 1);
+    order = (NystromEigenvalue *) malloc(l * sizeof(NystromEigenvalue));
+    for (a = 0; a < l; a++) {
+        order[a].value = eigenpairs -> eigenvalues[a];
+        order[a].idx = a;
+    }
+    qsort(order, l, sizeof(NystromEigenvalue), _compare_descending_eigenvalues);
+
+    context.landmarks_eigenvectors = build_matrix(count, l);
+    for (j = 0; j < count; j++) {
+        result -> eigenvalues[j] = 1.0 - order[j].value;
+        for (a = 0; a < l; a++) {
+            for (b = 0; b < l; b++) {
+                context.landmarks_eigenvectors[j][a] +=
+                    pseudoinverse[a * l + b] *
+                    eigenpairs -> eigenvectors[order[j].idx * l + b];
+            }
+        }
+    }
+    context.eigenvectors = result -> eigenvectors;
+    context.count = count;
+    parallel_for(tasks_count, threads_count, _extend_eigenvectors, &context);
+    for (j = 0; j < count; j++) {
+        norm = 0.0;
+        for (i = 0; i < n; i++) {
+            norm += result -> eigenvectors[j][i] * result -> eigenvectors[j][i];
+        }
+        norm = sqrt(norm);
+        for (i = 0; i < n && norm > 0; i++) {
+            result -> eigenvectors[j][i] /= norm;
+        }
+    }
+
+    free(order);
+    free_jacobi_batch_result(eigenpairs);
+    free(reduced);
+    free(context.gram);
+    free_matrix(context.transposed_c, l);
+    free_matrix(context.landmarks_eigenvectors, count);
+    free(pseudoinverse);
+    free(block);
+    free(context.inverse_sqrt_degrees);
+    free(degrees_coefficients);
+    free(column_sums);
+    free_matrix(context.c, n);
+    free(context.landmarks);
+    return result;
+}
+
+void free_nystrom_result(NystromResult *result) {
+    free(result -> eigenvalues);
+    free_matrix(result -> eigenvectors, result -> count);
+    free(result -> landmarks_idxs);
+    free(result);
+}
+
+/**
+ * Set idxs to the indices of landmarks_count datapoints, sampled uniformly
+ * without repeats by a partial Fisher-Yates shuffle, or with K-means++.
+ */
+static void _sample_landmarks(Matrix data_points, size_t n, size_t m,
+                              size_t landmarks_count,
+                              const NystromOptions *options, size_t *idxs) {
+    size_t i, swapped;
+    size_t *permutation = NULL;
+    RandomState rs;
+
+    seed_random_state(&rs, options -> seed);
+    if (options -> sampling == KMEANSPP_LANDMARKS) {
+        kmeanspp(data_points, n, m, landmarks_count, STANDARD_SEEDING, &rs,
+                 idxs);
+        return;
+    }
+
+    permutation = (size_t *) malloc(n * sizeof(size_t));
+    for (i = 0; i < n; i++) {
+        permutation[i] = i;
+    }
+    for (i = 0; i < landmarks_count; i++) {
+        swapped = i + random_index(&rs, n - i);
+        idxs[i] = permutation[swapped];
+        permutation[swapped] = permutation[i];
+    }
+    free(permutation);
+}
+
+static void _fill_affinity_rows(void *context, size_t task_idx) {
+    NystromContext *nystrom = (NystromContext *) context;
+    size_t i, start = task_idx * NYSTROM_ROWS_PER_TASK;
+    size_t end = start + NYSTROM_ROWS_PER_TASK;
+
+    end = (end < nystrom -> n) ? end : nystrom -> n;
+    for (i = start; i < end; i++) {
+        nystrom -> gaussian_weights(nystrom -> data_points[i],
+                                    nystrom -> landmarks,
+                                    nystrom -> landmarks_count,
+                                    nystrom -> c[i], nystrom -> m);
+    }
+}
+
+/**
+ * Extend the eigenvectors of the landmarks to the datapoints of a task,
+ * through their rows of the normalized affinities to the landmarks, and scale
+ * them by D^-1/2. The square roots of the eigenvalues they would be divided by
+ * are left out, since the eigenvectors are normalized afterwards anyway.
+ */
+static void _extend_eigenvectors(void *context, size_t task_idx) {
+    NystromContext *nystrom = (NystromContext *) context;
+    size_t i, j, b, start = task_idx * NYSTROM_ROWS_PER_TASK;
+    size_t end = start + NYSTROM_ROWS_PER_TASK;
+    double sum;
+
+    end = (end < nystrom -> n) ? end : nystrom -> n;
+    for (j = 0; j < nystrom -> count; j++) {
+        for (i = start; i < end; i++) {
+            sum = 0.0;
+            for (b = 0; b < nystrom -> landmarks_count; b++) {
+                sum += nystrom -> c[i][b] *
+                       nystrom -> landmarks_eigenvectors[j][b];
+            }
+            nystrom -> eigenvectors[j][i] =
+                sum * nystrom -> inverse_sqrt_degrees[i];
+        }
+    }
+}
+
+static void _fill_gram_row(void *context, size_t row_idx) {
+    NystromContext *nystrom = (NystromContext *) context;
+    size_t b, i, l = nystrom -> landmarks_count;
+    double sum;
+    const double *row = nystrom -> transposed_c[row_idx];
+
+    for (b = 0; b < l; b++) {
+        sum = 0.0;
+        for (i = 0; i < nystrom -> n; i++) {
+            sum += row[i] * nystrom -> transposed_c[b][i];
+        }
+        nystrom -> gram[row_idx * l + b] = sum;
+    }
+}
+
+/**
+ * Return the landmarks block of c, the rows of the landmarks, which is
+ * symmetric up to the rounding of the affinities, so it's averaged with its
+ * transpose.
+ */
+static Vector _landmarks_block(Matrix c, const size_t *idxs,
+                               size_t landmarks_count) {
+    size_t a, b, l = landmarks_count;
+    Vector block = (Vector) malloc(l * l * sizeof(double));
+
+    for (a = 0; a < l; a++) {
+        for (b = 0; b < l; b++) {
+            block[a * l + b] = (c[idxs[a]][b] + c[idxs[b]][a]) / 2;
+        }
+    }
+    return block;
+}
+
+/**
+ * Return the power of the pseudoinverse of a positive semidefinite block of
+ * order l, from its eigenpairs found with jacobi_batched.
+ */
+static Vector _pseudoinverse_power(Vector block, size_t l, double power) {
+    size_t a, b, e;
+    double largest = 0.0, scale;
+    const double *eigenvector = NULL;
+    Vector result = (Vector) calloc(l * l, sizeof(double));
+    JacobiBatchResult *eigenpairs = jacobi_batched(block, 1, l, 1);
+
+    for (e = 0; e < l; e++) {
+        largest = (eigenpairs -> eigenvalues[e] > largest) ?
+                  eigenpairs -> eigenvalues[e] : largest;
+    }
+    for (e = 0; e < l; e++) {
+        if (eigenpairs -> eigenvalues[e] <= PSEUDOINVERSE_TOLERANCE * largest) {
+            continue;
+        }
+        eigenvector = eigenpairs -> eigenvectors + e * l;
+        scale = pow(eigenpairs -> eigenvalues[e], power);
+        for (a = 0; a < l; a++) {
+            for (b = 0; b < l; b++) {
+                result[a * l + b] += scale * eigenvector[a] * eigenvector[b];
+            }
+        }
+    }
+    free_jacobi_batch_result(eigenpairs);
+    return result;
+}
+
+static void _multiply_blocks(const double *x, const double *y, size_t l,
+                             Vector product) {
+    size_t a, b, e;
+
+    memset(product, 0, l * l * sizeof(double));
+    for (a = 0; a < l; a++) {
+        for (e = 0; e < l; e++) {
+            for (b = 0; b < l; b++) {
+                product[a * l + b] += x[a * l + e] * y[e * l + b];
+            }
+        }
+    }
+}
+
+static int _compare_descending_eigenvalues(const void *a, const void *b) {
+    double x = ((const NystromEigenvalue *) a) -> value;
+    double y = ((const NystromEigenvalue *) b) -> value;
+    return (x < y) - (y < x);
+}
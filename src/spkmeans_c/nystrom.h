@@ -0,0 +1,81 @@
+#ifndef NYSTROM_H
+#define NYSTROM_H
+
+#include "matrix.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define NYSTROM_DEFAULT_LANDMARKS_COUNT 100
+
+/**
+ * How the landmarks of nystrom are chosen out of the datapoints: uniformly
+ * without repeats, or with K-means++, which spreads them over the datapoints
+ * so small clusters get landmarks too.
+ */
+typedef enum LandmarkSampling {
+    UNIFORM_LANDMARKS,
+    KMEANSPP_LANDMARKS
+} LandmarkSampling;
+
+/**
+ * The options of nystrom: the number of landmarks, which is its accuracy knob,
+ * how they are sampled, and the seed of the sampling.
+ */
+typedef struct NystromOptions {
+    size_t landmarks_count;
+    LandmarkSampling sampling;
+    uint32_t seed;
+} NystromOptions;
+
+/**
+ * The result of nystrom: the count smallest approximate eigenvalues of the
+ * normalized graph Laplacian in ascending order, and the count x n matrix of
+ * the matching approximate unit eigenvectors of the random-walk Laplacian,
+ * meaning row i is the eigenvector of eigenvalue i. landmarks_idxs holds the
+ * indices of the landmarks_count datapoints used as landmarks.
+ */
+typedef struct NystromResult {
+    size_t count;
+    Vector eigenvalues;
+    Matrix eigenvectors;
+    size_t landmarks_count;
+    size_t *landmarks_idxs;
+} NystromResult;
+
+/**
+ * Receive Nystrom options and set them to the defaults:
+ * NYSTROM_DEFAULT_LANDMARKS_COUNT uniformly sampled landmarks and a seed of 0.
+ */
+void init_nystrom_options(NystromOptions *options);
+
+/**
+ * Receive n datapoints of order m, a number count of eigenpairs, Nystrom
+ * options and a number of threads, and approximate the first eigenpairs of the
+ * graph Laplacian of the datapoints' gaussian affinities from l landmarks, out
+ * of the n x l block C of the affinities to the landmarks, whose landmarks
+ * rows are the l x l block A of the affinities between them, without the rest
+ * of the n x n matrix, which is approximated by C A^+ C^T. Every datapoint gets
+ * a self loop of weight 1, which leaves D - W as is and keeps A positive
+ * semidefinite. The degrees are approximated from the blocks, the blocks are
+ * normalized to those of D^-1/2 W D^-1/2, and the eigenpairs of its
+ * approximation are found from the l x l matrix A^+1/2 C^T C A^+1/2, which is
+ * decomposed with jacobi_batched. The eigenvectors are scaled by D^-1/2, so
+ * they are constant on the connected components of the graph like the
+ * eigenvectors of D - W, and the eigenvalues are those of the normalized
+ * Laplacian I - D^-1/2 W D^-1/2. It takes O(n * l * (m + l) + l^3) time, the
+ * blocks and the eigenvectors spread on threads_count threads (0 for
+ * default_threads_count()), and its error shrinks as l grows, down to none
+ * with l = n. At most l eigenpairs are found. The function allocates memory
+ * for the result, so it's the caller's responsibility to free it with
+ * free_nystrom_result.
+ */
+NystromResult *nystrom(Matrix data_points, size_t n, size_t m, size_t count,
+                       const NystromOptions *options, size_t threads_count);
+
+/**
+ * Receive a result of nystrom and free it.
+ */
+void free_nystrom_result(NystromResult *result);
+
+#endif
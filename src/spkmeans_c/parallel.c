@@ -0,0 +1,227 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "parallel.h"
+
+typedef struct ParallelForState {
+    ParallelTask task;
+    void *context;
+    size_t tasks_count;
+    size_t next_task_idx;
+    pthread_mutex_t lock;
+} ParallelForState;
+
+/**
+ * The workers kept alive between calls of parallel_for. The call holding owner
+ * posts its state as job and bumps generation, and the first participants
+ * workers run its tasks, each decrementing pending once it's out of tasks.
+ * Workers are only ever added, up to the most threads a call asked for.
+ */
+typedef struct WorkerPool {
+    pthread_mutex_t owner;
+    pthread_mutex_t lock;
+    pthread_cond_t job_posted;
+    pthread_cond_t job_done;
+    size_t workers_count;
+    size_t generation;
+    size_t participants;
+    size_t pending;
+    ParallelForState *job;
+} WorkerPool;
+
+/**
+ * The arguments of a new worker: its index in the pool, and the generation
+ * before the first job it may take part in.
+ */
+typedef struct WorkerArguments {
+    size_t worker_idx;
+    size_t generation;
+} WorkerArguments;
+
+static WorkerPool pool = {
+    PTHREAD_MUTEX_INITIALIZER, PTHREAD_MUTEX_INITIALIZER,
+    PTHREAD_COND_INITIALIZER, PTHREAD_COND_INITIALIZER, 0, 0, 0, 0, NULL
+};
+static pthread_once_t pool_once = PTHREAD_ONCE_INIT;
+
+static void *run_tasks(void *arg);
+static void run_pooled(ParallelForState *state, size_t helpers_count);
+static void run_spawned(ParallelForState *state, size_t helpers_count);
+static void *pool_worker(void *arg);
+static void register_fork_handler(void);
+static void reset_pool_in_child(void);
+
+size_t default_threads_count(void) {
+    long processors_count = sysconf(_SC_NPROCESSORS_ONLN);
+    return (processors_count > 0) ? (size_t) processors_count : 1;
+}
+
+void parallel_for(size_t tasks_count, size_t threads_count, ParallelTask task,
+                  void *context) {
+    size_t i;
+    ParallelForState state;
+
+    if (threads_count == 0) {
+        threads_count = default_threads_count();
+    }
+    if (threads_count > tasks_count) {
+        threads_count = tasks_count;
+    }
+
+    if (threads_count <= 1) {
+        for (i = 0; i < tasks_count; i++) {
+            task(context, i);
+        }
+        return;
+    }
+
+    state.task = task;
+    state.context = context;
+    state.tasks_count = tasks_count;
+    state.next_task_idx = 0;
+    pthread_mutex_init(&state.lock, NULL);
+
+    /*
+     * The calling thread is a worker too, so one thread less is needed. The
+     * pool serves one call at a time, so a call made while it's busy, like a
+     * nested call from a task, starts threads of its own instead.
+     */
+    pthread_once(&pool_once, register_fork_handler);
+    if (pthread_mutex_trylock(&pool.owner) == 0) {
+        run_pooled(&state, threads_count - 1);
+        pthread_mutex_unlock(&pool.owner);
+    } else {
+        run_spawned(&state, threads_count - 1);
+    }
+
+    pthread_mutex_destroy(&state.lock);
+}
+
+static void *run_tasks(void *arg) {
+    ParallelForState *state = (ParallelForState *) arg;
+    size_t task_idx;
+
+    while (1) {
+        pthread_mutex_lock(&state -> lock);
+        task_idx = state -> next_task_idx++;
+        pthread_mutex_unlock(&state -> lock);
+
+        if (task_idx >= state -> tasks_count) {
+            return NULL;
+        }
+        state -> task(state -> context, task_idx);
+    }
+}
+
+/**
+ * Run the tasks of a state on the calling thread and helpers_count workers of
+ * the pool, which the caller must own, adding workers to it as needed.
+ */
+static void run_pooled(ParallelForState *state, size_t helpers_count) {
+    pthread_t thread;
+    WorkerArguments *arguments = NULL;
+
+    pthread_mutex_lock(&pool.lock);
+    while (pool.workers_count < helpers_count) {
+        arguments = (WorkerArguments *) malloc(sizeof(WorkerArguments));
+        arguments -> worker_idx = pool.workers_count;
+        arguments -> generation = pool.generation;
+        if (pthread_create(&thread, NULL, pool_worker, arguments) != 0) {
+            free(arguments);
+            break;
+        }
+        pthread_detach(thread);
+        pool.workers_count++;
+    }
+    pool.participants = (helpers_count < pool.workers_count) ? helpers_count :
+                        pool.workers_count;
+    pool.pending = pool.participants;
+    pool.job = state;
+    pool.generation++;
+    pthread_cond_broadcast(&pool.job_posted);
+    pthread_mutex_unlock(&pool.lock);
+
+    run_tasks(state);
+
+    pthread_mutex_lock(&pool.lock);
+    while (pool.pending > 0) {
+        pthread_cond_wait(&pool.job_done, &pool.lock);
+    }
+    pool.job = NULL;
+    pthread_mutex_unlock(&pool.lock);
+}
+
+/**
+ * Run the tasks of a state on the calling thread and helpers_count threads
+ * started for them alone.
+ */
+static void run_spawned(ParallelForState *state, size_t helpers_count) {
+    size_t i, started_count = 0;
+    pthread_t *threads = (pthread_t *) malloc(helpers_count *
+                                              sizeof(pthread_t));
+
+    for (i = 0; i < helpers_count; i++) {
+        if (pthread_create(&threads[started_count], NULL, run_tasks, state) ==
+            0) {
+            started_count++;
+        }
+    }
+
+    run_tasks(state);
+
+    for (i = 0; i < started_count; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    free(threads);
+}
+
+static void *pool_worker(void *arg) {
+    WorkerArguments *arguments = (WorkerArguments *) arg;
+    size_t worker_idx = arguments -> worker_idx;
+    size_t generation = arguments -> generation;
+    ParallelForState *job = NULL;
+
+    free(arguments);
+    pthread_mutex_lock(&pool.lock);
+    while (1) {
+        while (pool.generation == generation) {
+            pthread_cond_wait(&pool.job_posted, &pool.lock);
+        }
+        generation = pool.generation;
+        if (worker_idx >= pool.participants) {
+            continue;
+        }
+
+        job = pool.job;
+        pthread_mutex_unlock(&pool.lock);
+        run_tasks(job);
+        pthread_mutex_lock(&pool.lock);
+        if (--pool.pending == 0) {
+            pthread_cond_signal(&pool.job_done);
+        }
+    }
+    return NULL;
+}
+
+static void register_fork_handler(void) {
+    pthread_atfork(NULL, NULL, reset_pool_in_child);
+}
+
+/**
+ * A forked child has none of the pool's threads, so it starts an empty pool.
+ */
+static void reset_pool_in_child(void) {
+    pthread_mutex_init(&pool.owner, NULL);
+    pthread_mutex_init(&pool.lock, NULL);
+    pthread_cond_init(&pool.job_posted, NULL);
+    pthread_cond_init(&pool.job_done, NULL);
+    pool.workers_count = 0;
+    pool.generation = 0;
+    pool.participants = 0;
+    pool.pending = 0;
+    pool.job = NULL;
+}
@@ -0,0 +1,33 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <stddef.h>
+
+/**
+ * A task run by parallel_for. It receives the context passed to parallel_for
+ * and the index of the task to run.
+ */
+typedef void (*ParallelTask)(void *context, size_t task_idx);
+
+/**
+ * Return the number of threads to use by default, which is the number of
+ * online processors.
+ */
+size_t default_threads_count(void);
+
+/**
+ * Receive a number of tasks, a number of threads, a task function and its
+ * context, and run the task function for every task index in [0, tasks_count)
+ * using up to threads_count threads (including the calling thread), which pick
+ * the next pending task index whenever they are done with one. If
+ * threads_count is 0, default_threads_count() threads are used. The threads
+ * are taken from a pool kept alive between calls, so a call costs no thread
+ * creation once the pool has grown to its size, and a call made while another
+ * one uses the pool (like a nested call from a task) starts its own threads.
+ * The function returns once all tasks are done. Tasks must not depend on the
+ * order in which they run, or on the thread running them.
+ */
+void parallel_for(size_t tasks_count, size_t threads_count, ParallelTask task,
+                  void *context);
+
+#endif
@@ -0,0 +1,201 @@
+#include <math.h>
+#include <stdlib.h>
+#include "parallel.h"
+#include "rff.h"
+#include "rng.h"
+
+#define RFF_ROWS_PER_TASK 256
+#define RFF_FEATURES_PER_TASK 64
+
+/**
+ * The shared context of the tasks of rff. Every row task maps a block of
+ * datapoints to their features, or multiplies a block of rows of Z by
+ * projection, and every feature task sums a block of the entries of
+ * projection = Z^T x out of all the rows.
+ */
+typedef struct RffContext {
+    Matrix data_points;
+    size_t n;
+    size_t m;
+    Matrix frequencies;
+    Vector offsets;
+    size_t features_count;
+    Matrix features;
+    const double *x;
+    Vector projection;
+    Vector y;
+    Vector diagonal;
+    size_t threads_count;
+} RffContext;
+
+static void _map_rows(void *context, size_t task_idx);
+static void _project_features(void *context, size_t task_idx);
+static void _expand_rows(void *context, size_t task_idx);
+static void _multiply_gram(RffContext *context, const double *x, Vector y);
+static void _multiply_laplacian(void *context, const double *x, Vector y);
+
+void init_rff_options(RffOptions *options) {
+    options -> features_count = RFF_DEFAULT_FEATURES_COUNT;
+    options -> seed = 0;
+}
+
+Matrix random_fourier_features(Matrix data_points, size_t n, size_t m,
+                               const RffOptions *options,
+                               size_t threads_count) {
+    size_t f, j, d = options -> features_count;
+    RandomState rs;
+    RffContext context;
+
+    context.data_points = data_points;
+    context.n = n;
+    context.m = m;
+    context.features_count = d;
+    context.frequencies = build_matrix(d, m);
+    context.offsets = (Vector) malloc((d + 1) * sizeof(double));
+    context.features = build_matrix(n, d);
+
+    seed_random_state(&rs, options -> seed);
+    for (f = 0; f < d; f++) {
+        for (j = 0; j < m; j++) {
+            context.frequencies[f][j] = random_gaussian(&rs);
+        }
+    }
+    for (f = 0; f < d; f++) {
+        context.offsets[f] = 2 * acos(-1.0) * random_double(&rs);
+    }
+    parallel_for((n + RFF_ROWS_PER_TASK - 1) / RFF_ROWS_PER_TASK,
+                 threads_count, _map_rows, &context);
+
+    free(context.offsets);
+    free_matrix(context.frequencies, d);
+    return context.features;
+}
+
+RffResult *rff(Matrix data_points, size_t n, size_t m, size_t count,
+               const RffOptions *options, const LanczosOptions *lanczos_options,
+               size_t threads_count) {
+    size_t i, d = options -> features_count;
+    Vector ones = NULL;
+    LanczosResult *lanczos_result = NULL;
+    RffContext context;
+    RffResult *result = (RffResult *) malloc(sizeof(RffResult));
+
+    context.n = n;
+    context.features_count = d;
+    context.features = random_fourier_features(data_points, n, m, options,
+                                               threads_count);
+    context.projection = (Vector) malloc((d + 1) * sizeof(double));
+    context.diagonal = (Vector) malloc((n + 1) * sizeof(double));
+    context.threads_count = threads_count;
+
+    /*
+     * The diagonal of the Laplacian is the degrees, the row sums of Z Z^T
+     * without its diagonal, plus the diagonal of Z Z^T the products add back
+     * in, so it's the row sums of Z Z^T as is.
+     */
+    ones = (Vector) malloc((n + 1) * sizeof(double));
+    for (i = 0; i < n; i++) {
+        ones[i] = 1.0;
+    }
+    _multiply_gram(&context, ones, context.diagonal);
+    free(ones);
+
+    lanczos_result = lanczos(_multiply_laplacian, &context, n, count,
+                             lanczos_options);
+    result -> count = lanczos_result -> k;
+    result -> eigenvalues = lanczos_result -> eigenvalues;
+    result -> eigenvectors = lanczos_result -> eigenvectors;
+    result -> converged = lanczos_result -> converged;
+    free(lanczos_result);
+
+    free(context.diagonal);
+    free(context.projection);
+    free_matrix(context.features, n);
+    return result;
+}
+
+void free_rff_result(RffResult *result) {
+    free(result -> eigenvalues);
+    free_matrix(result -> eigenvectors, result -> count);
+    free(result);
+}
+
+static void _map_rows(void *context, size_t task_idx) {
+    RffContext *rff = (RffContext *) context;
+    size_t i, f, j, start = task_idx * RFF_ROWS_PER_TASK;
+    size_t end = start + RFF_ROWS_PER_TASK;
+    double phase, scale = sqrt(2.0 / rff -> features_count);
+
+    end = (end < rff -> n) ? end : rff -> n;
+    for (i = start; i < end; i++) {
+        for (f = 0; f < rff -> features_count; f++) {
+            phase = rff -> offsets[f];
+            for (j = 0; j < rff -> m; j++) {
+                phase += rff -> frequencies[f][j] * rff -> data_points[i][j];
+            }
+            rff -> features[i][f] = scale * cos(phase);
+        }
+    }
+}
+
+/**
+ * Sum a block of the entries of Z^T x, walking the rows of Z so every row's
+ * block of features is read contiguously. Every entry is summed in the order
+ * of the rows, so the sums don't depend on the number of threads.
+ */
+static void _project_features(void *context, size_t task_idx) {
+    RffContext *rff = (RffContext *) context;
+    size_t i, f, start = task_idx * RFF_FEATURES_PER_TASK;
+    size_t end = start + RFF_FEATURES_PER_TASK;
+    const double *row = NULL;
+
+    end = (end < rff -> features_count) ? end : rff -> features_count;
+    for (f = start; f < end; f++) {
+        rff -> projection[f] = 0.0;
+    }
+    for (i = 0; i < rff -> n; i++) {
+        row = rff -> features[i];
+        for (f = start; f < end; f++) {
+            rff -> projection[f] += row[f] * rff -> x[i];
+        }
+    }
+}
+
+static void _expand_rows(void *context, size_t task_idx) {
+    RffContext *rff = (RffContext *) context;
+    size_t i, f, start = task_idx * RFF_ROWS_PER_TASK;
+    size_t end = start + RFF_ROWS_PER_TASK;
+    double sum;
+
+    end = (end < rff -> n) ? end : rff -> n;
+    for (i = start; i < end; i++) {
+        sum = 0.0;
+        for (f = 0; f < rff -> features_count; f++) {
+            sum += rff -> features[i][f] * rff -> projection[f];
+        }
+        rff -> y[i] = sum;
+    }
+}
+
+/**
+ * Set y to Z (Z^T x), in two passes over Z that each take O(n * D) time.
+ */
+static void _multiply_gram(RffContext *context, const double *x, Vector y) {
+    context -> x = x;
+    context -> y = y;
+    parallel_for((context -> features_count + RFF_FEATURES_PER_TASK - 1) /
+                 RFF_FEATURES_PER_TASK, context -> threads_count,
+                 _project_features, context);
+    parallel_for((context -> n + RFF_ROWS_PER_TASK - 1) / RFF_ROWS_PER_TASK,
+                 context -> threads_count, _expand_rows, context);
+}
+
+static void _multiply_laplacian(void *context, const double *x, Vector y) {
+    RffContext *rff = (RffContext *) context;
+    size_t i;
+
+    _multiply_gram(rff, x, y);
+    for (i = 0; i < rff -> n; i++) {
+        y[i] = rff -> diagonal[i] * x[i] - y[i];
+    }
+}
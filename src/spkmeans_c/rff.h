@@ -0,0 +1,78 @@
+#ifndef RFF_H
+#define RFF_H
+
+#include "lanczos.h"
+#include "matrix.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define RFF_DEFAULT_FEATURES_COUNT 500
+
+/**
+ * The options of rff: the number D of random Fourier features, which is its
+ * accuracy knob, and the seed of their frequencies and offsets.
+ */
+typedef struct RffOptions {
+    size_t features_count;
+    uint32_t seed;
+} RffOptions;
+
+/**
+ * The result of rff: the count smallest eigenvalues of the approximate graph
+ * Laplacian in ascending order, and the count x n matrix of their unit
+ * eigenvectors, meaning row i is the eigenvector of eigenvalue i. converged
+ * tells whether lanczos got them within its tolerance.
+ */
+typedef struct RffResult {
+    size_t count;
+    Vector eigenvalues;
+    Matrix eigenvectors;
+    bool converged;
+} RffResult;
+
+/**
+ * Receive RFF options and set them to the defaults:
+ * RFF_DEFAULT_FEATURES_COUNT features and a seed of 0.
+ */
+void init_rff_options(RffOptions *options);
+
+/**
+ * Receive n datapoints of order m, RFF options and a number of threads, and
+ * return the n x D matrix Z of their random Fourier features
+ * z(x) = sqrt(2 / D) * cos(w^T x + b), whose products z(x)^T z(y) approximate
+ * the gaussian affinities exp(-||x - y||^2 / 2) of weighted_adjacency_matrix.
+ * The D frequencies w are drawn from the standard normal distribution, the
+ * gaussian's Fourier transform, and the D offsets b uniformly from [0, 2 pi),
+ * with a generator seeded by the seed, in the order of
+ * np.random.standard_normal((D, m)) and 2 * pi * np.random.random_sample(D).
+ * Blocks of datapoints are mapped on threads_count threads (0 for
+ * default_threads_count()). The function allocates memory for the matrix, so
+ * it's the caller's responsibility to free it.
+ */
+Matrix random_fourier_features(Matrix data_points, size_t n, size_t m,
+                               const RffOptions *options,
+                               size_t threads_count);
+
+/**
+ * Receive n datapoints of order m, a number count of eigenpairs, RFF options,
+ * Lanczos options and a number of threads, and find the first eigenpairs of
+ * the graph Laplacian D - W of the affinities approximated by the random
+ * Fourier features, W = Z Z^T without its diagonal, with lanczos. W is never
+ * formed, since the products of the Laplacian and x are
+ * (D + diag(Z Z^T)) x - Z (Z^T x), which take O(n * D) time, so the whole of
+ * it takes O(n * D * (m + products)) time, spread on threads_count threads
+ * (0 for default_threads_count()). Its error shrinks as D grows. The function
+ * allocates memory for the result, so it's the caller's responsibility to
+ * free it with free_rff_result.
+ */
+RffResult *rff(Matrix data_points, size_t n, size_t m, size_t count,
+               const RffOptions *options, const LanczosOptions *lanczos_options,
+               size_t threads_count);
+
+/**
+ * Receive a result of rff and free it.
+ */
+void free_rff_result(RffResult *result);
+
+#endif
@@ -0,0 +1,101 @@
+#define MT_SHIFT_SIZE 397
+#define MT_MATRIX_A 0x9908b0dfUL
+#define MT_UPPER_MASK 0x80000000UL
+#define MT_LOWER_MASK 0x7fffffffUL
+#define MT_INIT_MULTIPLIER 1812433253UL
+
+#include <math.h>
+#include "rng.h"
+
+static void _generate_next_state(RandomState *rs);
+
+void seed_random_state(RandomState *rs, uint32_t seed) {
+    size_t i;
+    uint32_t prev;
+
+    rs -> mt[0] = seed;
+    for (i = 1; i < MT_STATE_SIZE; i++) {
+        prev = rs -> mt[i - 1];
+        rs -> mt[i] = (uint32_t) (MT_INIT_MULTIPLIER * (prev ^ (prev >> 30)) + i);
+    }
+    rs -> index = MT_STATE_SIZE;
+    rs -> has_gauss = false;
+    rs -> gauss = 0.0;
+}
+
+uint32_t random_uint32(RandomState *rs) {
+    uint32_t y;
+
+    if (rs -> index >= MT_STATE_SIZE) {
+        _generate_next_state(rs);
+    }
+
+    y = rs -> mt[rs -> index++];
+    y ^= (y >> 11);
+    y ^= (y << 7) & 0x9d2c5680UL;
+    y ^= (y << 15) & 0xefc60000UL;
+    y ^= (y >> 18);
+    return y;
+}
+
+double random_double(RandomState *rs) {
+    uint32_t a = random_uint32(rs) >> 5;
+    uint32_t b = random_uint32(rs) >> 6;
+    return (a * 67108864.0 + b) / 9007199254740992.0;
+}
+
+size_t random_index(RandomState *rs, size_t n) {
+    uint32_t max_value, mask, value;
+
+    if (n <= 1) {
+        return 0;
+    }
+
+    /* NumPy draws masked 32 bits values, and rejects those out of range. */
+    max_value = (uint32_t) (n - 1);
+    mask = max_value;
+    mask |= mask >> 1;
+    mask |= mask >> 2;
+    mask |= mask >> 4;
+    mask |= mask >> 8;
+    mask |= mask >> 16;
+
+    do {
+        value = random_uint32(rs) & mask;
+    } while (value > max_value);
+    return (size_t) value;
+}
+
+double random_gaussian(RandomState *rs) {
+    double x, y, squared_radius, scale;
+
+    if (rs -> has_gauss) {
+        rs -> has_gauss = false;
+        return rs -> gauss;
+    }
+
+    /* A uniform point in the unit disk gives two independent normal draws */
+    do {
+        x = 2.0 * random_double(rs) - 1.0;
+        y = 2.0 * random_double(rs) - 1.0;
+        squared_radius = x * x + y * y;
+    } while (squared_radius >= 1.0 || squared_radius == 0.0);
+
+    scale = sqrt(-2.0 * log(squared_radius) / squared_radius);
+    rs -> gauss = scale * x;
+    rs -> has_gauss = true;
+    return scale * y;
+}
+
+static void _generate_next_state(RandomState *rs) {
+    size_t i;
+    uint32_t y;
+
+    for (i = 0; i < MT_STATE_SIZE; i++) {
+        y = (rs -> mt[i] & MT_UPPER_MASK) |
+            (rs -> mt[(i + 1) % MT_STATE_SIZE] & MT_LOWER_MASK);
+        rs -> mt[i] = rs -> mt[(i + MT_SHIFT_SIZE) % MT_STATE_SIZE] ^ (y >> 1) ^
+                      ((y & 1) ? MT_MATRIX_A : 0);
+    }
+    rs -> index = 0;
+}
@@ -0,0 +1,53 @@
+#ifndef RNG_H
+#define RNG_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define MT_STATE_SIZE 624
+
+/**
+ * A Mersenne Twister (MT19937) pseudo random generator state. The generator
+ * follows the exact algorithms of NumPy's legacy RandomState, so seeding it
+ * with the same seed as np.random.seed produces the same draws as the Python
+ * implementation. Gaussian draws come in pairs, so the second one of a pair is
+ * kept in gauss until the next draw, as NumPy does.
+ */
+typedef struct RandomState {
+    uint32_t mt[MT_STATE_SIZE];
+    size_t index;
+    bool has_gauss;
+    double gauss;
+} RandomState;
+
+/**
+ * Receive a random state and a seed, and initialize the state from the seed,
+ * the same way np.random.seed does for integer seeds.
+ */
+void seed_random_state(RandomState *rs, uint32_t seed);
+
+/**
+ * Receive a random state and return the next 32 random bits from it.
+ */
+uint32_t random_uint32(RandomState *rs);
+
+/**
+ * Receive a random state and return a uniform random double in [0, 1), the
+ * same way np.random.random_sample does.
+ */
+double random_double(RandomState *rs);
+
+/**
+ * Receive a random state and a positive upper bound n, and return a uniform
+ * random integer in [0, n), the same way np.random.choice(n) does.
+ */
+size_t random_index(RandomState *rs, size_t n);
+
+/**
+ * Receive a random state and return a standard normal random double, the same
+ * way np.random.standard_normal does, with the polar Box-Muller method.
+ */
+double random_gaussian(RandomState *rs);
+
+#endif
@@ -1,8 +1,76 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <math.h>
+#include <string.h>
+#include "grid.h"
+#include "kdtree.h"
+#include "parallel.h"
 #include "spectral.h"
 
+#define KNN_QUERIES_PER_TASK 256
+#define RADIUS_QUERIES_PER_TASK 256
+
+/**
+ * The shared context of the nearest neighbors queries of
+ * knn_weighted_adjacency_matrix. Every datapoint writes its neighbors_count
+ * neighbors and their squared distances to its own slot.
+ */
+typedef struct KnnContext {
+    const KdTree *tree;
+    Matrix data_points;
+    size_t n;
+    size_t neighbors_count;
+    size_t *neighbors_idxs;
+    Vector squared_distances;
+} KnnContext;
+
+/**
+ * The shared context of the radius queries of
+ * radius_weighted_adjacency_matrix. The rows are counted into row_counts
+ * first, and then filled into the matrix w.
+ */
+typedef struct RadiusContext {
+    const GridIndex *grid;
+    double radius;
+    size_t *row_counts;
+    CsrMatrix *w;
+} RadiusContext;
+
+/**
+ * The sparse graph Laplacian lanczos multiplies vectors with.
+ */
+typedef struct SparseLaplacian {
+    const CsrMatrix *l;
+    size_t threads_count;
+} SparseLaplacian;
+
+/**
+ * An entry of a sparse matrix row, sorted by its column.
+ */
+typedef struct CsrEntry {
+    size_t column;
+    double value;
+} CsrEntry;
+
+static void _knn_queries(void *context, size_t task_idx);
+static CsrMatrix *_symmetric_knn_graph(size_t n, size_t neighbors_count,
+                                       const size_t *neighbors_idxs,
+                                       const double *squared_distances);
+static void _count_radius_rows(void *context, size_t task_idx);
+static void _fill_radius_rows(void *context, size_t task_idx);
+static int _compare_csr_entries(const void *a, const void *b);
+static Matrix _graph_laplacian_of(Matrix data_points, size_t n, size_t m,
+                                  const SpectralOptions *options);
+static bool _uses_lanczos(const SpectralOptions *options, size_t n);
+static void _multiply_sparse_laplacian(void *context, const double *x,
+                                       Vector y);
+static size_t _partial_eigengap_heuristic(Vector eigenvalues, size_t count,
+                                          size_t n);
+static size_t _eigenpairs_count(size_t k, size_t n);
+static SpectralResult *_partial_spectral_embedding(Vector eigenvalues,
+                                                   Matrix *eigenvectors,
+                                                   size_t count, size_t k,
+                                                   size_t n);
 static int _compare_doubles(const void *a, const void *b);
 static int _compare_vectors_by_first_column(const void* a, const void* b);
 
@@ -13,19 +81,13 @@ static Matrix _get_first_k_eigenvectors(JacobiResult *jacobi_result, size_t k, s
 
 Matrix weighted_adjacency_matrix(Matrix data_points, size_t n, size_t m) {
     size_t i, j;
-    double dist;
     Matrix w = build_matrix(n, n);
+    GaussianWeightsKernel gaussian_weights = vector_kernels(m) -> gaussian_weights;
 
-    for (i = 0; i < n; i++){
-        for (j = i; j < n; j++){
-            if (i == j) {
-                w[i][j] = 0;
-                continue;
-            }
-
-            dist = squared_euclidean_distance(data_points[i], data_points[j], m);
-            w[i][j] = exp(-dist / 2);
-        }
+    /* Every row is a tile of the weights right of the zero diagonal */
+    for (i = 0; i + 1 < n; i++){
+        gaussian_weights(data_points[i], data_points + i + 1, n - i - 1,
+                         w[i] + i + 1, m);
     }
 
     for (i = 0; i < n; i++){
@@ -36,6 +98,130 @@ Matrix weighted_adjacency_matrix(Matrix data_points, size_t n, size_t m) {
     return w;
 }
 
+CsrMatrix *knn_weighted_adjacency_matrix(Matrix data_points, size_t n, size_t m,
+                                         size_t neighbors_count,
+                                         size_t threads_count) {
+    CsrMatrix *w = NULL;
+    KdTree *tree = NULL;
+    KnnContext context;
+
+    neighbors_count = (neighbors_count < n) ? neighbors_count : n - 1;
+    tree = build_kd_tree(data_points, n, m);
+    context.tree = tree;
+    context.data_points = data_points;
+    context.n = n;
+    context.neighbors_count = neighbors_count;
+    context.neighbors_idxs = (size_t *) malloc(
+        (n * neighbors_count + 1) * sizeof(size_t));
+    context.squared_distances = (Vector) malloc(
+        (n * neighbors_count + 1) * sizeof(double));
+    parallel_for((n + KNN_QUERIES_PER_TASK - 1) / KNN_QUERIES_PER_TASK,
+                 threads_count, _knn_queries, &context);
+    free_kd_tree(tree);
+
+    w = _symmetric_knn_graph(n, neighbors_count, context.neighbors_idxs,
+                             context.squared_distances);
+    free(context.neighbors_idxs);
+    free(context.squared_distances);
+    return w;
+}
+
+CsrMatrix *hnsw_weighted_adjacency_matrix(Matrix data_points, size_t n,
+                                          size_t m, size_t neighbors_count,
+                                          const HnswOptions *options,
+                                          size_t threads_count, double *recall) {
+    size_t *neighbors_idxs = NULL;
+    Vector squared_distances = NULL;
+    CsrMatrix *w = NULL;
+    HnswIndex *index = NULL;
+    RandomState rs;
+
+    neighbors_count = (neighbors_count < n) ? neighbors_count : n - 1;
+    index = build_hnsw_index(data_points, n, m, options, threads_count);
+    neighbors_idxs = (size_t *) malloc(
+        (n * neighbors_count + 1) * sizeof(size_t));
+    squared_distances = (Vector) malloc(
+        (n * neighbors_count + 1) * sizeof(double));
+    hnsw_all_nearest(index, neighbors_count, threads_count, neighbors_idxs,
+                     squared_distances);
+    if (recall != NULL) {
+        seed_random_state(&rs, options -> seed);
+        *recall = hnsw_recall(index, neighbors_count,
+                              options -> recall_sample_size, &rs);
+    }
+    free_hnsw_index(index);
+
+    w = _symmetric_knn_graph(n, neighbors_count, neighbors_idxs,
+                             squared_distances);
+    free(neighbors_idxs);
+    free(squared_distances);
+    return w;
+}
+
+CsrMatrix *radius_weighted_adjacency_matrix(Matrix data_points, size_t n,
+                                            size_t m, double radius,
+                                            size_t threads_count,
+                                            RadiusGraphBound *bound) {
+    size_t i, tasks_count, dropped_count, max_dropped_count = 0;
+    double max_weight;
+    GridIndex *grid = NULL;
+    RadiusContext context;
+
+    grid = build_grid_index(data_points, n, m, radius);
+    context.grid = grid;
+    context.radius = radius;
+    context.row_counts = (size_t *) calloc(n + 1, sizeof(size_t));
+    tasks_count = (n + RADIUS_QUERIES_PER_TASK - 1) / RADIUS_QUERIES_PER_TASK;
+    parallel_for(tasks_count, threads_count, _count_radius_rows, &context);
+
+    for (i = 0; i < n; i++) {
+        context.row_counts[i + 1] += context.row_counts[i];
+    }
+    context.w = build_csr_matrix(n, n, context.row_counts[n]);
+    memcpy(context.w -> row_starts, context.row_counts,
+           (n + 1) * sizeof(size_t));
+    parallel_for(tasks_count, threads_count, _fill_radius_rows, &context);
+
+    /* Every datapoint missing from a row is farther than the radius */
+    if (bound != NULL) {
+        max_weight = exp(-radius * radius / 2);
+        for (i = 0; i < n; i++) {
+            dropped_count = n - 1 - (context.w -> row_starts[i + 1] -
+                                     context.w -> row_starts[i]);
+            max_dropped_count = (dropped_count > max_dropped_count) ?
+                                dropped_count : max_dropped_count;
+        }
+        bound -> dropped_mass = max_weight *
+            (double) (n * (n - 1) - csr_nonzeros_count(context.w));
+        bound -> laplacian_error = 2 * max_weight * (double) max_dropped_count;
+    }
+
+    free(context.row_counts);
+    free_grid_index(grid);
+    return context.w;
+}
+
+CsrMatrix *sparse_weighted_adjacency_matrix(Matrix data_points, size_t n,
+                                            size_t m,
+                                            const SpectralOptions *options) {
+    switch (options -> graph) {
+        case KNN_GRAPH:
+            return knn_weighted_adjacency_matrix(
+                data_points, n, m, options -> neighbors_count,
+                options -> threads_count);
+        case HNSW_GRAPH:
+            return hnsw_weighted_adjacency_matrix(
+                data_points, n, m, options -> neighbors_count,
+                &options -> hnsw, options -> threads_count, NULL);
+        case RADIUS_GRAPH:
+            return radius_weighted_adjacency_matrix(
+                data_points, n, m, options -> radius,
+                options -> threads_count, NULL);
+        default:
+            return NULL;
+    }
+}
+
 Matrix diagonal_degree_matrix(Matrix w, size_t n) {
     size_t i, j;
     Matrix d = build_matrix(n, n);
@@ -52,10 +238,60 @@ Matrix graph_laplacian(Matrix d, Matrix w, size_t n) {
     return matrix_sub(d, w, n, n);
 }
 
+CsrMatrix *sparse_graph_laplacian(const CsrMatrix *w) {
+    size_t i, e, nonzeros_count = 0;
+    bool diagonal_set;
+    Vector degrees = csr_row_sums(w);
+    CsrMatrix *l = build_csr_matrix(w -> n, w -> n, csr_nonzeros_count(w) + w -> n);
+
+    for (i = 0; i < w -> n; i++) {
+        diagonal_set = false;
+        for (e = w -> row_starts[i]; e < w -> row_starts[i + 1]; e++) {
+            if (!diagonal_set && w -> columns[e] > i) {
+                l -> columns[nonzeros_count] = i;
+                l -> values[nonzeros_count++] = degrees[i];
+                diagonal_set = true;
+            }
+            l -> columns[nonzeros_count] = w -> columns[e];
+            l -> values[nonzeros_count++] = -(w -> values[e]);
+        }
+        if (!diagonal_set) {
+            l -> columns[nonzeros_count] = i;
+            l -> values[nonzeros_count++] = degrees[i];
+        }
+        l -> row_starts[i + 1] = nonzeros_count;
+    }
+
+    free(degrees);
+    return l;
+}
+
+void init_spectral_options(SpectralOptions *options) {
+    options -> engine = GRAPH_ENGINE;
+    options -> graph = DENSE_GRAPH;
+    options -> neighbors_count = DEFAULT_NEIGHBORS_COUNT;
+    init_hnsw_options(&options -> hnsw);
+    options -> radius = DEFAULT_RADIUS;
+    options -> eigensolver = AUTO_EIGENSOLVER;
+    init_lanczos_options(&options -> lanczos);
+    init_nystrom_options(&options -> nystrom);
+    init_lsc_options(&options -> lsc);
+    init_rff_options(&options -> rff);
+    options -> threads_count = 0;
+}
+
 SpectralResult *spectral_clustering(Matrix data_points, size_t k, size_t n, size_t m) {
-    Matrix wam = NULL;
-    Matrix ddg = NULL;
+    SpectralOptions options;
+
+    init_spectral_options(&options);
+    return spectral_clustering_with_options(data_points, k, n, m, &options);
+}
+
+SpectralResult *spectral_clustering_with_options(Matrix data_points, size_t k,
+                                                 size_t n, size_t m,
+                                                 const SpectralOptions *options) {
     Matrix gl = NULL;
+    CsrMatrix *sparse_wam = NULL, *sparse_gl = NULL;
     JacobiResult *jacobi_result = NULL;
     SpectralResult *spectral_result = NULL;
 
@@ -63,37 +299,213 @@ SpectralResult *spectral_clustering(Matrix data_points, size_t k, size_t n, size
         return NULL;
     }
 
-    spectral_result = (SpectralResult*) malloc(sizeof(SpectralResult));
-    wam = weighted_adjacency_matrix(data_points, n, m);
-    ddg = diagonal_degree_matrix(wam, n);
-    gl = graph_laplacian(ddg, wam, n);
+    if (options -> engine == NYSTROM_ENGINE) {
+        return nystrom_spectral_embedding(data_points, k, n, m,
+                                          &options -> nystrom,
+                                          options -> threads_count);
+    }
+    if (options -> engine == LSC_ENGINE) {
+        return lsc_spectral_embedding(data_points, k, n, m, &options -> lsc,
+                                      options -> threads_count);
+    }
+    if (options -> engine == RFF_ENGINE) {
+        return rff_spectral_embedding(data_points, k, n, m, &options -> rff,
+                                      &options -> lanczos,
+                                      options -> threads_count);
+    }
+
+    if (_uses_lanczos(options, n)) {
+        sparse_wam = sparse_weighted_adjacency_matrix(data_points, n, m,
+                                                      options);
+        sparse_gl = sparse_graph_laplacian(sparse_wam);
+        free_csr_matrix(sparse_wam);
+        spectral_result = sparse_spectral_embedding(
+            sparse_gl, k, &options -> lanczos, options -> threads_count);
+        free_csr_matrix(sparse_gl);
+        return spectral_result;
+    }
+
+    gl = _graph_laplacian_of(data_points, n, m, options);
     jacobi_result = jacobi(gl, n);
 
+    spectral_result = spectral_embedding(jacobi_result, k, n);
+
+    free_matrix(gl, n);
+    free_matrix(jacobi_result -> eigenvectors, n);
+    free(jacobi_result -> eigenvalues);
+    free(jacobi_result);
+
+    return spectral_result;
+}
+
+SpectralResult *spectral_embedding(JacobiResult *jacobi_result, size_t k, size_t n) {
+    SpectralResult *spectral_result = NULL;
+
+    if (k > n) {
+        return NULL;
+    }
+
     if (k == 0) {
         k = eigengap_heuristic(jacobi_result -> eigenvalues, n);
     }
 
+    spectral_result = (SpectralResult*) malloc(sizeof(SpectralResult));
     spectral_result -> k = k;
     spectral_result -> new_points = _get_first_k_eigenvectors(jacobi_result, k, n);
+    return spectral_result;
+}
 
-    free_matrix(wam, n);
-    free_matrix(ddg, n);
-    free_matrix(gl, n);
-    free_matrix(jacobi_result -> eigenvectors, n);
-    free(jacobi_result -> eigenvalues);
-    free(jacobi_result);
+SpectralResult *sparse_spectral_embedding(const CsrMatrix *l, size_t k,
+                                          const LanczosOptions *options,
+                                          size_t threads_count) {
+    size_t n = l -> n;
+    SparseLaplacian laplacian;
+    LanczosResult *lanczos_result = NULL;
+    SpectralResult *spectral_result = NULL;
+
+    if (k > n) {
+        return NULL;
+    }
+
+    laplacian.l = l;
+    laplacian.threads_count = threads_count;
+    lanczos_result = lanczos(_multiply_sparse_laplacian, &laplacian, n,
+                             _eigenpairs_count(k, n), options);
+    spectral_result = _partial_spectral_embedding(
+        lanczos_result -> eigenvalues, &lanczos_result -> eigenvectors,
+        lanczos_result -> k, k, n);
+    free_lanczos_result(lanczos_result);
+    return spectral_result;
+}
+
+SpectralResult *nystrom_spectral_embedding(Matrix data_points, size_t k,
+                                           size_t n, size_t m,
+                                           const NystromOptions *options,
+                                           size_t threads_count) {
+    NystromOptions landmarks_options = *options;
+    NystromResult *nystrom_result = NULL;
+    SpectralResult *spectral_result = NULL;
+
+    if (k > n) {
+        return NULL;
+    }
+
+    landmarks_options.landmarks_count = (options -> landmarks_count > k) ?
+                                        options -> landmarks_count : k;
+    nystrom_result = nystrom(data_points, n, m, _eigenpairs_count(k, n),
+                             &landmarks_options, threads_count);
+    spectral_result = _partial_spectral_embedding(
+        nystrom_result -> eigenvalues, &nystrom_result -> eigenvectors,
+        nystrom_result -> count, k, n);
+    free_nystrom_result(nystrom_result);
+    return spectral_result;
+}
+
+SpectralResult *lsc_spectral_embedding(Matrix data_points, size_t k, size_t n,
+                                       size_t m, const LscOptions *options,
+                                       size_t threads_count) {
+    LscOptions landmarks_options = *options;
+    LscResult *lsc_result = NULL;
+    SpectralResult *spectral_result = NULL;
 
+    if (k > n) {
+        return NULL;
+    }
+
+    landmarks_options.landmarks_count = (options -> landmarks_count > k) ?
+                                        options -> landmarks_count : k;
+    lsc_result = lsc(data_points, n, m, _eigenpairs_count(k, n),
+                     &landmarks_options, threads_count);
+    spectral_result = _partial_spectral_embedding(
+        lsc_result -> eigenvalues, &lsc_result -> eigenvectors,
+        lsc_result -> count, k, n);
+    free_lsc_result(lsc_result);
     return spectral_result;
 }
 
+SpectralResult *rff_spectral_embedding(Matrix data_points, size_t k, size_t n,
+                                       size_t m, const RffOptions *options,
+                                       const LanczosOptions *lanczos_options,
+                                       size_t threads_count) {
+    RffResult *rff_result = NULL;
+    SpectralResult *spectral_result = NULL;
+
+    if (k > n) {
+        return NULL;
+    }
+
+    rff_result = rff(data_points, n, m, _eigenpairs_count(k, n), options,
+                     lanczos_options, threads_count);
+    spectral_result = _partial_spectral_embedding(
+        rff_result -> eigenvalues, &rff_result -> eigenvectors,
+        rff_result -> count, k, n);
+    free_rff_result(rff_result);
+    return spectral_result;
+}
+
+SpkmeansResult *spkmeans(Matrix data_points, size_t k, size_t n, size_t m,
+                         const SpectralOptions *spectral_options,
+                         const KmeansOptions *options) {
+    size_t i;
+    Matrix points = NULL;
+    Cluster *clusters = NULL;
+    SpectralResult *spr = NULL;
+    SpkmeansResult *result = NULL;
+    RandomState rs;
+
+    spr = spectral_clustering_with_options(data_points, k, n, m,
+                                           spectral_options);
+    if (spr == NULL) {
+        return NULL;
+    }
+
+    k = spr -> k;
+    points = transpose(spr -> new_points, n, k);
+    result = (SpkmeansResult *) malloc(sizeof(SpkmeansResult));
+    result -> k = k;
+    result -> centroids_idxs = (size_t *) calloc(k, sizeof(size_t));
+    result -> centroids = build_matrix(k, k);
+    clusters = (Cluster *) malloc(k * sizeof(Cluster));
+
+    seed_random_state(&rs, options -> seed);
+    kmeanspp(points, n, k, k, NUMPY_COMPATIBLE_SEEDING, &rs,
+             result -> centroids_idxs);
+    for (i = 0; i < k; i++) {
+        clusters[i].centroid = result -> centroids[i];
+        memcpy(clusters[i].centroid, points[result -> centroids_idxs[i]],
+               k * sizeof(double));
+    }
+
+    fit_with_options(clusters, points, n, k, k, options,
+                     &result -> kmeans_result);
+
+    free(clusters);
+    free_matrix(points, n);
+    free_matrix(spr -> new_points, k);
+    free(spr);
+    return result;
+}
+
+void free_spkmeans_result(SpkmeansResult *result) {
+    free_kmeans_result(&result -> kmeans_result);
+    free(result -> centroids_idxs);
+    free_matrix(result -> centroids, result -> k);
+    free(result);
+}
+
+Vector sort_eigenvalues(Vector eigenvalues, size_t n) {
+    Vector sorted_eigenvalues = copy_vector(eigenvalues, n);
+
+    qsort(sorted_eigenvalues, n, sizeof(double), _compare_doubles);
+    return sorted_eigenvalues;
+}
+
 size_t eigengap_heuristic(Vector eigenvalues, size_t n) {
     size_t i;
     size_t max_index = 0;
     double max_delta = 0.0;
     Vector deltas = calloc(n - 1, sizeof(double));
-    Vector sorted_eigenvalues = copy_vector(eigenvalues, n);
-
-    qsort(sorted_eigenvalues, n, sizeof(double), _compare_doubles);
+    Vector sorted_eigenvalues = sort_eigenvalues(eigenvalues, n);
 
     for (i = 0; i < n - 1; i++) {
         deltas[i] = fabs(sorted_eigenvalues[i + 1] - sorted_eigenvalues[i]);
@@ -109,6 +521,235 @@ size_t eigengap_heuristic(Vector eigenvalues, size_t n) {
     return max_index + 1;
 }
 
+static void _knn_queries(void *context, size_t task_idx) {
+    KnnContext *knn = (KnnContext *) context;
+    size_t i, start = task_idx * KNN_QUERIES_PER_TASK;
+    size_t end = start + KNN_QUERIES_PER_TASK;
+
+    end = (end < knn -> n) ? end : knn -> n;
+    for (i = start; i < end; i++) {
+        kd_tree_nearest(knn -> tree, knn -> data_points[i],
+                        knn -> neighbors_count, i,
+                        knn -> neighbors_idxs + i * knn -> neighbors_count,
+                        knn -> squared_distances + i * knn -> neighbors_count);
+    }
+}
+
+/**
+ * Build the symmetric k-nearest-neighbors graph out of the neighbors_count
+ * neighbors of every datapoint, where a datapoint listed as its own neighbor
+ * marks a neighbor that wasn't found.
+ */
+static CsrMatrix *_symmetric_knn_graph(size_t n, size_t neighbors_count,
+                                       const size_t *neighbors_idxs,
+                                       const double *squared_distances) {
+    size_t i, j, e, row_start, row_end, nonzeros_count;
+    size_t *edge_starts = NULL, *cursors = NULL;
+    double weight;
+    CsrEntry *edges = NULL;
+    CsrMatrix *w = NULL;
+
+    /* Every neighbor is an edge of both its datapoint's row and its own row */
+    edge_starts = (size_t *) calloc(n + 1, sizeof(size_t));
+    for (i = 0; i < n; i++) {
+        for (e = i * neighbors_count; e < (i + 1) * neighbors_count; e++) {
+            if (neighbors_idxs[e] != i) {
+                ++edge_starts[i + 1];
+                ++edge_starts[neighbors_idxs[e] + 1];
+            }
+        }
+    }
+    for (i = 0; i < n; i++) {
+        edge_starts[i + 1] += edge_starts[i];
+    }
+    cursors = (size_t *) malloc((n + 1) * sizeof(size_t));
+    memcpy(cursors, edge_starts, (n + 1) * sizeof(size_t));
+    edges = (CsrEntry *) malloc((edge_starts[n] + 1) * sizeof(CsrEntry));
+    for (i = 0; i < n; i++) {
+        for (e = i * neighbors_count; e < (i + 1) * neighbors_count; e++) {
+            j = neighbors_idxs[e];
+            if (j == i) {
+                continue;
+            }
+            weight = exp(-squared_distances[e] / 2);
+            edges[cursors[i]].column = j;
+            edges[cursors[i]++].value = weight;
+            edges[cursors[j]].column = i;
+            edges[cursors[j]++].value = weight;
+        }
+    }
+    free(cursors);
+
+    /* Mutual neighbors are found from both sides, so sorted rows skip repeats */
+    w = build_csr_matrix(n, n, edge_starts[n]);
+    nonzeros_count = 0;
+    for (i = 0; i < n; i++) {
+        row_start = edge_starts[i];
+        row_end = edge_starts[i + 1];
+        qsort(edges + row_start, row_end - row_start, sizeof(CsrEntry),
+              _compare_csr_entries);
+        for (e = row_start; e < row_end; e++) {
+            if (e > row_start && edges[e].column == edges[e - 1].column) {
+                continue;
+            }
+            w -> columns[nonzeros_count] = edges[e].column;
+            w -> values[nonzeros_count++] = edges[e].value;
+        }
+        w -> row_starts[i + 1] = nonzeros_count;
+    }
+
+    free(edges);
+    free(edge_starts);
+    return w;
+}
+
+static void _count_radius_rows(void *context, size_t task_idx) {
+    RadiusContext *radius = (RadiusContext *) context;
+    size_t i, start = task_idx * RADIUS_QUERIES_PER_TASK;
+    size_t end = start + RADIUS_QUERIES_PER_TASK;
+
+    end = (end < radius -> grid -> n) ? end : radius -> grid -> n;
+    for (i = start; i < end; i++) {
+        radius -> row_counts[i + 1] = grid_radius_neighbors(
+            radius -> grid, i, radius -> radius, NULL, NULL);
+    }
+}
+
+static void _fill_radius_rows(void *context, size_t task_idx) {
+    RadiusContext *radius = (RadiusContext *) context;
+    CsrMatrix *w = radius -> w;
+    size_t i, e, row_start, count, start = task_idx * RADIUS_QUERIES_PER_TASK;
+    size_t end = start + RADIUS_QUERIES_PER_TASK, max_count = 0;
+    CsrEntry *entries = NULL;
+
+    end = (end < w -> n) ? end : w -> n;
+    for (i = start; i < end; i++) {
+        count = w -> row_starts[i + 1] - w -> row_starts[i];
+        max_count = (count > max_count) ? count : max_count;
+    }
+
+    /* The neighbors of a row are found unordered, so they are sorted */
+    entries = (CsrEntry *) malloc((max_count + 1) * sizeof(CsrEntry));
+    for (i = start; i < end; i++) {
+        row_start = w -> row_starts[i];
+        count = grid_radius_neighbors(radius -> grid, i, radius -> radius,
+                                      w -> columns + row_start,
+                                      w -> values + row_start);
+        for (e = 0; e < count; e++) {
+            entries[e].column = w -> columns[row_start + e];
+            entries[e].value = exp(-(w -> values[row_start + e]) / 2);
+        }
+        qsort(entries, count, sizeof(CsrEntry), _compare_csr_entries);
+        for (e = 0; e < count; e++) {
+            w -> columns[row_start + e] = entries[e].column;
+            w -> values[row_start + e] = entries[e].value;
+        }
+    }
+    free(entries);
+}
+
+static int _compare_csr_entries(const void *a, const void *b) {
+    size_t x = ((const CsrEntry *) a) -> column;
+    size_t y = ((const CsrEntry *) b) -> column;
+    return (x > y) - (y > x);
+}
+
+/**
+ * Build the graph Laplacian of the affinity graph the options select. jacobi
+ * needs a dense matrix, so the Laplacian of a sparse graph is densified.
+ */
+static Matrix _graph_laplacian_of(Matrix data_points, size_t n, size_t m,
+                                  const SpectralOptions *options) {
+    Matrix wam = NULL, ddg = NULL, gl = NULL;
+    CsrMatrix *sparse_wam = NULL, *sparse_gl = NULL;
+
+    sparse_wam = sparse_weighted_adjacency_matrix(data_points, n, m, options);
+    if (sparse_wam != NULL) {
+        sparse_gl = sparse_graph_laplacian(sparse_wam);
+        gl = csr_to_dense(sparse_gl);
+        free_csr_matrix(sparse_wam);
+        free_csr_matrix(sparse_gl);
+        return gl;
+    }
+
+    wam = weighted_adjacency_matrix(data_points, n, m);
+    ddg = diagonal_degree_matrix(wam, n);
+    gl = graph_laplacian(ddg, wam, n);
+    free_matrix(wam, n);
+    free_matrix(ddg, n);
+    return gl;
+}
+
+static bool _uses_lanczos(const SpectralOptions *options, size_t n) {
+    if (options -> graph == DENSE_GRAPH) {
+        return false;
+    }
+    if (options -> eigensolver == AUTO_EIGENSOLVER) {
+        return n >= LANCZOS_MIN_ORDER;
+    }
+    return options -> eigensolver == LANCZOS_EIGENSOLVER;
+}
+
+static void _multiply_sparse_laplacian(void *context, const double *x,
+                                       Vector y) {
+    SparseLaplacian *laplacian = (SparseLaplacian *) context;
+
+    csr_multiply_vector(laplacian -> l, x, y, laplacian -> threads_count);
+}
+
+/**
+ * Run the eigengap heuristic on the count smallest eigenvalues of an order n
+ * Laplacian, in ascending order, so only the gaps among them are considered.
+ */
+static size_t _partial_eigengap_heuristic(Vector eigenvalues, size_t count,
+                                          size_t n) {
+    size_t i, max_index = 0;
+    double delta, max_delta = 0.0;
+
+    for (i = 0; i + 1 < count && i < n / 2; i++) {
+        delta = fabs(eigenvalues[i + 1] - eigenvalues[i]);
+        if (delta > max_delta) {
+            max_delta = delta;
+            max_index = i;
+        }
+    }
+    return max_index + 1;
+}
+
+/**
+ * The number of eigenpairs an engine finds for an embedding of order n: k, or
+ * SPARSE_EIGENGAP_COUNT (at most n) for the eigengap heuristic if k == 0.
+ */
+static size_t _eigenpairs_count(size_t k, size_t n) {
+    if (k > 0) {
+        return k;
+    }
+    return (SPARSE_EIGENGAP_COUNT < n) ? SPARSE_EIGENGAP_COUNT : n;
+}
+
+/**
+ * Embed the order n datapoints by the first k of the count eigenpairs an
+ * engine found, in ascending order, with k chosen among them by the eigengap
+ * heuristic if it's 0. The eigenvectors' rows are the embedding's, so the
+ * result takes over their matrix, and *eigenvectors is set to NULL for the
+ * engine's result to be freed without it.
+ */
+static SpectralResult *_partial_spectral_embedding(Vector eigenvalues,
+                                                   Matrix *eigenvectors,
+                                                   size_t count, size_t k,
+                                                   size_t n) {
+    SpectralResult *spectral_result =
+        (SpectralResult *) malloc(sizeof(SpectralResult));
+
+    if (k == 0) {
+        k = _partial_eigengap_heuristic(eigenvalues, count, n);
+    }
+    spectral_result -> k = k;
+    spectral_result -> new_points = *eigenvectors;
+    *eigenvectors = NULL;
+    return spectral_result;
+}
+
 static int _compare_doubles(const void *a, const void *b) {
     double x = *(double *) a;
     double y = *(double *) b;
@@ -1,18 +1,118 @@
 #ifndef SPECTRAL_H
 #define SPECTRAL_H
 
+#include "csr.h"
+#include "hnsw.h"
 #include "jacobi.h"
+#include "kmeans.h"
+#include "lanczos.h"
+#include "lsc.h"
 #include "matrix.h"
+#include "nystrom.h"
+#include "rff.h"
 #include "vector.h"
 #include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
 
+#define DEFAULT_NEIGHBORS_COUNT 10
+#define DEFAULT_RADIUS 3.0
+#define LANCZOS_MIN_ORDER 1000
+#define SPARSE_EIGENGAP_COUNT 32
+
+/**
+ * The graph whose weights the affinity between datapoints is taken from: the
+ * dense graph connects every two datapoints, and the k-nearest-neighbors graph
+ * connects every datapoint to its nearest ones, found exactly with a KD-tree
+ * or approximately with a HNSW index. The radius graph connects every two
+ * datapoints within a radius of each other, found with a uniform grid.
+ */
+typedef enum AffinityGraph {
+    DENSE_GRAPH,
+    KNN_GRAPH,
+    HNSW_GRAPH,
+    RADIUS_GRAPH
+} AffinityGraph;
+
+/**
+ * The eigensolver of the graph Laplacian: jacobi on the dense Laplacian, or
+ * lanczos on the sparse Laplacian of a sparse graph, which never densifies it.
+ * The automatic choice is lanczos for sparse graphs of at least
+ * LANCZOS_MIN_ORDER datapoints, and jacobi otherwise.
+ */
+typedef enum SpectralEigensolver {
+    AUTO_EIGENSOLVER,
+    JACOBI_EIGENSOLVER,
+    LANCZOS_EIGENSOLVER
+} SpectralEigensolver;
+
+/**
+ * The engine of the spectral embedding: the graph engine decomposes the graph
+ * Laplacian of the affinity graph with the eigensolver, and the Nystrom engine
+ * approximates its eigenvectors with nystrom, from the affinities to a sample
+ * of landmarks only. The LSC engine embeds with lsc, through a graph of the
+ * datapoints coded by their nearest K-means landmarks, and the RFF engine
+ * embeds with rff, through the affinities approximated by random Fourier
+ * features.
+ */
+typedef enum SpectralEngine {
+    GRAPH_ENGINE,
+    NYSTROM_ENGINE,
+    LSC_ENGINE,
+    RFF_ENGINE
+} SpectralEngine;
+
+/**
+ * The options of the spectral clustering stages: the engine, the affinity
+ * graph, the number of neighbors of every datapoint in a KNN_GRAPH or a
+ * HNSW_GRAPH, the options of the HNSW index of a HNSW_GRAPH, the radius of a
+ * RADIUS_GRAPH, the eigensolver and its Lanczos options, the options of the
+ * Nystrom, LSC and RFF engines, and the number of threads to build the graphs and multiply
+ * sparse Laplacians with (0 for default_threads_count()).
+ */
+typedef struct SpectralOptions {
+    SpectralEngine engine;
+    AffinityGraph graph;
+    size_t neighbors_count;
+    HnswOptions hnsw;
+    double radius;
+    SpectralEigensolver eigensolver;
+    LanczosOptions lanczos;
+    NystromOptions nystrom;
+    LscOptions lsc;
+    RffOptions rff;
+    size_t threads_count;
+} SpectralOptions;
+
+/**
+ * Upper bounds on the error of dropping the weights of the datapoints farther
+ * than the radius of a RADIUS_GRAPH: on the sum of the dropped weights, and on
+ * the spectral norm of the difference it makes to the graph Laplacian, which
+ * bounds the shift of every eigenvalue too.
+ */
+typedef struct RadiusGraphBound {
+    double dropped_mass;
+    double laplacian_error;
+} RadiusGraphBound;
+
 typedef struct SpectralResult {
     size_t k;
     Matrix new_points;
 } SpectralResult;
 
+/**
+ * The outcome of the full spectral clustering pipeline: the effective k value,
+ * the indices of the k embedded points K-means++ chose as initial centroids,
+ * the k x k matrix of the final centroids, and the K-means result with the
+ * label of every point.
+ */
+typedef struct SpkmeansResult {
+    size_t k;
+    size_t *centroids_idxs;
+    Matrix centroids;
+    KmeansResult kmeans_result;
+} SpkmeansResult;
+
 /**
  * Receive an array of datapoints and its dimensions and calculate the weighted
  * adjacency matrix of it. The function allocates memory for the new matrix, so
@@ -20,6 +120,65 @@ typedef struct SpectralResult {
  */
 Matrix weighted_adjacency_matrix(Matrix data_points, size_t n, size_t m);
 
+/**
+ * Receive an array of datapoints, its dimensions, a number of neighbors and a
+ * number of threads, and calculate the weighted adjacency matrix of the
+ * symmetric k-nearest-neighbors graph of the datapoints as a sparse matrix:
+ * w_ij = exp(-||x_i - x_j||^2 / 2) if x_j is one of the neighbors_count
+ * nearest datapoints of x_i or the other way around, and w_ij = 0 otherwise.
+ * The neighbors are found with a KD-tree, concurrently on threads_count
+ * threads (0 for default_threads_count()). The function allocates memory for
+ * the new matrix, so it's the caller's responsibility to free it.
+ */
+CsrMatrix *knn_weighted_adjacency_matrix(Matrix data_points, size_t n, size_t m,
+                                         size_t neighbors_count,
+                                         size_t threads_count);
+
+/**
+ * Receive an array of datapoints, its dimensions, a number of neighbors, HNSW
+ * options, a number of threads and a pointer to a recall (or NULL), and
+ * calculate the weighted adjacency matrix of the symmetric
+ * k-nearest-neighbors graph like knn_weighted_adjacency_matrix, with the
+ * neighbors found approximately by a HNSW index, which stays fast in high
+ * dimensions where a KD-tree degrades to a brute force search. If recall isn't
+ * NULL, it's set to the fraction of the exact neighbors of
+ * options -> recall_sample_size random datapoints that the index finds. The
+ * function allocates memory for the new matrix, so it's the caller's
+ * responsibility to free it.
+ */
+CsrMatrix *hnsw_weighted_adjacency_matrix(Matrix data_points, size_t n,
+                                          size_t m, size_t neighbors_count,
+                                          const HnswOptions *options,
+                                          size_t threads_count, double *recall);
+
+/**
+ * Receive an array of datapoints, its dimensions, a positive radius, a number
+ * of threads and a pointer to a bound (or NULL), and calculate the weighted
+ * adjacency matrix of the radius graph of the datapoints as a sparse matrix:
+ * w_ij = exp(-||x_i - x_j||^2 / 2) if ||x_i - x_j|| <= radius, and w_ij = 0
+ * otherwise. The datapoints are hashed into a uniform grid of cells of the
+ * radius, so only the datapoints of adjacent cells are compared, concurrently
+ * on threads_count threads (0 for default_threads_count()). Every dropped
+ * weight is below exp(-radius^2 / 2), so if bound isn't NULL, it's set to the
+ * bounds that follow from it. The function allocates memory for the new
+ * matrix, so it's the caller's responsibility to free it.
+ */
+CsrMatrix *radius_weighted_adjacency_matrix(Matrix data_points, size_t n,
+                                            size_t m, double radius,
+                                            size_t threads_count,
+                                            RadiusGraphBound *bound);
+
+/**
+ * Receive an array of datapoints, its dimensions and spectral clustering
+ * options, and calculate the weighted adjacency matrix of the sparse affinity
+ * graph the options select, or return NULL for the DENSE_GRAPH. The function
+ * allocates memory for the new matrix, so it's the caller's responsibility to
+ * free it.
+ */
+CsrMatrix *sparse_weighted_adjacency_matrix(Matrix data_points, size_t n,
+                                            size_t m,
+                                            const SpectralOptions *options);
+
 /**
  * Receive a square matrix and its order and calculate the diagonal degree
  * matrix of it. The function allocates memory for the new matrix, so it's the
@@ -35,6 +194,23 @@ Matrix diagonal_degree_matrix(Matrix w, size_t n);
  */
 Matrix graph_laplacian(Matrix d, Matrix w, size_t n);
 
+/**
+ * Receive a sparse weighted adjacency matrix without diagonal entries, and
+ * calculate its graph Laplacian D - W as a sparse matrix. The function
+ * allocates memory for the new matrix, so it's the caller's responsibility to
+ * free it.
+ */
+CsrMatrix *sparse_graph_laplacian(const CsrMatrix *w);
+
+/**
+ * Receive spectral clustering options and set them to the defaults: the graph
+ * engine on the dense graph, DEFAULT_NEIGHBORS_COUNT neighbors, the default
+ * HNSW options, a DEFAULT_RADIUS radius, the automatic eigensolver with the
+ * default Lanczos options, the default Nystrom, LSC and RFF options, and the
+ * default number of threads.
+ */
+void init_spectral_options(SpectralOptions *options);
+
 /**
  * Receive an array of datapoints, its dimensions and the value k.
  * Runs the spectral clustering algorithm and returns an array of new datapoints
@@ -44,6 +220,105 @@ Matrix graph_laplacian(Matrix d, Matrix w, size_t n);
 SpectralResult *spectral_clustering(Matrix data_points, size_t k, size_t n,
                                     size_t m);
 
+/**
+ * Receive an array of datapoints, its dimensions, the value k and spectral
+ * clustering options, and run spectral_clustering on the affinity graph the
+ * options select. The graph Laplacian of a sparse graph is built sparse, and
+ * either passed to sparse_spectral_embedding or densified for jacobi, as the
+ * options' eigensolver selects. The Nystrom, LSC and RFF engines skip the graph
+ * and embed the datapoints with nystrom_spectral_embedding,
+ * lsc_spectral_embedding and rff_spectral_embedding instead.
+ */
+SpectralResult *spectral_clustering_with_options(Matrix data_points, size_t k,
+                                                 size_t n, size_t m,
+                                                 const SpectralOptions *options);
+
+/**
+ * Receive the Jacobi result of a graph Laplacian, its order and the value k,
+ * and return the k eigenvectors of the smallest eigenvalues (as the k rows of
+ * new_points) and the effective k value used. If k == 0, the function will use
+ * the eigengap heuristic to determine the best k value, and if k > n, NULL is
+ * returned.
+ */
+SpectralResult *spectral_embedding(JacobiResult *jacobi_result, size_t k,
+                                   size_t n);
+
+/**
+ * Receive a sparse graph Laplacian, the value k, Lanczos options and a number
+ * of threads, and return the k eigenvectors of the smallest eigenvalues (as the
+ * k rows of new_points, like spectral_embedding) and the effective k value
+ * used, found with lanczos through products with the sparse Laplacian. If
+ * k == 0, the eigengap heuristic picks k out of the SPARSE_EIGENGAP_COUNT
+ * smallest eigenvalues, and if k > n, NULL is returned.
+ */
+SpectralResult *sparse_spectral_embedding(const CsrMatrix *l, size_t k,
+                                          const LanczosOptions *options,
+                                          size_t threads_count);
+
+/**
+ * Receive an array of datapoints, its dimensions, the value k, Nystrom options
+ * and a number of threads, and return the k approximate eigenvectors of the
+ * smallest eigenvalues found by nystrom (as the k rows of new_points, like
+ * spectral_embedding) and the effective k value used. At least k landmarks are
+ * sampled. If k == 0, the eigengap heuristic picks k out of the
+ * SPARSE_EIGENGAP_COUNT smallest approximate eigenvalues, and if k > n, NULL
+ * is returned.
+ */
+SpectralResult *nystrom_spectral_embedding(Matrix data_points, size_t k,
+                                           size_t n, size_t m,
+                                           const NystromOptions *options,
+                                           size_t threads_count);
+
+/**
+ * Receive an array of datapoints, its dimensions, the value k, LSC options and
+ * a number of threads, and return the k eigenvectors of the smallest
+ * eigenvalues found by lsc (as the k rows of new_points, like
+ * spectral_embedding) and the effective k value used. At least k landmarks are
+ * chosen. If k == 0, the eigengap heuristic picks k out of the
+ * SPARSE_EIGENGAP_COUNT smallest eigenvalues, and if k > n, NULL is returned.
+ */
+SpectralResult *lsc_spectral_embedding(Matrix data_points, size_t k, size_t n,
+                                       size_t m, const LscOptions *options,
+                                       size_t threads_count);
+
+/**
+ * Receive an array of datapoints, its dimensions, the value k, RFF options,
+ * Lanczos options and a number of threads, and return the k eigenvectors of
+ * the smallest eigenvalues found by rff (as the k rows of new_points, like
+ * spectral_embedding) and the effective k value used. If k == 0, the eigengap
+ * heuristic picks k out of the SPARSE_EIGENGAP_COUNT smallest eigenvalues,
+ * and if k > n, NULL is returned.
+ */
+SpectralResult *rff_spectral_embedding(Matrix data_points, size_t k, size_t n,
+                                       size_t m, const RffOptions *options,
+                                       const LanczosOptions *lanczos_options,
+                                       size_t threads_count);
+
+/**
+ * Receive a vector of eigenvalues and its length, and return a new vector of
+ * the eigenvalues in ascending order. The function allocates memory for the
+ * new vector, so it's the caller's responsibility to free it.
+ */
+Vector sort_eigenvalues(Vector eigenvalues, size_t n);
+
+/**
+ * Receive an array of datapoints, its dimensions, the value k, spectral
+ * clustering options and K-means options, and run the full spectral clustering
+ * pipeline: embed the datapoints with spectral_clustering_with_options, choose initial centroids out of the embedded
+ * points with K-means++ in NUMPY_COMPATIBLE_SEEDING mode using a random state
+ * seeded by options -> seed, and fit them with fit_with_options. Return NULL if
+ * k > n. The function allocates memory for the result, so it's the caller's
+ * responsibility to free it with free_spkmeans_result.
+ */
+SpkmeansResult *spkmeans(Matrix data_points, size_t k, size_t n, size_t m,
+                         const SpectralOptions *spectral_options,
+                         const KmeansOptions *options);
+
+/**
+ * Receive a result of spkmeans and free it.
+ */
+void free_spkmeans_result(SpkmeansResult *result);
+
 /**
  * Receive a vector of eigenvalues and determine the best k value to use with
  * these eigenvalues.
@@ -6,7 +6,9 @@
 #define DEBUG false
 #endif
 
-#define NUM_OF_ARGS 3
+#define MIN_NUM_OF_ARGS 3
+#define MAX_NUM_OF_ARGS 4
+#define OPTIONS "b:e:f:g:l:n:r:s"
 #define FATAL_ERROR() {\
     printf("An Error Has Occurred\n");\
     exit(EXIT_FAILURE);\
@@ -18,6 +20,7 @@
 #include <string.h>
 #include <unistd.h>
 #include "jacobi.h"
+#include "kmeans.h"
 #include "matrix.h"
 #include "spectral.h"
 #include "spkmeans.h"
@@ -60,6 +63,27 @@ int main(int argc, char *argv[]) {
         return EXIT_SUCCESS;
     }
 
+    if (args -> goal == SPK) {
+        if (!spk(input, args -> k, args -> batch_size, n, m,
+                 &args -> spectral_options)) {
+            free(args);
+            free_matrix(input, n);
+            FATAL_ERROR();
+        }
+
+        free(args);
+        free_matrix(input, n);
+        return EXIT_SUCCESS;
+    }
+
+    if (args -> spectral_options.graph != DENSE_GRAPH) {
+        print_sparse_goal(args -> goal, input, n, m, &args -> spectral_options,
+                          args -> csr_output);
+        free(args);
+        free_matrix(input, n);
+        return EXIT_SUCCESS;
+    }
+
     wam = weighted_adjacency_matrix(input, n, m);
     if (args -> goal == WAM) {
         print_matrix(wam, n, n);
@@ -102,18 +126,139 @@ static Goal create_goal_from_name(char *goal_name) {
     return UNKNOWN;
 }
 
+static bool graph_from_name(char *graph_name, AffinityGraph *graph) {
+    size_t i;
+
+    for (i = 0; graph_names[i] != NULL; i++) {
+        if (strcmp(graph_names[i], graph_name) == 0) {
+            *graph = (AffinityGraph) i;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static bool engine_from_name(char *engine_name, SpectralEngine *engine) {
+    size_t i;
+
+    for (i = 0; engine_names[i] != NULL; i++) {
+        if (strcmp(engine_names[i], engine_name) == 0) {
+            *engine = (SpectralEngine) i;
+            return true;
+        }
+    }
+
+    return false;
+}
+
 static CommandLineArguments* handle_args(int argc, char *argv[]) {
     CommandLineArguments* args = NULL;
+    char *number_end = NULL;
+    long k = 0, batch_size = 0, neighbors_count, landmarks_count;
+    long features_count;
+    int option, positional_count;
+    bool csr_output = false, graph_given = false;
+    SpectralOptions spectral_options;
+
+    init_spectral_options(&spectral_options);
+    opterr = 0;
+    while ((option = getopt(argc, argv, OPTIONS)) != -1) {
+        switch (option) {
+            case 'b':
+                batch_size = strtol(optarg, &number_end, 10);
+                if (*number_end != '\0' || batch_size <= 0) {
+                    FATAL_ERROR();
+                }
+                break;
+            case 'e':
+                if (!engine_from_name(optarg, &spectral_options.engine)) {
+                    FATAL_ERROR();
+                }
+                break;
+            case 'f':
+                features_count = strtol(optarg, &number_end, 10);
+                if (*number_end != '\0' || features_count <= 0) {
+                    FATAL_ERROR();
+                }
+                spectral_options.rff.features_count = (size_t) features_count;
+                break;
+            case 'g':
+                graph_given = true;
+                if (!graph_from_name(optarg, &spectral_options.graph)) {
+                    FATAL_ERROR();
+                }
+                break;
+            case 'l':
+                landmarks_count = strtol(optarg, &number_end, 10);
+                if (*number_end != '\0' || landmarks_count <= 0) {
+                    FATAL_ERROR();
+                }
+                spectral_options.nystrom.landmarks_count =
+                    (size_t) landmarks_count;
+                spectral_options.lsc.landmarks_count =
+                    (size_t) landmarks_count;
+                break;
+            case 'n':
+                graph_given = true;
+                neighbors_count = strtol(optarg, &number_end, 10);
+                if (*number_end != '\0' || neighbors_count <= 0) {
+                    FATAL_ERROR();
+                }
+                spectral_options.neighbors_count = (size_t) neighbors_count;
+                break;
+            case 'r':
+                graph_given = true;
+                spectral_options.radius = strtod(optarg, &number_end);
+                if (*number_end != '\0' || !(spectral_options.radius > 0)) {
+                    FATAL_ERROR();
+                }
+                break;
+            case 's':
+                graph_given = true;
+                csr_output = true;
+                break;
+            default:
+                FATAL_ERROR();
+        }
+    }
+
+    /* Only the matrices of sparse graphs are kept in CSR form */
+    if (csr_output && spectral_options.graph == DENSE_GRAPH) {
+        FATAL_ERROR();
+    }
 
-    if (argc != NUM_OF_ARGS) {
+    positional_count = argc - optind + 1;
+    if (positional_count < MIN_NUM_OF_ARGS ||
+            positional_count > MAX_NUM_OF_ARGS) {
         FATAL_ERROR();
     }
 
+    if (positional_count == MAX_NUM_OF_ARGS) {
+        k = strtol(argv[optind], &number_end, 10);
+        if (*number_end != '\0' || k <= 0) {
+            FATAL_ERROR();
+        }
+    }
+
     args = (CommandLineArguments *) malloc(sizeof(CommandLineArguments));
-    args -> goal = create_goal_from_name(argv[1]);
-    args -> input_file_path = argv[2];
+    args -> k = (size_t) k;
+    args -> batch_size = (size_t) batch_size;
+    args -> spectral_options = spectral_options;
+    args -> csr_output = csr_output;
+    args -> goal = create_goal_from_name(argv[argc - 2]);
+    args -> input_file_path = argv[argc - 1];
 
+    /*
+     * Only spk takes a k, a batch size and an engine, since the other engines
+     * only embed, without the matrices of a graph, and jacobi takes no graph
+     * at all, as it decomposes the input matrix itself.
+     */
     if (args -> goal == UNKNOWN ||
+            (args -> goal != SPK &&
+             (positional_count == MAX_NUM_OF_ARGS || batch_size > 0 ||
+              spectral_options.engine != GRAPH_ENGINE)) ||
+            (args -> goal == JACOBI && graph_given) ||
             access(args -> input_file_path, R_OK) != 0) {
         free(args);
         FATAL_ERROR();
@@ -121,3 +266,101 @@ static CommandLineArguments* handle_args(int argc, char *argv[]) {
 
     return args;
 }
+
+static bool spk(Matrix input, size_t k, size_t batch_size, size_t n,
+                size_t m, const SpectralOptions *spectral_options) {
+    KmeansOptions options;
+    SpkmeansResult *result = NULL;
+
+    init_kmeans_options(&options);
+    options.algorithm = AUTO;
+    options.batch_size = batch_size;
+    options.seed = SPK_SEED;
+
+    result = spkmeans(input, k, n, m, spectral_options, &options);
+    if (result == NULL) {
+        return false;
+    }
+
+    if (DEBUG) {
+        fprintf(stderr, "k-means: %lu iterations, inertia %f, "
+                "%lu distances computed, %lu skipped\n",
+                (unsigned long) result -> kmeans_result.iterations,
+                result -> kmeans_result.inertia,
+                (unsigned long) result -> kmeans_result.statistics.distance_computations,
+                (unsigned long) result -> kmeans_result.statistics.skipped_distance_computations);
+    }
+
+    print_indices(result -> centroids_idxs, result -> k);
+    print_matrix(result -> centroids, result -> k, result -> k);
+
+    free_spkmeans_result(result);
+    return true;
+}
+
+/**
+ * Print the wam, ddg or gl goal of a sparse affinity graph, either in full,
+ * the same way the goals of the dense graph are, or by its non-zero entries.
+ */
+static void print_sparse_goal(Goal goal, Matrix input, size_t n, size_t m,
+                              const SpectralOptions *spectral_options,
+                              bool csr_output) {
+    size_t i;
+    Matrix dense = NULL;
+    Vector degrees = NULL;
+    CsrMatrix *wam = NULL, *printed = NULL;
+    RadiusGraphBound bound;
+
+    if (spectral_options -> graph == RADIUS_GRAPH) {
+        wam = radius_weighted_adjacency_matrix(
+            input, n, m, spectral_options -> radius,
+            spectral_options -> threads_count, &bound);
+        if (DEBUG) {
+            fprintf(stderr, "radius graph: dropped weights sum to at most %f, "
+                    "Laplacian error at most %f\n",
+                    bound.dropped_mass, bound.laplacian_error);
+        }
+    } else {
+        wam = sparse_weighted_adjacency_matrix(input, n, m, spectral_options);
+    }
+
+    if (goal == WAM) {
+        printed = wam;
+        wam = NULL;
+    } else if (goal == DDG) {
+        printed = build_csr_matrix(n, n, n);
+        degrees = csr_row_sums(wam);
+        for (i = 0; i < n; i++) {
+            printed -> columns[i] = i;
+            printed -> values[i] = degrees[i];
+            printed -> row_starts[i + 1] = i + 1;
+        }
+        free(degrees);
+    } else {
+        printed = sparse_graph_laplacian(wam);
+    }
+
+    if (csr_output) {
+        print_csr_matrix(printed);
+    } else {
+        dense = csr_to_dense(printed);
+        print_matrix(dense, n, n);
+        free_matrix(dense, n);
+    }
+
+    free_csr_matrix(printed);
+    if (wam != NULL) {
+        free_csr_matrix(wam);
+    }
+}
+
+static void print_indices(size_t *indices, size_t n) {
+    size_t i;
+    for (i = 0; i < n; i++) {
+        printf("%lu", (unsigned long) indices[i]);
+        if (i < n - 1) {
+            printf(",");
+        }
+    }
+    printf("\n");
+}
@@ -2,18 +2,36 @@
 #define SPKMEANS_H
 
 #include "matrix.h"
+#include "spectral.h"
+#include <stdbool.h>
 #include <stddef.h>
 
-typedef enum Goal { WAM, DDG, GL, JACOBI, UNKNOWN } Goal;
+#define SPK_SEED 0
+
+typedef enum Goal { SPK, WAM, DDG, GL, JACOBI, UNKNOWN } Goal;
 
 typedef struct CommandLineArguments {
+    size_t k;
+    size_t batch_size;
+    SpectralOptions spectral_options;
+    bool csr_output;
     enum Goal goal;
     char *input_file_path;
 } CommandLineArguments;
 
-static char *goal_names[] = {"wam", "ddg", "gl", "jacobi", "unknown", NULL};
+static char *goal_names[] = {"spk", "wam", "ddg", "gl", "jacobi", "unknown", NULL};
+static char *graph_names[] = {"dense", "knn", "hnsw", "radius", NULL};
+static char *engine_names[] = {"graph", "nystrom", "lsc", "rff", NULL};
 
 static Goal create_goal_from_name(char *goal_name);
+static bool graph_from_name(char *graph_name, AffinityGraph *graph);
+static bool engine_from_name(char *engine_name, SpectralEngine *engine);
 static CommandLineArguments *handle_args(int argc, char *argv[]);
+static bool spk(Matrix input, size_t k, size_t batch_size, size_t n,
+                size_t m, const SpectralOptions *spectral_options);
+static void print_sparse_goal(Goal goal, Matrix input, size_t n, size_t m,
+                              const SpectralOptions *spectral_options,
+                              bool csr_output);
+static void print_indices(size_t *indices, size_t n);
 
 #endif
@@ -3,6 +3,136 @@
 #include <stdlib.h>
 #include "vector.h"
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/*
+ * The kernels specialized for every order up to MAX_UNROLLED_SIZE are
+ * generated by _DEFINE_KERNELS. Their distances add up the same terms in the
+ * same order as squared_euclidean_distance: blocks of 4 coordinates, followed
+ * by the remaining 0-3 coordinates one at a time, so they give identical
+ * results.
+ */
+#define _DISTANCE_TERM(i) { \
+    double diff = p[i] - q[i]; \
+    distance += diff * diff; \
+}
+
+#ifdef __SSE2__
+#define _DISTANCE_DECLARATIONS \
+    double partial_sums[2]; \
+    double distance; \
+    __m128d acc0 = _mm_setzero_pd(), acc1 = _mm_setzero_pd();
+#define _DISTANCE_BLOCK(i) { \
+    __m128d d0 = _mm_sub_pd(_mm_loadu_pd(p + (i)), _mm_loadu_pd(q + (i))); \
+    __m128d d1 = _mm_sub_pd(_mm_loadu_pd(p + (i) + 2), \
+                            _mm_loadu_pd(q + (i) + 2)); \
+    acc0 = _mm_add_pd(acc0, _mm_mul_pd(d0, d0)); \
+    acc1 = _mm_add_pd(acc1, _mm_mul_pd(d1, d1)); \
+}
+#define _DISTANCE_BLOCKS_END \
+    _mm_storeu_pd(partial_sums, _mm_add_pd(acc0, acc1)); \
+    distance = partial_sums[0] + partial_sums[1];
+#else
+#define _DISTANCE_DECLARATIONS double distance = 0.0;
+#define _DISTANCE_BLOCK(i) \
+    _DISTANCE_TERM(i) _DISTANCE_TERM((i) + 1) \
+    _DISTANCE_TERM((i) + 2) _DISTANCE_TERM((i) + 3)
+#define _DISTANCE_BLOCKS_END
+#endif
+
+#define _DISTANCE_BLOCKS_0
+#define _DISTANCE_BLOCKS_1 _DISTANCE_BLOCK(0)
+#define _DISTANCE_BLOCKS_2 _DISTANCE_BLOCKS_1 _DISTANCE_BLOCK(4)
+#define _DISTANCE_BLOCKS_3 _DISTANCE_BLOCKS_2 _DISTANCE_BLOCK(8)
+#define _DISTANCE_BLOCKS_4 _DISTANCE_BLOCKS_3 _DISTANCE_BLOCK(12)
+
+#define _DISTANCE_TAIL_0(i)
+#define _DISTANCE_TAIL_1(i) _DISTANCE_TERM(i)
+#define _DISTANCE_TAIL_2(i) _DISTANCE_TAIL_1(i) _DISTANCE_TERM((i) + 1)
+#define _DISTANCE_TAIL_3(i) _DISTANCE_TAIL_2(i) _DISTANCE_TERM((i) + 2)
+
+#define _ADD_TERM(i) sum[i] += vector[i];
+
+#define _UNROLL_1(X) X(0)
+#define _UNROLL_2(X) _UNROLL_1(X) X(1)
+#define _UNROLL_3(X) _UNROLL_2(X) X(2)
+#define _UNROLL_4(X) _UNROLL_3(X) X(3)
+#define _UNROLL_5(X) _UNROLL_4(X) X(4)
+#define _UNROLL_6(X) _UNROLL_5(X) X(5)
+#define _UNROLL_7(X) _UNROLL_6(X) X(6)
+#define _UNROLL_8(X) _UNROLL_7(X) X(7)
+#define _UNROLL_9(X) _UNROLL_8(X) X(8)
+#define _UNROLL_10(X) _UNROLL_9(X) X(9)
+#define _UNROLL_11(X) _UNROLL_10(X) X(10)
+#define _UNROLL_12(X) _UNROLL_11(X) X(11)
+#define _UNROLL_13(X) _UNROLL_12(X) X(12)
+#define _UNROLL_14(X) _UNROLL_13(X) X(13)
+#define _UNROLL_15(X) _UNROLL_14(X) X(14)
+#define _UNROLL_16(X) _UNROLL_15(X) X(15)
+
+/*
+ * Define the kernels of order M, which is made of BLOCKS blocks of 4
+ * coordinates and TAIL remaining coordinates.
+ */
+#define _DEFINE_KERNELS(M, BLOCKS, TAIL) \
+static double _squared_distance_##M(Vector p, Vector q, size_t m) { \
+    _DISTANCE_DECLARATIONS \
+    (void) m; \
+    _DISTANCE_BLOCKS_##BLOCKS \
+    _DISTANCE_BLOCKS_END \
+    _DISTANCE_TAIL_##TAIL(4 * BLOCKS) \
+    return distance; \
+} \
+static void _add_vector_##M(Vector sum, Vector vector, size_t m) { \
+    (void) m; \
+    _UNROLL_##M(_ADD_TERM) \
+} \
+static void _gaussian_weights_##M(Vector point, Vector *points, size_t count, \
+                                  Vector weights, size_t m) { \
+    size_t j; \
+    (void) m; \
+    for (j = 0; j < count; j++) { \
+        weights[j] = exp(-_squared_distance_##M(point, points[j], M) / 2); \
+    } \
+}
+
+static void _add_vector(Vector sum, Vector vector, size_t m);
+static void _gaussian_weights(Vector point, Vector *points, size_t count,
+                              Vector weights, size_t m);
+
+_DEFINE_KERNELS(1, 0, 1)
+_DEFINE_KERNELS(2, 0, 2)
+_DEFINE_KERNELS(3, 0, 3)
+_DEFINE_KERNELS(4, 1, 0)
+_DEFINE_KERNELS(5, 1, 1)
+_DEFINE_KERNELS(6, 1, 2)
+_DEFINE_KERNELS(7, 1, 3)
+_DEFINE_KERNELS(8, 2, 0)
+_DEFINE_KERNELS(9, 2, 1)
+_DEFINE_KERNELS(10, 2, 2)
+_DEFINE_KERNELS(11, 2, 3)
+_DEFINE_KERNELS(12, 3, 0)
+_DEFINE_KERNELS(13, 3, 1)
+_DEFINE_KERNELS(14, 3, 2)
+_DEFINE_KERNELS(15, 3, 3)
+_DEFINE_KERNELS(16, 4, 0)
+
+#define _KERNELS(M) {_squared_distance_##M, _add_vector_##M, _gaussian_weights_##M}
+
+/*
+ * The kernels of every order up to MAX_UNROLLED_SIZE, where index 0 holds the
+ * generic kernels used for any other order.
+ */
+static const VectorKernels _kernels_table[MAX_UNROLLED_SIZE + 1] = {
+    {squared_euclidean_distance, _add_vector, _gaussian_weights},
+    _KERNELS(1), _KERNELS(2), _KERNELS(3), _KERNELS(4),
+    _KERNELS(5), _KERNELS(6), _KERNELS(7), _KERNELS(8),
+    _KERNELS(9), _KERNELS(10), _KERNELS(11), _KERNELS(12),
+    _KERNELS(13), _KERNELS(14), _KERNELS(15), _KERNELS(16)
+};
+
 Vector copy_vector(Vector vector, size_t n) {
     size_t i;
     Vector copy = (Vector) calloc(n, sizeof(double));
@@ -24,17 +154,63 @@ void print_vector(Vector vector, size_t m) {
     printf("\n");
 }
 
+#ifdef __SSE2__
 double squared_euclidean_distance(Vector p, Vector q, size_t m) {
-    double distance = 0.0;
+    double partial_sums[2];
+    double distance, diff;
+    size_t i;
+    __m128d acc0 = _mm_setzero_pd(), acc1 = _mm_setzero_pd(), d0, d1;
+
+    for (i = 0; i + 4 <= m; i += 4) {
+        d0 = _mm_sub_pd(_mm_loadu_pd(p + i), _mm_loadu_pd(q + i));
+        d1 = _mm_sub_pd(_mm_loadu_pd(p + i + 2), _mm_loadu_pd(q + i + 2));
+        acc0 = _mm_add_pd(acc0, _mm_mul_pd(d0, d0));
+        acc1 = _mm_add_pd(acc1, _mm_mul_pd(d1, d1));
+    }
+    _mm_storeu_pd(partial_sums, _mm_add_pd(acc0, acc1));
+    distance = partial_sums[0] + partial_sums[1];
+
+    for (; i < m; i++) {
+        diff = p[i] - q[i];
+        distance += diff * diff;
+    }
+    return distance;
+}
+#else
+double squared_euclidean_distance(Vector p, Vector q, size_t m) {
+    double distance = 0.0, diff;
     size_t i;
 
     for (i = 0; i < m; i++) {
-        distance += pow(p[i] - q[i], 2);
+        diff = p[i] - q[i];
+        distance += diff * diff;
     }
     return distance;
 }
+#endif
 
 double euclidean_distance(Vector p, Vector q, size_t m) {
     double squared_distance = squared_euclidean_distance(p, q, m);
     return sqrt(squared_distance);
 }
+
+const VectorKernels *vector_kernels(size_t m) {
+    return &_kernels_table[(m <= MAX_UNROLLED_SIZE) ? m : 0];
+}
+
+static void _add_vector(Vector sum, Vector vector, size_t m) {
+    size_t i;
+
+    for (i = 0; i < m; i++) {
+        sum[i] += vector[i];
+    }
+}
+
+static void _gaussian_weights(Vector point, Vector *points, size_t count,
+                              Vector weights, size_t m) {
+    size_t j;
+
+    for (j = 0; j < count; j++) {
+        weights[j] = exp(-squared_euclidean_distance(point, points[j], m) / 2);
+    }
+}
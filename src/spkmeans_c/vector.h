@@ -20,6 +20,8 @@ void print_vector(Vector vector, size_t m);
 /**
  * Receive two vectors and their order, while assuming the vectors are equal in
  * length, and return the square of the euclidean distance between them.
+ * When compiled for a target with SSE2, the distance is accumulated two
+ * coordinates at a time in SIMD registers.
  */
 double squared_euclidean_distance(Vector p, Vector q, size_t m);
 
@@ -29,4 +31,47 @@ double squared_euclidean_distance(Vector p, Vector q, size_t m);
  */
 double euclidean_distance(Vector p, Vector q, size_t m);
 
+/**
+ * The largest vector size vector_kernels has kernels specialized for.
+ */
+#define MAX_UNROLLED_SIZE 16
+
+/**
+ * Receive two vectors and their order, and return the square of the euclidean
+ * distance between them, like squared_euclidean_distance.
+ */
+typedef double (*SquaredDistanceKernel)(Vector p, Vector q, size_t m);
+
+/**
+ * Receive a sum vector, a vector and their order, and add the vector to the
+ * sum.
+ */
+typedef void (*AddVectorKernel)(Vector sum, Vector vector, size_t m);
+
+/**
+ * Receive a point, an array of count points, an output vector of count weights
+ * and the order of the points, and set weights[j] to the gaussian weight
+ * exp(-||point - points[j]||^2 / 2) of every point.
+ */
+typedef void (*GaussianWeightsKernel)(Vector point, Vector *points,
+                                      size_t count, Vector weights, size_t m);
+
+/**
+ * The kernels of vectors of a single order.
+ */
+typedef struct VectorKernels {
+    SquaredDistanceKernel squared_distance;
+    AddVectorKernel add_vector;
+    GaussianWeightsKernel gaussian_weights;
+} VectorKernels;
+
+/**
+ * Receive the order of vectors, and return the kernels to run on them. Orders
+ * of up to MAX_UNROLLED_SIZE get kernels with the loops over the coordinates
+ * fully unrolled, and other orders get generic loops. The kernels give the
+ * same results as squared_euclidean_distance in either case, so callers are
+ * expected to look them up once, and not per pair of vectors.
+ */
+const VectorKernels *vector_kernels(size_t m);
+
 #endif
@@ -1,5 +1,7 @@
 #include "pyutils.h"
 
+static bool is_double_format(const char *format);
+
 Vector from_python_vector(PyObject *python_vector) {
     Py_ssize_t i;
     Py_ssize_t n = PyList_Size(python_vector);
@@ -26,13 +28,16 @@ PyObject *to_python_vector(Vector vector, Py_ssize_t n) {
 
 Matrix from_python_matrix(PyObject *python_matrix) {
     Py_ssize_t n = PyList_Size(python_matrix);
-    Py_ssize_t i;
+    Py_ssize_t m = PyList_Size(PyList_GetItem(python_matrix, 0));
+    Py_ssize_t i, j;
     PyObject *vector_lst = NULL;
-    Matrix result = (Matrix) malloc(sizeof(Vector) * n);
+    Matrix result = build_matrix(n, m);
 
     for (i = 0; i < n; i++) {
         vector_lst = PyList_GetItem(python_matrix, i);
-        result[i] = from_python_vector(vector_lst);
+        for (j = 0; j < m; j++) {
+            result[i][j] = PyFloat_AsDouble(PyList_GetItem(vector_lst, j));
+        }
     }
 
     return result;
@@ -50,3 +55,277 @@ PyObject *to_python_matrix(Matrix matrix, Py_ssize_t n, Py_ssize_t m) {
 
     return result;
 }
+
+bool acquire_python_matrix(PyObject *object, PyMatrix *matrix) {
+    Py_ssize_t i, m;
+    PyObject *row = NULL;
+
+    matrix -> has_view = false;
+    if (PyObject_CheckBuffer(object)) {
+        if (PyObject_GetBuffer(object, &matrix -> view, PyBUF_C_CONTIGUOUS | PyBUF_FORMAT) < 0) {
+            return false;
+        }
+        if (matrix -> view.ndim != 2 || !is_double_format(matrix -> view.format) ||
+            matrix -> view.shape[0] == 0 || matrix -> view.shape[1] == 0) {
+            PyBuffer_Release(&matrix -> view);
+            PyErr_SetString(PyExc_ValueError, "Expected a non-empty 2-dimensional buffer of float64 items");
+            return false;
+        }
+
+        matrix -> has_view = true;
+        matrix -> n = matrix -> view.shape[0];
+        matrix -> m = matrix -> view.shape[1];
+        matrix -> rows = (Matrix) malloc(matrix -> n * sizeof(Vector));
+        for (i = 0; i < matrix -> n; i++) {
+            matrix -> rows[i] = (Vector) matrix -> view.buf + i * matrix -> m;
+        }
+        return true;
+    }
+
+    if (!PyList_Check(object) || PyList_Size(object) == 0) {
+        PyErr_SetString(PyExc_TypeError, "Expected a float64 buffer or a non-empty list of lists of floats");
+        return false;
+    }
+    row = PyList_GetItem(object, 0);
+    m = PyList_Check(row) ? PyList_Size(row) : 0;
+    for (i = 0; i < PyList_Size(object); i++) {
+        row = PyList_GetItem(object, i);
+        if (m == 0 || !PyList_Check(row) || PyList_Size(row) != m) {
+            PyErr_SetString(PyExc_TypeError, "Expected a list of equally long, non-empty lists of floats");
+            return false;
+        }
+    }
+
+    matrix -> n = PyList_Size(object);
+    matrix -> m = m;
+    matrix -> rows = from_python_matrix(object);
+    if (PyErr_Occurred()) {
+        free_matrix(matrix -> rows, matrix -> n);
+        return false;
+    }
+    return true;
+}
+
+static bool is_double_format(const char *format) {
+    if (format[0] == '@' || format[0] == '=' || (PY_LITTLE_ENDIAN && format[0] == '<') ||
+        (!PY_LITTLE_ENDIAN && (format[0] == '>' || format[0] == '!'))) {
+        format++;
+    }
+    return strcmp(format, "d") == 0;
+}
+
+bool acquire_python_matrix_batch(PyObject *object, PyMatrixBatch *batch) {
+    Py_ssize_t i, j;
+    PyMatrix matrix;
+
+    batch -> has_view = false;
+    if (PyObject_CheckBuffer(object)) {
+        if (PyObject_GetBuffer(object, &batch -> view, PyBUF_C_CONTIGUOUS | PyBUF_FORMAT) < 0) {
+            return false;
+        }
+        if (batch -> view.ndim != 3 || !is_double_format(batch -> view.format) || batch -> view.shape[0] == 0 ||
+            batch -> view.shape[1] == 0 || batch -> view.shape[2] == 0) {
+            PyBuffer_Release(&batch -> view);
+            PyErr_SetString(PyExc_ValueError, "Expected a non-empty 3-dimensional buffer of float64 items");
+            return false;
+        }
+
+        batch -> has_view = true;
+        batch -> batch_size = batch -> view.shape[0];
+        batch -> n = batch -> view.shape[1];
+        batch -> m = batch -> view.shape[2];
+        batch -> values = (double *) batch -> view.buf;
+        return true;
+    }
+
+    if (!PyList_Check(object) || PyList_Size(object) == 0) {
+        PyErr_SetString(PyExc_TypeError, "Expected a float64 buffer or a non-empty list of matrices");
+        return false;
+    }
+
+    batch -> batch_size = PyList_Size(object);
+    batch -> values = NULL;
+    for (i = 0; i < batch -> batch_size; i++) {
+        if (!acquire_python_matrix(PyList_GetItem(object, i), &matrix)) {
+            free(batch -> values);
+            return false;
+        }
+        if (i == 0) {
+            batch -> n = matrix.n;
+            batch -> m = matrix.m;
+            batch -> values = (double *) malloc(batch -> batch_size * batch -> n * batch -> m * sizeof(double));
+        } else if (matrix.n != batch -> n || matrix.m != batch -> m) {
+            release_python_matrix(&matrix);
+            free(batch -> values);
+            PyErr_SetString(PyExc_ValueError, "Expected equally shaped matrices");
+            return false;
+        }
+        for (j = 0; j < batch -> n; j++) {
+            memcpy(batch -> values + (i * batch -> n + j) * batch -> m, matrix.rows[j], batch -> m * sizeof(double));
+        }
+        release_python_matrix(&matrix);
+    }
+    return true;
+}
+
+void release_python_matrix_batch(PyMatrixBatch *batch) {
+    if (batch -> has_view) {
+        PyBuffer_Release(&batch -> view);
+    } else {
+        free(batch -> values);
+    }
+}
+
+void release_python_matrix(PyMatrix *matrix) {
+    if (matrix -> has_view) {
+        free(matrix -> rows);
+        PyBuffer_Release(&matrix -> view);
+    } else {
+        free_matrix(matrix -> rows, matrix -> n);
+    }
+}
+
+typedef struct BufferObject {
+    PyObject_HEAD
+    void *memory;
+    PyObject *owner;
+    void *data;
+    const char *format;
+    Py_ssize_t itemsize;
+    Py_ssize_t ndim;
+    Py_ssize_t shape[MAX_BUFFER_DIMENSIONS];
+    Py_ssize_t strides[MAX_BUFFER_DIMENSIONS];
+} BufferObject;
+
+static PyObject *new_buffer(void *memory, PyObject *owner, void *data, const char *format, Py_ssize_t itemsize,
+                            Py_ssize_t ndim, const Py_ssize_t *shape, const Py_ssize_t *strides);
+
+static int buffer_get_buffer(PyObject *self, Py_buffer *view, int flags) {
+    BufferObject *buffer = (BufferObject *) self;
+    Py_ssize_t i, len = buffer -> itemsize, contiguous_stride = buffer -> itemsize;
+    bool c_contiguous = true, f_contiguous = true;
+
+    for (i = buffer -> ndim - 1; i >= 0; i--) {
+        len *= buffer -> shape[i];
+        c_contiguous &= buffer -> shape[i] <= 1 || buffer -> strides[i] == contiguous_stride;
+        contiguous_stride *= buffer -> shape[i];
+    }
+    contiguous_stride = buffer -> itemsize;
+    for (i = 0; i < buffer -> ndim; i++) {
+        f_contiguous &= buffer -> shape[i] <= 1 || buffer -> strides[i] == contiguous_stride;
+        contiguous_stride *= buffer -> shape[i];
+    }
+
+    /* The contiguity requests carry PyBUF_STRIDES, so they're checked on their own */
+    if (((flags & PyBUF_STRIDES) != PyBUF_STRIDES && !c_contiguous) ||
+        ((flags & PyBUF_C_CONTIGUOUS) == PyBUF_C_CONTIGUOUS && !c_contiguous)) {
+        PyErr_SetString(PyExc_BufferError, "The buffer isn't C-contiguous");
+        return -1;
+    }
+    if ((flags & PyBUF_F_CONTIGUOUS) == PyBUF_F_CONTIGUOUS && !f_contiguous) {
+        PyErr_SetString(PyExc_BufferError, "The buffer isn't Fortran-contiguous");
+        return -1;
+    }
+    if ((flags & PyBUF_ANY_CONTIGUOUS) == PyBUF_ANY_CONTIGUOUS && !c_contiguous && !f_contiguous) {
+        PyErr_SetString(PyExc_BufferError, "The buffer isn't contiguous");
+        return -1;
+    }
+    if ((flags & PyBUF_WRITABLE) && buffer -> owner != NULL) {
+        PyErr_SetString(PyExc_BufferError, "The buffer is read-only");
+        return -1;
+    }
+
+    view -> obj = self;
+    Py_INCREF(self);
+    view -> buf = buffer -> data;
+    view -> len = len;
+    view -> readonly = buffer -> owner != NULL;
+    view -> itemsize = buffer -> itemsize;
+    view -> format = (flags & PyBUF_FORMAT) ? (char *) buffer -> format : NULL;
+    view -> ndim = (int) buffer -> ndim;
+    view -> shape = (flags & PyBUF_ND) ? buffer -> shape : NULL;
+    view -> strides = ((flags & PyBUF_STRIDES) == PyBUF_STRIDES) ? buffer -> strides : NULL;
+    view -> suboffsets = NULL;
+    view -> internal = NULL;
+    return 0;
+}
+
+static void buffer_dealloc(PyObject *self) {
+    free(((BufferObject *) self) -> memory);
+    Py_XDECREF(((BufferObject *) self) -> owner);
+    Py_TYPE(self) -> tp_free(self);
+}
+
+static Py_ssize_t buffer_length(PyObject *self) {
+    return ((BufferObject *) self) -> shape[0];
+}
+
+static PyBufferProcs buffer_procs = {
+    .bf_getbuffer = buffer_get_buffer,
+    .bf_releasebuffer = NULL
+};
+
+static PySequenceMethods buffer_sequence_methods = {
+    .sq_length = buffer_length
+};
+
+PyTypeObject BufferType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "mykmeanssp.Buffer",
+    .tp_doc = PyDoc_STR("Memory computed by mykmeanssp, exposed through the buffer protocol."),
+    .tp_basicsize = sizeof(BufferObject),
+    .tp_itemsize = 0,
+    .tp_flags = Py_TPFLAGS_DEFAULT,
+    .tp_dealloc = buffer_dealloc,
+    .tp_as_buffer = &buffer_procs,
+    .tp_as_sequence = &buffer_sequence_methods
+};
+
+PyObject *to_python_buffer(void *data, const char *format, Py_ssize_t itemsize,
+                           Py_ssize_t ndim, const Py_ssize_t *shape,
+                           const Py_ssize_t *strides) {
+    return new_buffer(data, NULL, data, format, itemsize, ndim, shape, strides);
+}
+
+PyObject *to_python_view(void *data, const char *format, Py_ssize_t itemsize,
+                         Py_ssize_t ndim, const Py_ssize_t *shape,
+                         const Py_ssize_t *strides, PyObject *owner) {
+    Py_INCREF(owner);
+    return new_buffer(NULL, owner, data, format, itemsize, ndim, shape, strides);
+}
+
+PyObject *to_python_matrix_buffer(Matrix matrix, Py_ssize_t n, Py_ssize_t m, bool transposed) {
+    Py_ssize_t shape[2], strides[2];
+
+    shape[0] = transposed ? m : n;
+    shape[1] = transposed ? n : m;
+    strides[0] = transposed ? (Py_ssize_t) sizeof(double) : m * (Py_ssize_t) sizeof(double);
+    strides[1] = transposed ? m * (Py_ssize_t) sizeof(double) : (Py_ssize_t) sizeof(double);
+    return new_buffer(matrix, NULL, matrix_values(matrix, n), "d", sizeof(double), 2, shape, strides);
+}
+
+static PyObject *new_buffer(void *memory, PyObject *owner, void *data, const char *format, Py_ssize_t itemsize,
+                            Py_ssize_t ndim, const Py_ssize_t *shape, const Py_ssize_t *strides) {
+    Py_ssize_t i, stride = itemsize;
+    BufferObject *buffer = PyObject_New(BufferObject, &BufferType);
+
+    if (buffer == NULL) {
+        free(memory);
+        Py_XDECREF(owner);
+        return NULL;
+    }
+
+    buffer -> memory = memory;
+    buffer -> owner = owner;
+    buffer -> data = data;
+    buffer -> format = format;
+    buffer -> itemsize = itemsize;
+    buffer -> ndim = ndim;
+    for (i = ndim - 1; i >= 0; i--) {
+        buffer -> shape[i] = shape[i];
+        buffer -> strides[i] = (strides != NULL) ? strides[i] : stride;
+        stride *= shape[i];
+    }
+
+    return (PyObject *) buffer;
+}
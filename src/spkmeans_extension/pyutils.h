@@ -4,6 +4,7 @@
 #include "matrix.h"
 #include "vector.h"
 #include <Python.h>
+#include <stdbool.h>
 
 Vector from_python_vector(PyObject *python_vector);
 PyObject *to_python_vector(Vector vector, Py_ssize_t n);
@@ -11,4 +12,104 @@ PyObject *to_python_vector(Vector vector, Py_ssize_t n);
 Matrix from_python_matrix(PyObject *python_matrix);
 PyObject *to_python_matrix(Matrix matrix, Py_ssize_t n, Py_ssize_t m);
 
+/**
+ * A matrix read from a Python object. When the object exports a buffer, rows
+ * point into the pinned buffer of view, and otherwise they are copied from a
+ * list of lists.
+ */
+typedef struct PyMatrix {
+    Matrix rows;
+    Py_ssize_t n;
+    Py_ssize_t m;
+    Py_buffer view;
+    bool has_view;
+} PyMatrix;
+
+/**
+ * Receive a Python object and a PyMatrix, and set the PyMatrix to the rows of
+ * the object. Objects exporting a buffer (numpy arrays, memoryviews) must be
+ * two dimensional, C-contiguous and of float64 items, and are read without
+ * copying. Other objects must be non-empty lists of equally long, non-empty
+ * lists of floats, which are copied. Return false with a Python exception set
+ * if the object is neither, and true otherwise, after which the PyMatrix must
+ * be released with release_python_matrix.
+ */
+bool acquire_python_matrix(PyObject *object, PyMatrix *matrix);
+
+/**
+ * Receive a PyMatrix set by acquire_python_matrix, and release its rows and
+ * the buffer it pins.
+ */
+void release_python_matrix(PyMatrix *matrix);
+
+/**
+ * A batch of equally shaped matrices read from a Python object, stored one
+ * after the other in row major order. When the object exports a buffer, values
+ * point into the pinned buffer of view, and otherwise they are copied from a
+ * list of matrices.
+ */
+typedef struct PyMatrixBatch {
+    double *values;
+    Py_ssize_t batch_size;
+    Py_ssize_t n;
+    Py_ssize_t m;
+    Py_buffer view;
+    bool has_view;
+} PyMatrixBatch;
+
+/**
+ * Receive a Python object and a PyMatrixBatch, and set the PyMatrixBatch to
+ * the matrices of the object. Objects exporting a buffer must be three
+ * dimensional, C-contiguous and of float64 items, and are read without
+ * copying. Other objects must be non-empty lists of equally shaped matrices,
+ * each accepted by acquire_python_matrix, which are copied. Return false with
+ * a Python exception set if the object is neither, and true otherwise, after
+ * which the PyMatrixBatch must be released with release_python_matrix_batch.
+ */
+bool acquire_python_matrix_batch(PyObject *object, PyMatrixBatch *batch);
+
+/**
+ * Receive a PyMatrixBatch set by acquire_python_matrix_batch, and release its
+ * values or the buffer it pins.
+ */
+void release_python_matrix_batch(PyMatrixBatch *batch);
+
+#define MAX_BUFFER_DIMENSIONS 3
+
+/**
+ * A Python object exposing malloc'd memory it owns, or read-only memory of
+ * another Python object it keeps alive, through the buffer protocol, so
+ * np.asarray or memoryview wrap it without copying.
+ */
+extern PyTypeObject BufferType;
+
+/**
+ * Receive malloc'd data, its struct module format, the size of every item, the
+ * number of dimensions (up to MAX_BUFFER_DIMENSIONS), the shape and the strides
+ * in bytes (or NULL for C order), and return a Buffer object that owns the data
+ * and frees it once the object and every view of it are released. On failure,
+ * the data is freed and NULL is returned.
+ */
+PyObject *to_python_buffer(void *data, const char *format, Py_ssize_t itemsize,
+                           Py_ssize_t ndim, const Py_ssize_t *shape,
+                           const Py_ssize_t *strides);
+
+/**
+ * Receive data owned by a Python object, its struct module format, the size of
+ * every item, the number of dimensions, the shape and the strides in bytes (or
+ * NULL for C order), and return a read-only Buffer object viewing the data,
+ * which keeps the owner alive instead of freeing the data.
+ */
+PyObject *to_python_view(void *data, const char *format, Py_ssize_t itemsize,
+                         Py_ssize_t ndim, const Py_ssize_t *shape,
+                         const Py_ssize_t *strides, PyObject *owner);
+
+/**
+ * Receive a matrix built by build_matrix (with its rows in order) and its
+ * order, and return a float64 Buffer object that owns the matrix. If
+ * transposed is true, the buffer exposes the m x n transpose of the matrix
+ * through its strides, without copying.
+ */
+PyObject *to_python_matrix_buffer(Matrix matrix, Py_ssize_t n, Py_ssize_t m, bool transposed);
+
 #endif
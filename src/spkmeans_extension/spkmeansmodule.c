@@ -1,211 +1,1371 @@
 #define PY_SSIZE_T_CLEAN
 
 #include <Python.h>
+#include <pythread.h>
 #include "pyutils.h"
 #include "spectral.h"
 #include "jacobi.h"
 #include "kmeans.h"
+#include "parallel.h"
+
+static const char *kmeans_algorithm_names[] = {"lloyd", "elkan", "hamerly", "yinyang", "auto", NULL};
+static const char *affinity_graph_names[] = {"dense", "knn", "hnsw", "radius", NULL};
+static const char *eigensolver_names[] = {"auto", "jacobi", "lanczos", NULL};
+static const char *spectral_engine_names[] = {"graph", "nystrom", "lsc", "rff", NULL};
+static const char *landmark_sampling_names[] = {"uniform", "kmeans++", NULL};
+
+static PyStructSequence_Field kmeans_result_fields[] = {
+    {"centroids", "The list of final centroids."},
+    {"labels", "A buffer of the cluster index of every vector, as of the last assignment step."},
+    {"cluster_sizes", "The list of the number of vectors in every cluster."},
+    {"inertia", "The sum of squared distances of the vectors from the centroids of their clusters."},
+    {"iterations", "The number of iterations run."},
+    {"converged", "Whether the iterations stopped because all centroids moved less than epsilon."},
+    {NULL, NULL}
+};
+
+static PyStructSequence_Desc kmeans_result_desc = {
+    .name = "mykmeanssp.KmeansResult",
+    .doc = "The outcome of fit.",
+    .fields = kmeans_result_fields,
+    .n_in_sequence = 6
+};
+
+static PyTypeObject KmeansResultType;
+
+static PyStructSequence_Field spkmeans_result_fields[] = {
+    {"labels", "A buffer of the cluster index of every data point."},
+    {"centroids", "A k x k buffer of the final centroids, in the spectral embedding space."},
+    {"k", "The number of clusters, as given or as chosen by the eigengap heuristic."},
+    {"centroids_idxs", "The list of the indices of the data points K-means++ chose as initial centroids."},
+    {"inertia", "The sum of squared distances of the embedded points from the centroids of their clusters."},
+    {"iterations", "The number of iterations run."},
+    {"converged", "Whether the iterations stopped because all centroids moved less than epsilon."},
+    {NULL, NULL}
+};
+
+static PyStructSequence_Desc spkmeans_result_desc = {
+    .name = "mykmeanssp.SpkmeansResult",
+    .doc = "The outcome of spkmeans.",
+    .fields = spkmeans_result_fields,
+    .n_in_sequence = 7
+};
+
+static PyTypeObject SpkmeansResultType;
+
+typedef enum BatchGoal {
+    BATCH_SPK,
+    BATCH_JACOBI
+} BatchGoal;
+
+typedef struct BatchJob {
+    PyMatrix matrix;
+    bool acquired;
+    SpectralResult *spectral_result;
+    JacobiResult *jacobi_result;
+} BatchJob;
+
+typedef struct BatchContext {
+    BatchGoal goal;
+    Py_ssize_t k;
+    BatchJob *jobs;
+} BatchContext;
+
+static bool kmeans_algorithm_from_name(const char *name, KmeansAlgorithm *algorithm) {
+    size_t i;
+
+    for (i = 0; kmeans_algorithm_names[i] != NULL; i++) {
+        if (strcmp(kmeans_algorithm_names[i], name) == 0) {
+            *algorithm = (KmeansAlgorithm) i;
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool spectral_options_from_args(const char *graph_name, Py_ssize_t neighbors, double radius,
+                                       const char *eigensolver_name, Py_ssize_t threads,
+                                       SpectralOptions *options) {
+    size_t i;
+    bool known_eigensolver = false;
+
+    init_spectral_options(options);
+    if (neighbors <= 0) {
+        PyErr_SetString(PyExc_ValueError, "neighbors must be positive");
+        return false;
+    }
+    if (!(radius > 0)) {
+        PyErr_SetString(PyExc_ValueError, "radius must be positive");
+        return false;
+    }
+    if (threads < 0) {
+        PyErr_SetString(PyExc_ValueError, "threads can't be negative");
+        return false;
+    }
+    options -> neighbors_count = neighbors;
+    options -> radius = radius;
+    options -> threads_count = threads;
+    for (i = 0; eigensolver_names[i] != NULL; i++) {
+        if (strcmp(eigensolver_names[i], eigensolver_name) == 0) {
+            options -> eigensolver = (SpectralEigensolver) i;
+            known_eigensolver = true;
+        }
+    }
+    if (!known_eigensolver) {
+        PyErr_Format(PyExc_ValueError, "Unknown eigensolver '%s'", eigensolver_name);
+        return false;
+    }
+    for (i = 0; affinity_graph_names[i] != NULL; i++) {
+        if (strcmp(affinity_graph_names[i], graph_name) == 0) {
+            options -> graph = (AffinityGraph) i;
+            if (options -> graph == DENSE_GRAPH && options -> eigensolver == LANCZOS_EIGENSOLVER) {
+                PyErr_SetString(PyExc_ValueError, "The lanczos eigensolver needs a sparse graph");
+                return false;
+            }
+            return true;
+        }
+    }
+    PyErr_Format(PyExc_ValueError, "Unknown affinity graph '%s'", graph_name);
+    return false;
+}
+
+static bool engine_options_from_args(const char *engine_name, Py_ssize_t landmarks, const char *sampling_name,
+                                     Py_ssize_t nearest_landmarks, Py_ssize_t features, unsigned long seed,
+                                     SpectralOptions *options) {
+    size_t i;
+    bool known_sampling = false;
+
+    if (landmarks <= 0) {
+        PyErr_SetString(PyExc_ValueError, "landmarks must be positive");
+        return false;
+    }
+    if (nearest_landmarks <= 0) {
+        PyErr_SetString(PyExc_ValueError, "nearest_landmarks must be positive");
+        return false;
+    }
+    if (features <= 0) {
+        PyErr_SetString(PyExc_ValueError, "features must be positive");
+        return false;
+    }
+    options -> nystrom.landmarks_count = landmarks;
+    options -> nystrom.seed = (uint32_t) seed;
+    options -> lsc.landmarks_count = landmarks;
+    options -> lsc.nearest_landmarks = nearest_landmarks;
+    options -> lsc.seed = (uint32_t) seed;
+    options -> rff.features_count = features;
+    options -> rff.seed = (uint32_t) seed;
+    for (i = 0; landmark_sampling_names[i] != NULL; i++) {
+        if (strcmp(landmark_sampling_names[i], sampling_name) == 0) {
+            options -> nystrom.sampling = (LandmarkSampling) i;
+            known_sampling = true;
+        }
+    }
+    if (!known_sampling) {
+        PyErr_Format(PyExc_ValueError, "Unknown landmark sampling '%s'", sampling_name);
+        return false;
+    }
+    for (i = 0; spectral_engine_names[i] != NULL; i++) {
+        if (strcmp(spectral_engine_names[i], engine_name) == 0) {
+            options -> engine = (SpectralEngine) i;
+            return true;
+        }
+    }
+    PyErr_Format(PyExc_ValueError, "Unknown spectral engine '%s'", engine_name);
+    return false;
+}
+
+static bool optional_k_from_object(PyObject *optional_k, Py_ssize_t *k) {
+    if (optional_k == Py_None) {
+        *k = 0;
+    } else if (PyLong_Check(optional_k)) {
+        *k = PyLong_AsSsize_t(optional_k);
+        if (*k == -1 && PyErr_Occurred()) {
+            return false;
+        }
+    } else {
+        PyErr_SetString(PyExc_TypeError, "K must be an int or None");
+        return false;
+    }
+    if (*k < 0) {
+        PyErr_SetString(PyExc_ValueError, "k can't be negative");
+        return false;
+    }
+    return true;
+}
 
 static PyObject* wam_wrapper(PyObject *self, PyObject *args) {
-    Py_ssize_t m, n;
     PyObject *data_points = NULL;
     PyObject *res = NULL;
-    Matrix data_points_mat = NULL;
+    PyMatrix data_points_mat;
     Matrix wam = NULL;
 
-    if (!PyArg_ParseTuple(args, "O", &data_points)) {
+    if (!PyArg_ParseTuple(args, "O", &data_points) || !acquire_python_matrix(data_points, &data_points_mat)) {
+        return NULL;
+    }
+
+    Py_BEGIN_ALLOW_THREADS
+    wam = weighted_adjacency_matrix(data_points_mat.rows, data_points_mat.n, data_points_mat.m);
+    Py_END_ALLOW_THREADS
+    res = to_python_matrix_buffer(wam, data_points_mat.n, data_points_mat.n, false);
+
+    release_python_matrix(&data_points_mat);
+
+    return res;
+}
+
+static PyObject* ddg_wrapper(PyObject *self, PyObject *args) {
+    Py_ssize_t n;
+    PyObject *data_points = NULL;
+    PyObject *res = NULL;
+    PyMatrix data_points_mat;
+    Matrix wam = NULL;
+    Matrix ddg = NULL;
+
+    if (!PyArg_ParseTuple(args, "O", &data_points) || !acquire_python_matrix(data_points, &data_points_mat)) {
+        return NULL;
+    }
+
+    n = data_points_mat.n;
+    Py_BEGIN_ALLOW_THREADS
+    wam = weighted_adjacency_matrix(data_points_mat.rows, n, data_points_mat.m);
+    ddg = diagonal_degree_matrix(wam, n);
+    free_matrix(wam, n);
+    Py_END_ALLOW_THREADS
+
+    res = to_python_matrix_buffer(ddg, n, n, false);
+
+    release_python_matrix(&data_points_mat);
+
+    return res;
+}
+
+static PyObject* gl_wrapper(PyObject *self, PyObject *args) {
+    Py_ssize_t n;
+    PyObject *data_points = NULL;
+    PyObject *res = NULL;
+    PyMatrix data_points_mat;
+    Matrix wam = NULL;
+    Matrix ddg = NULL;
+    Matrix gl = NULL;
+
+    if (!PyArg_ParseTuple(args, "O", &data_points) || !acquire_python_matrix(data_points, &data_points_mat)) {
+        return NULL;
+    }
+
+    n = data_points_mat.n;
+    Py_BEGIN_ALLOW_THREADS
+    wam = weighted_adjacency_matrix(data_points_mat.rows, n, data_points_mat.m);
+    ddg = diagonal_degree_matrix(wam, n);
+    gl = graph_laplacian(ddg, wam, n);
+    free_matrix(wam, n);
+    free_matrix(ddg, n);
+    Py_END_ALLOW_THREADS
+
+    res = to_python_matrix_buffer(gl, n, n, false);
+
+    release_python_matrix(&data_points_mat);
+
+    return res;
+}
+
+static PyObject *jacobi_result_to_python(JacobiResult *jacobi_result, Py_ssize_t n, bool columns) {
+    PyObject *res = PyTuple_New(2);
+
+    /* The buffers take ownership of the eigenvectors and eigenvalues */
+    PyTuple_SetItem(res, 0, to_python_matrix_buffer(jacobi_result -> eigenvectors, n, n, columns));
+    PyTuple_SetItem(res, 1, to_python_buffer(jacobi_result -> eigenvalues, "d", sizeof(double), 1, &n, NULL));
+    free(jacobi_result);
+    return res;
+}
+
+static PyObject *spectral_result_to_python(SpectralResult *spr, Py_ssize_t n) {
+    PyObject *res = PyTuple_New(2);
+
+    /* The buffer takes ownership of the new points */
+    PyTuple_SetItem(res, 0, to_python_matrix_buffer(spr -> new_points, spr -> k, n, false));
+    PyTuple_SetItem(res, 1, PyLong_FromSize_t(spr -> k));
+    free(spr);
+    return res;
+}
+
+static PyObject *csr_matrix_to_python(CsrMatrix *mat) {
+    Py_ssize_t rows_count = mat -> n + 1, nonzeros_count = csr_nonzeros_count(mat);
+    PyObject *res = PyTuple_New(3);
+
+    /* The buffers take ownership of the arrays, so only the struct is freed */
+    PyTuple_SetItem(res, 0, to_python_buffer(mat -> row_starts, "N", sizeof(size_t), 1, &rows_count, NULL));
+    PyTuple_SetItem(res, 1, to_python_buffer(mat -> columns, "N", sizeof(size_t), 1, &nonzeros_count, NULL));
+    PyTuple_SetItem(res, 2, to_python_buffer(mat -> values, "d", sizeof(double), 1, &nonzeros_count, NULL));
+    free(mat);
+    return res;
+}
+
+static PyObject* jacobi_wrapper(PyObject *self, PyObject *args, PyObject *kwargs) {
+    Py_ssize_t n;
+    PyObject *data_points = NULL;
+    PyMatrix data_points_mat;
+    JacobiResult *jacobi_result = NULL;
+    int columns = 0;
+
+    PyObject *res = NULL;
+
+    static char* kwlist[] = {"matrix", "columns", NULL};
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|p", kwlist, &data_points, &columns) ||
+        !acquire_python_matrix(data_points, &data_points_mat)) {
+        return NULL;
+    }
+
+    n = data_points_mat.n;
+    if (data_points_mat.m != n) {
+        release_python_matrix(&data_points_mat);
+        PyErr_SetString(PyExc_ValueError, "The matrix must be square");
+        return NULL;
+    }
+    Py_BEGIN_ALLOW_THREADS
+    jacobi_result = jacobi(data_points_mat.rows, n);
+    Py_END_ALLOW_THREADS
+
+    res = jacobi_result_to_python(jacobi_result, n, columns);
+    release_python_matrix(&data_points_mat);
+    return res;
+}
+
+static PyObject* jacobi_batched_wrapper(PyObject *self, PyObject *args, PyObject *kwargs) {
+    PyObject *matrices = NULL, *res = NULL;
+    PyMatrixBatch batch;
+    JacobiBatchResult *jacobi_result = NULL;
+    Py_ssize_t n, shape[3], strides[3];
+    int columns = 0;
+    Py_ssize_t threads = 0;
+
+    static char* kwlist[] = {"matrices", "columns", "threads", NULL};
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|pn", kwlist, &matrices, &columns, &threads)) {
+        return NULL;
+    }
+    if (threads < 0) {
+        PyErr_SetString(PyExc_ValueError, "threads can't be negative");
+        return NULL;
+    }
+    if (!acquire_python_matrix_batch(matrices, &batch)) {
+        return NULL;
+    }
+    n = batch.n;
+    if (batch.m != n) {
+        release_python_matrix_batch(&batch);
+        PyErr_SetString(PyExc_ValueError, "The matrices must be square");
+        return NULL;
+    }
+
+    Py_BEGIN_ALLOW_THREADS
+    jacobi_result = jacobi_batched(batch.values, batch.batch_size, n, threads);
+    Py_END_ALLOW_THREADS
+    release_python_matrix_batch(&batch);
+
+    shape[0] = batch.batch_size;
+    shape[1] = n;
+    shape[2] = n;
+    strides[0] = n * n * (Py_ssize_t) sizeof(double);
+    strides[1] = (columns ? 1 : n) * (Py_ssize_t) sizeof(double);
+    strides[2] = (columns ? n : 1) * (Py_ssize_t) sizeof(double);
+
+    /* The buffers take ownership of the result arrays, so only the struct is freed */
+    res = PyTuple_New(4);
+    PyTuple_SetItem(res, 0, to_python_buffer(jacobi_result -> eigenvectors, "d", sizeof(double), 3, shape, strides));
+    PyTuple_SetItem(res, 1, to_python_buffer(jacobi_result -> eigenvalues, "d", sizeof(double), 2, shape, NULL));
+    PyTuple_SetItem(res, 2, to_python_buffer(jacobi_result -> converged, "?", sizeof(bool), 1, shape, NULL));
+    PyTuple_SetItem(res, 3, to_python_buffer(jacobi_result -> sweeps, "N", sizeof(size_t), 1, shape, NULL));
+    free(jacobi_result);
+    return res;
+}
+
+static PyObject* spk_wrapper(PyObject *self, PyObject *args, PyObject *kwargs) {
+    PyObject *data_points_py = NULL;
+    PyObject *optional_k = Py_None;
+    PyObject *res = NULL;
+
+    Py_ssize_t k;
+    PyMatrix data_points_mat;
+    SpectralResult *spr = NULL;
+    SpectralOptions options;
+    const char *graph_name = affinity_graph_names[DENSE_GRAPH];
+    Py_ssize_t neighbors = DEFAULT_NEIGHBORS_COUNT;
+    double radius = DEFAULT_RADIUS;
+    const char *eigensolver_name = eigensolver_names[AUTO_EIGENSOLVER];
+    const char *engine_name = spectral_engine_names[GRAPH_ENGINE];
+    Py_ssize_t landmarks = NYSTROM_DEFAULT_LANDMARKS_COUNT;
+    const char *sampling_name = landmark_sampling_names[UNIFORM_LANDMARKS];
+    Py_ssize_t nearest_landmarks = LSC_DEFAULT_NEAREST_LANDMARKS;
+    Py_ssize_t features = RFF_DEFAULT_FEATURES_COUNT;
+
+    static char* kwlist[] = {"data_points", "k", "graph", "neighbors", "radius", "eigensolver", "engine", "landmarks",
+                             "sampling", "nearest_landmarks", "features", NULL};
+    if (!PyArg_ParseTupleAndKeywords(
+            args,
+            kwargs,
+            "O|Osndssnsnn",
+            kwlist,
+            &data_points_py, &optional_k, &graph_name, &neighbors, &radius, &eigensolver_name, &engine_name,
+            &landmarks, &sampling_name, &nearest_landmarks, &features)) {
+        return NULL;
+    }
+
+    if (!spectral_options_from_args(graph_name, neighbors, radius, eigensolver_name, 0, &options) ||
+        !engine_options_from_args(engine_name, landmarks, sampling_name, nearest_landmarks, features, 0, &options) ||
+        !optional_k_from_object(optional_k, &k) || !acquire_python_matrix(data_points_py, &data_points_mat)) {
+        return NULL;
+    }
+    if (k > data_points_mat.n) {
+        release_python_matrix(&data_points_mat);
+        PyErr_SetString(PyExc_ValueError, "k can't be larger than n");
+        return NULL;
+    }
+
+    Py_BEGIN_ALLOW_THREADS
+    spr = spectral_clustering_with_options(data_points_mat.rows, k, data_points_mat.n, data_points_mat.m, &options);
+    Py_END_ALLOW_THREADS
+    res = spectral_result_to_python(spr, data_points_mat.n);
+    release_python_matrix(&data_points_mat);
+    return res;
+}
+
+static PyObject* knn_wam_wrapper(PyObject *self, PyObject *args, PyObject *kwargs) {
+    PyObject *data_points = NULL;
+    PyMatrix data_points_mat;
+    CsrMatrix *wam = NULL;
+    Py_ssize_t neighbors = DEFAULT_NEIGHBORS_COUNT, threads = 0;
+
+    static char* kwlist[] = {"data_points", "neighbors", "threads", NULL};
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|nn", kwlist, &data_points, &neighbors, &threads)) {
+        return NULL;
+    }
+    if (neighbors <= 0) {
+        PyErr_SetString(PyExc_ValueError, "neighbors must be positive");
+        return NULL;
+    }
+    if (threads < 0) {
+        PyErr_SetString(PyExc_ValueError, "threads can't be negative");
+        return NULL;
+    }
+    if (!acquire_python_matrix(data_points, &data_points_mat)) {
+        return NULL;
+    }
+
+    Py_BEGIN_ALLOW_THREADS
+    wam = knn_weighted_adjacency_matrix(data_points_mat.rows, data_points_mat.n, data_points_mat.m, neighbors,
+                                        threads);
+    Py_END_ALLOW_THREADS
+    release_python_matrix(&data_points_mat);
+
+    return csr_matrix_to_python(wam);
+}
+
+static PyObject* hnsw_wam_wrapper(PyObject *self, PyObject *args, PyObject *kwargs) {
+    PyObject *data_points = NULL;
+    PyObject *csr = NULL, *res = NULL;
+    PyMatrix data_points_mat;
+    CsrMatrix *wam = NULL;
+    HnswOptions options;
+    Py_ssize_t i;
+    Py_ssize_t neighbors = DEFAULT_NEIGHBORS_COUNT, max_neighbors = HNSW_DEFAULT_MAX_NEIGHBORS;
+    Py_ssize_t ef_construction = HNSW_DEFAULT_EF_CONSTRUCTION, ef_search = HNSW_DEFAULT_EF_SEARCH;
+    Py_ssize_t threads = 0, recall_sample = 0;
+    unsigned long seed = 0;
+    double recall = 0.0;
+
+    static char* kwlist[] = {"data_points", "neighbors", "M", "ef_construction", "ef_search", "seed", "threads",
+                             "recall_sample", NULL};
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|nnnnknn", kwlist, &data_points, &neighbors, &max_neighbors,
+                                     &ef_construction, &ef_search, &seed, &threads, &recall_sample)) {
+        return NULL;
+    }
+    if (neighbors <= 0) {
+        PyErr_SetString(PyExc_ValueError, "neighbors must be positive");
+        return NULL;
+    }
+    if (max_neighbors < 2) {
+        PyErr_SetString(PyExc_ValueError, "M must be at least 2");
+        return NULL;
+    }
+    if (ef_construction <= 0 || ef_search <= 0) {
+        PyErr_SetString(PyExc_ValueError, "ef_construction and ef_search must be positive");
+        return NULL;
+    }
+    if (threads < 0 || recall_sample < 0) {
+        PyErr_SetString(PyExc_ValueError, "threads and recall_sample can't be negative");
+        return NULL;
+    }
+    if (!acquire_python_matrix(data_points, &data_points_mat)) {
+        return NULL;
+    }
+
+    init_hnsw_options(&options);
+    options.max_neighbors = max_neighbors;
+    options.ef_construction = ef_construction;
+    options.ef_search = ef_search;
+    options.seed = (uint32_t) seed;
+    options.recall_sample_size = recall_sample;
+    Py_BEGIN_ALLOW_THREADS
+    wam = hnsw_weighted_adjacency_matrix(data_points_mat.rows, data_points_mat.n, data_points_mat.m, neighbors,
+                                         &options, threads, (recall_sample > 0) ? &recall : NULL);
+    Py_END_ALLOW_THREADS
+    release_python_matrix(&data_points_mat);
+
+    /* The CSR buffers are followed by the recall */
+    csr = csr_matrix_to_python(wam);
+    res = PyTuple_New(4);
+    for (i = 0; i < 3; i++) {
+        Py_INCREF(PyTuple_GET_ITEM(csr, i));
+        PyTuple_SetItem(res, i, PyTuple_GET_ITEM(csr, i));
+    }
+    Py_DECREF(csr);
+    if (recall_sample > 0) {
+        PyTuple_SetItem(res, 3, PyFloat_FromDouble(recall));
+    } else {
+        Py_INCREF(Py_None);
+        PyTuple_SetItem(res, 3, Py_None);
+    }
+    return res;
+}
+
+static PyObject* radius_wam_wrapper(PyObject *self, PyObject *args, PyObject *kwargs) {
+    PyObject *data_points = NULL;
+    PyObject *csr = NULL, *res = NULL;
+    PyMatrix data_points_mat;
+    CsrMatrix *wam = NULL;
+    RadiusGraphBound bound;
+    double radius = DEFAULT_RADIUS;
+    Py_ssize_t threads = 0, i;
+
+    static char* kwlist[] = {"data_points", "radius", "threads", NULL};
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|dn", kwlist, &data_points, &radius, &threads)) {
+        return NULL;
+    }
+    if (!(radius > 0)) {
+        PyErr_SetString(PyExc_ValueError, "radius must be positive");
+        return NULL;
+    }
+    if (threads < 0) {
+        PyErr_SetString(PyExc_ValueError, "threads can't be negative");
+        return NULL;
+    }
+    if (!acquire_python_matrix(data_points, &data_points_mat)) {
+        return NULL;
+    }
+
+    Py_BEGIN_ALLOW_THREADS
+    wam = radius_weighted_adjacency_matrix(data_points_mat.rows, data_points_mat.n, data_points_mat.m, radius,
+                                           threads, &bound);
+    Py_END_ALLOW_THREADS
+    release_python_matrix(&data_points_mat);
+
+    /* The CSR buffers are followed by the error bounds */
+    csr = csr_matrix_to_python(wam);
+    res = PyTuple_New(5);
+    for (i = 0; i < 3; i++) {
+        Py_INCREF(PyTuple_GET_ITEM(csr, i));
+        PyTuple_SetItem(res, i, PyTuple_GET_ITEM(csr, i));
+    }
+    Py_DECREF(csr);
+    PyTuple_SetItem(res, 3, PyFloat_FromDouble(bound.dropped_mass));
+    PyTuple_SetItem(res, 4, PyFloat_FromDouble(bound.laplacian_error));
+    return res;
+}
+
+static PyObject *current_exception(void) {
+    PyObject *type = NULL, *value = NULL, *traceback = NULL;
+
+    PyErr_Fetch(&type, &value, &traceback);
+    PyErr_NormalizeException(&type, &value, &traceback);
+    if (traceback != NULL) {
+        PyException_SetTraceback(value, traceback);
+    }
+    Py_XDECREF(type);
+    Py_XDECREF(traceback);
+    return value;
+}
+
+static void run_batch_job(void *context, size_t job_idx) {
+    BatchContext *batch = (BatchContext *) context;
+    BatchJob *job = &batch -> jobs[job_idx];
+
+    if (!job -> acquired) {
+        return;
+    }
+    if (batch -> goal == BATCH_SPK) {
+        job -> spectral_result = spectral_clustering(job -> matrix.rows, batch -> k, job -> matrix.n,
+                                                     job -> matrix.m);
+    } else {
+        job -> jacobi_result = jacobi(job -> matrix.rows, job -> matrix.n);
+    }
+}
+
+/*
+ * Acquire every matrix of the datasets sequence, run the jobs of the valid ones on a pool of threads without
+ * holding the GIL, and return the list of their results in order. A dataset that can't be acquired or doesn't
+ * fit the goal gets the exception it raised in place of its result, and doesn't affect the other jobs.
+ */
+static PyObject *run_batch(PyObject *datasets, BatchGoal goal, Py_ssize_t k, bool columns, Py_ssize_t threads) {
+    PyObject *seq = NULL, *res = NULL;
+    Py_ssize_t jobs_count, i;
+    BatchContext batch;
+
+    seq = PySequence_Fast(datasets, "datasets must be a sequence");
+    if (seq == NULL) {
+        return NULL;
+    }
+    jobs_count = PySequence_Fast_GET_SIZE(seq);
+    res = PyList_New(jobs_count);
+    batch.goal = goal;
+    batch.k = k;
+    batch.jobs = (BatchJob *) calloc(jobs_count > 0 ? jobs_count : 1, sizeof(BatchJob));
+
+    for (i = 0; i < jobs_count; i++) {
+        BatchJob *job = &batch.jobs[i];
+
+        if (!acquire_python_matrix(PySequence_Fast_GET_ITEM(seq, i), &job -> matrix)) {
+            PyList_SET_ITEM(res, i, current_exception());
+            continue;
+        }
+        if (goal == BATCH_SPK && k > job -> matrix.n) {
+            PyErr_SetString(PyExc_ValueError, "k can't be larger than n");
+        } else if (goal == BATCH_JACOBI && job -> matrix.m != job -> matrix.n) {
+            PyErr_SetString(PyExc_ValueError, "The matrix must be square");
+        } else {
+            job -> acquired = true;
+            continue;
+        }
+        release_python_matrix(&job -> matrix);
+        PyList_SET_ITEM(res, i, current_exception());
+    }
+
+    Py_BEGIN_ALLOW_THREADS
+    parallel_for(jobs_count, threads, run_batch_job, &batch);
+    Py_END_ALLOW_THREADS
+
+    for (i = 0; i < jobs_count; i++) {
+        BatchJob *job = &batch.jobs[i];
+
+        if (!job -> acquired) {
+            continue;
+        }
+        if (goal == BATCH_SPK) {
+            PyList_SET_ITEM(res, i, spectral_result_to_python(job -> spectral_result, job -> matrix.n));
+        } else {
+            PyList_SET_ITEM(res, i, jacobi_result_to_python(job -> jacobi_result, job -> matrix.n, columns));
+        }
+        release_python_matrix(&job -> matrix);
+    }
+
+    free(batch.jobs);
+    Py_DECREF(seq);
+    return res;
+}
+
+static PyObject* spk_batch_wrapper(PyObject *self, PyObject *args, PyObject *kwargs) {
+    PyObject *datasets = NULL, *optional_k = Py_None;
+    Py_ssize_t k, threads = 0;
+
+    static char* kwlist[] = {"datasets", "k", "threads", NULL};
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|On", kwlist, &datasets, &optional_k, &threads) ||
+        !optional_k_from_object(optional_k, &k)) {
+        return NULL;
+    }
+    if (threads < 0) {
+        PyErr_SetString(PyExc_ValueError, "threads can't be negative");
+        return NULL;
+    }
+
+    return run_batch(datasets, BATCH_SPK, k, false, threads);
+}
+
+static PyObject* jacobi_batch_wrapper(PyObject *self, PyObject *args, PyObject *kwargs) {
+    PyObject *matrices = NULL;
+    int columns = 0;
+    Py_ssize_t threads = 0;
+
+    static char* kwlist[] = {"matrices", "columns", "threads", NULL};
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|pn", kwlist, &matrices, &columns, &threads)) {
+        return NULL;
+    }
+    if (threads < 0) {
+        PyErr_SetString(PyExc_ValueError, "threads can't be negative");
+        return NULL;
+    }
+
+    return run_batch(matrices, BATCH_JACOBI, 0, columns, threads);
+}
+
+static PyObject* kmeanspp_init_wrapper(PyObject *self, PyObject *args, PyObject *kwargs) {
+    PyObject *data_points = NULL, *res = NULL;
+    Py_ssize_t n, m, k, i;
+    unsigned long seed = 0;
+    int numpy_compatible = 0;
+    size_t *centroids_idxs = NULL;
+    PyMatrix data_points_mat;
+    RandomState rs;
+
+    static char* kwlist[] = {"points", "k", "seed", "numpy_compatible", NULL};
+    if (!PyArg_ParseTupleAndKeywords(
+            args,
+            kwargs,
+            "On|kp",
+            kwlist,
+            &data_points, &k, &seed, &numpy_compatible)) {
+        return NULL;
+    }
+
+    if (!acquire_python_matrix(data_points, &data_points_mat)) {
+        return NULL;
+    }
+    n = data_points_mat.n;
+    m = data_points_mat.m;
+    if (k <= 0 || k > n) {
+        release_python_matrix(&data_points_mat);
+        PyErr_SetString(PyExc_ValueError, "k must be in the range [1, n]");
+        return NULL;
+    }
+
+    centroids_idxs = (size_t *) calloc(k, sizeof(size_t));
+
+    Py_BEGIN_ALLOW_THREADS
+    seed_random_state(&rs, (uint32_t) seed);
+    kmeanspp(data_points_mat.rows, n, m, k,
+             numpy_compatible ? NUMPY_COMPATIBLE_SEEDING : STANDARD_SEEDING,
+             &rs, centroids_idxs);
+    Py_END_ALLOW_THREADS
+
+    res = PyList_New(k);
+    for (i = 0; i < k; i++) {
+        PyList_SetItem(res, i, PyLong_FromSize_t(centroids_idxs[i]));
+    }
+
+    free(centroids_idxs);
+    release_python_matrix(&data_points_mat);
+
+    return res;
+}
+
+static PyObject* kmeans_parallel_init_wrapper(PyObject *self, PyObject *args, PyObject *kwargs) {
+    PyObject *data_points = NULL, *res = NULL;
+    Py_ssize_t n, m, k, i, rounds = 0, threads = 0;
+    unsigned long seed = 0;
+    double oversampling_factor = 0.0;
+    size_t *centroids_idxs = NULL;
+    PyMatrix data_points_mat;
+    RandomState rs;
+
+    static char* kwlist[] = {"points", "k", "seed", "rounds", "oversampling_factor", "threads", NULL};
+    if (!PyArg_ParseTupleAndKeywords(
+            args,
+            kwargs,
+            "On|kndn",
+            kwlist,
+            &data_points, &k, &seed, &rounds, &oversampling_factor, &threads)) {
+        return NULL;
+    }
+
+    if (rounds < 0) {
+        PyErr_SetString(PyExc_ValueError, "rounds can't be negative");
+        return NULL;
+    }
+    if (threads < 0) {
+        PyErr_SetString(PyExc_ValueError, "threads can't be negative");
+        return NULL;
+    }
+    if (!acquire_python_matrix(data_points, &data_points_mat)) {
+        return NULL;
+    }
+    n = data_points_mat.n;
+    m = data_points_mat.m;
+    if (k <= 0 || k > n) {
+        release_python_matrix(&data_points_mat);
+        PyErr_SetString(PyExc_ValueError, "k must be in the range [1, n]");
         return NULL;
     }
 
-    n = PyList_Size(data_points);
-    m = PyList_Size(PyList_GetItem(data_points, 0));
-    data_points_mat = from_python_matrix(data_points);
+    centroids_idxs = (size_t *) calloc(k, sizeof(size_t));
+
+    Py_BEGIN_ALLOW_THREADS
+    seed_random_state(&rs, (uint32_t) seed);
+    kmeans_parallel(data_points_mat.rows, n, m, k, rounds, oversampling_factor, &rs,
+                    centroids_idxs, threads);
+    Py_END_ALLOW_THREADS
+
+    res = PyList_New(k);
+    for (i = 0; i < k; i++) {
+        PyList_SetItem(res, i, PyLong_FromSize_t(centroids_idxs[i]));
+    }
+
+    free(centroids_idxs);
+    release_python_matrix(&data_points_mat);
+
+    return res;
+}
+
+static PyObject* kmeans_fit_wrapper(PyObject *self, PyObject *args, PyObject *kwargs) {
+    PyObject *initial_centroids_lst = NULL, *data_points = NULL, *res = NULL, *centroids = NULL, *cluster_sizes = NULL;
+    Py_ssize_t n, m, k, i;
+    Cluster *clusters = NULL;
+    Matrix centroids_mat = NULL;
+    PyMatrix initial_centroids_mat, data_points_mat;
+    KmeansOptions options;
+    KmeansResult result;
+
+    Py_ssize_t iter = DEFAULT_ITERATIONS_COUNT;
+    double epsilon = DEFAULT_EPSILON;
+    const char *algorithm_name = kmeans_algorithm_names[LLOYD];
+    Py_ssize_t batch_size = 0;
+    unsigned long seed = 0;
+    Py_ssize_t threads = 0;
+
+    static char* kwlist[] = {"centroids_lst", "vectors_lst", "k", "iter", "epsilon", "algorithm", "batch_size",
+                             "seed", "threads", NULL};
+    if (!PyArg_ParseTupleAndKeywords(
+            args,
+            kwargs,
+            "OOn|ndsnkn",
+            kwlist,
+            &initial_centroids_lst, &data_points, &k, &iter, &epsilon, &algorithm_name, &batch_size, &seed,
+            &threads)) {
+        return NULL;
+    }
+
+    if (batch_size < 0) {
+        PyErr_SetString(PyExc_ValueError, "batch_size can't be negative");
+        return NULL;
+    }
+    if (threads < 0) {
+        PyErr_SetString(PyExc_ValueError, "threads can't be negative");
+        return NULL;
+    }
+
+    init_kmeans_options(&options);
+    options.iter = iter;
+    options.epsilon = epsilon;
+    options.batch_size = batch_size;
+    options.seed = (uint32_t) seed;
+    options.threads_count = threads;
+    if (!kmeans_algorithm_from_name(algorithm_name, &options.algorithm)) {
+        PyErr_Format(PyExc_ValueError, "Unknown k-means algorithm '%s'", algorithm_name);
+        return NULL;
+    }
+
+    if (!acquire_python_matrix(initial_centroids_lst, &initial_centroids_mat)) {
+        return NULL;
+    }
+    if (!acquire_python_matrix(data_points, &data_points_mat)) {
+        release_python_matrix(&initial_centroids_mat);
+        return NULL;
+    }
+    n = data_points_mat.n;
+    m = data_points_mat.m;
+    if (initial_centroids_mat.n != k || initial_centroids_mat.m != m) {
+        release_python_matrix(&initial_centroids_mat);
+        release_python_matrix(&data_points_mat);
+        PyErr_SetString(PyExc_ValueError, "Expected k initial centroids of the vectors dimension");
+        return NULL;
+    }
+
+    /* fit writes to the centroids, so the caller's initial centroids are copied */
+    centroids_mat = copy_matrix(initial_centroids_mat.rows, k, m);
+    release_python_matrix(&initial_centroids_mat);
+    clusters = (Cluster *) malloc(sizeof(Cluster) * k);
+
+    for (i = 0; i < k; i++) {
+        clusters[i].centroid = centroids_mat[i];
+    }
+
+    Py_BEGIN_ALLOW_THREADS
+    fit_with_options(clusters, data_points_mat.rows, n, m, k, &options, &result);
+    Py_END_ALLOW_THREADS
+
+    res = PyStructSequence_New(&KmeansResultType);
+    centroids = PyList_New(k);
+    cluster_sizes = PyList_New(k);
+    for (i = 0; i < k; i++) {
+        PyList_SetItem(centroids, i, to_python_vector(clusters[i].centroid, m));
+        PyList_SetItem(cluster_sizes, i, PyLong_FromSize_t(result.cluster_sizes[i]));
+    }
+    PyStructSequence_SetItem(res, 0, centroids);
+    /* The labels buffer takes ownership of the labels array */
+    PyStructSequence_SetItem(res, 1, to_python_buffer(result.labels, "N", sizeof(size_t), 1, &n, NULL));
+    PyStructSequence_SetItem(res, 2, cluster_sizes);
+    PyStructSequence_SetItem(res, 3, PyFloat_FromDouble(result.inertia));
+    PyStructSequence_SetItem(res, 4, PyLong_FromSize_t(result.iterations));
+    PyStructSequence_SetItem(res, 5, PyBool_FromLong(result.converged));
+    free(result.cluster_sizes);
+
+    free(clusters);
+    free_matrix(centroids_mat, k);
+    release_python_matrix(&data_points_mat);
+
+    return res;
+}
+
+static PyObject* kmeans_fit_multi_wrapper(PyObject *self, PyObject *args, PyObject *kwargs) {
+    PyObject *data_points = NULL, *res = NULL, *centroids = NULL, *idxs = NULL, *inertias_lst = NULL;
+    Py_ssize_t n, m, k, i;
+    Py_ssize_t restarts = 10, threads = 0;
+    Py_ssize_t iter = DEFAULT_ITERATIONS_COUNT;
+    double epsilon = DEFAULT_EPSILON;
+    const char *algorithm_name = kmeans_algorithm_names[AUTO];
+    unsigned long seed = 0;
+    int numpy_compatible = 0;
+    size_t *centroids_idxs = NULL;
+    Vector inertias = NULL;
+    Cluster *clusters = NULL;
+    Matrix centroids_mat = NULL;
+    PyMatrix data_points_mat;
+    KmeansOptions options;
+
+    static char* kwlist[] = {"points", "k", "restarts", "iter", "epsilon", "algorithm", "seed", "numpy_compatible",
+                             "threads", NULL};
+    if (!PyArg_ParseTupleAndKeywords(
+            args,
+            kwargs,
+            "On|nndskpn",
+            kwlist,
+            &data_points, &k, &restarts, &iter, &epsilon, &algorithm_name, &seed, &numpy_compatible,
+            &threads)) {
+        return NULL;
+    }
+
+    if (restarts <= 0) {
+        PyErr_SetString(PyExc_ValueError, "restarts must be positive");
+        return NULL;
+    }
+    if (threads < 0) {
+        PyErr_SetString(PyExc_ValueError, "threads can't be negative");
+        return NULL;
+    }
+
+    init_kmeans_options(&options);
+    options.iter = iter;
+    options.epsilon = epsilon;
+    options.seed = (uint32_t) seed;
+    options.threads_count = threads;
+    if (!kmeans_algorithm_from_name(algorithm_name, &options.algorithm)) {
+        PyErr_Format(PyExc_ValueError, "Unknown k-means algorithm '%s'", algorithm_name);
+        return NULL;
+    }
+
+    if (!acquire_python_matrix(data_points, &data_points_mat)) {
+        return NULL;
+    }
+    n = data_points_mat.n;
+    m = data_points_mat.m;
+    if (k <= 0 || k > n) {
+        release_python_matrix(&data_points_mat);
+        PyErr_SetString(PyExc_ValueError, "k must be in the range [1, n]");
+        return NULL;
+    }
+
+    centroids_mat = build_matrix(k, m);
+    clusters = (Cluster *) malloc(sizeof(Cluster) * k);
+    centroids_idxs = (size_t *) calloc(k, sizeof(size_t));
+    inertias = (Vector) calloc(restarts, sizeof(double));
+
+    for (i = 0; i < k; i++) {
+        clusters[i].centroid = centroids_mat[i];
+    }
+
+    Py_BEGIN_ALLOW_THREADS
+    fit_multi(clusters, data_points_mat.rows, n, m, k, restarts,
+              numpy_compatible ? NUMPY_COMPATIBLE_SEEDING : STANDARD_SEEDING,
+              &options, centroids_idxs, inertias);
+    Py_END_ALLOW_THREADS
 
-    wam = weighted_adjacency_matrix(data_points_mat, n, m);
-    res = to_python_matrix(wam, n, n);
+    centroids = to_python_matrix(centroids_mat, k, m);
+    idxs = PyList_New(k);
+    for (i = 0; i < k; i++) {
+        PyList_SetItem(idxs, i, PyLong_FromSize_t(centroids_idxs[i]));
+    }
+    inertias_lst = to_python_vector(inertias, restarts);
+    res = PyTuple_Pack(3, centroids, idxs, inertias_lst);
+    Py_DECREF(centroids);
+    Py_DECREF(idxs);
+    Py_DECREF(inertias_lst);
 
-    free_matrix(data_points_mat, n);
-    free_matrix(wam, n);
+    free(inertias);
+    free(centroids_idxs);
+    free(clusters);
+    free_matrix(centroids_mat, k);
+    release_python_matrix(&data_points_mat);
 
     return res;
 }
 
-static PyObject* ddg_wrapper(PyObject *self, PyObject *args) {
-    Py_ssize_t m, n;
-    PyObject *data_points = NULL;
-    PyObject *res = NULL;
-    Matrix data_points_mat = NULL;
-    Matrix wam = NULL;
-    Matrix ddg = NULL;
+static PyObject* spkmeans_wrapper(PyObject *self, PyObject *args, PyObject *kwargs) {
+    PyObject *data_points_py = NULL, *optional_k = Py_None, *res = NULL, *idxs = NULL;
+    Py_ssize_t n, k, i;
+    PyMatrix data_points_mat;
+    KmeansOptions options;
+    SpkmeansResult *result = NULL;
+
+    Py_ssize_t iter = DEFAULT_ITERATIONS_COUNT;
+    double epsilon = DEFAULT_EPSILON;
+    const char *algorithm_name = kmeans_algorithm_names[AUTO];
+    Py_ssize_t batch_size = 0;
+    unsigned long seed = 0;
+    Py_ssize_t threads = 0;
+    const char *graph_name = affinity_graph_names[DENSE_GRAPH];
+    Py_ssize_t neighbors = DEFAULT_NEIGHBORS_COUNT;
+    double radius = DEFAULT_RADIUS;
+    const char *eigensolver_name = eigensolver_names[AUTO_EIGENSOLVER];
+    const char *engine_name = spectral_engine_names[GRAPH_ENGINE];
+    Py_ssize_t landmarks = NYSTROM_DEFAULT_LANDMARKS_COUNT;
+    const char *sampling_name = landmark_sampling_names[UNIFORM_LANDMARKS];
+    Py_ssize_t nearest_landmarks = LSC_DEFAULT_NEAREST_LANDMARKS;
+    Py_ssize_t features = RFF_DEFAULT_FEATURES_COUNT;
+    SpectralOptions spectral_options;
+
+    static char* kwlist[] = {"data_points", "k", "seed", "iter", "epsilon", "algorithm", "batch_size", "threads",
+                             "graph", "neighbors", "radius", "eigensolver", "engine", "landmarks", "sampling",
+                             "nearest_landmarks", "features", NULL};
+    if (!PyArg_ParseTupleAndKeywords(
+            args,
+            kwargs,
+            "O|Okndsnnsndssnsnn",
+            kwlist,
+            &data_points_py, &optional_k, &seed, &iter, &epsilon, &algorithm_name, &batch_size, &threads,
+            &graph_name, &neighbors, &radius, &eigensolver_name, &engine_name, &landmarks, &sampling_name,
+            &nearest_landmarks, &features)) {
+        return NULL;
+    }
+    if (!spectral_options_from_args(graph_name, neighbors, radius, eigensolver_name, threads, &spectral_options) ||
+        !engine_options_from_args(engine_name, landmarks, sampling_name, nearest_landmarks, features,
+                                  seed, &spectral_options)) {
+        return NULL;
+    }
 
-    if (!PyArg_ParseTuple(args, "O", &data_points)) {
+    if (batch_size < 0) {
+        PyErr_SetString(PyExc_ValueError, "batch_size can't be negative");
+        return NULL;
+    }
+    if (threads < 0) {
+        PyErr_SetString(PyExc_ValueError, "threads can't be negative");
         return NULL;
     }
 
-    n = PyList_Size(data_points);
-    m = PyList_Size(PyList_GetItem(data_points, 0));
-    data_points_mat = from_python_matrix(data_points);
+    init_kmeans_options(&options);
+    options.iter = iter;
+    options.epsilon = epsilon;
+    options.batch_size = batch_size;
+    options.seed = (uint32_t) seed;
+    options.threads_count = threads;
+    if (!kmeans_algorithm_from_name(algorithm_name, &options.algorithm)) {
+        PyErr_Format(PyExc_ValueError, "Unknown k-means algorithm '%s'", algorithm_name);
+        return NULL;
+    }
 
-    wam = weighted_adjacency_matrix(data_points_mat, n, m);
-    ddg = diagonal_degree_matrix(wam, n);
+    if (!optional_k_from_object(optional_k, &k) || !acquire_python_matrix(data_points_py, &data_points_mat)) {
+        return NULL;
+    }
+    n = data_points_mat.n;
+    if (k > n) {
+        release_python_matrix(&data_points_mat);
+        PyErr_SetString(PyExc_ValueError, "k can't be larger than n");
+        return NULL;
+    }
 
-    res = to_python_matrix(ddg, n, n);
+    Py_BEGIN_ALLOW_THREADS
+    result = spkmeans(data_points_mat.rows, k, n, data_points_mat.m, &spectral_options, &options);
+    Py_END_ALLOW_THREADS
+    release_python_matrix(&data_points_mat);
 
-    free_matrix(data_points_mat, n);
-    free_matrix(wam, n);
-    free_matrix(ddg, n);
+    k = result -> k;
+    idxs = PyList_New(k);
+    for (i = 0; i < k; i++) {
+        PyList_SetItem(idxs, i, PyLong_FromSize_t(result -> centroids_idxs[i]));
+    }
+
+    res = PyStructSequence_New(&SpkmeansResultType);
+    /* The buffers take ownership of the labels array and the centroids matrix */
+    PyStructSequence_SetItem(res, 0, to_python_buffer(result -> kmeans_result.labels, "N", sizeof(size_t), 1, &n,
+                                                      NULL));
+    PyStructSequence_SetItem(res, 1, to_python_matrix_buffer(result -> centroids, k, k, false));
+    PyStructSequence_SetItem(res, 2, PyLong_FromSsize_t(k));
+    PyStructSequence_SetItem(res, 3, idxs);
+    PyStructSequence_SetItem(res, 4, PyFloat_FromDouble(result -> kmeans_result.inertia));
+    PyStructSequence_SetItem(res, 5, PyLong_FromSize_t(result -> kmeans_result.iterations));
+    PyStructSequence_SetItem(res, 6, PyBool_FromLong(result -> kmeans_result.converged));
 
+    free(result -> kmeans_result.cluster_sizes);
+    free(result -> centroids_idxs);
+    free(result);
     return res;
 }
 
-static PyObject* gl_wrapper(PyObject *self, PyObject *args) {
-    Py_ssize_t m, n;
-    PyObject *data_points = NULL;
-    PyObject *res = NULL;
-    Matrix data_points_mat = NULL;
-    Matrix wam = NULL;
-    Matrix ddg = NULL;
-    Matrix gl = NULL;
-
-    if (!PyArg_ParseTuple(args, "O", &data_points)) {
-        return NULL;
-    }
+/**
+ * A dataset whose spectral clustering stages are each computed once, when
+ * first used. The stages are computed without holding the GIL, under the
+ * model's lock, and the data points are freed once the WAM is computed.
+ */
+typedef struct SpectralModelObject {
+    PyObject_HEAD
+    Py_ssize_t n;
+    Py_ssize_t m;
+    Matrix data_points;
+    Matrix wam;
+    Matrix ddg;
+    Matrix laplacian;
+    JacobiResult *jacobi_result;
+    Vector sorted_eigenvalues;
+    PyThread_type_lock lock;
+} SpectralModelObject;
 
-    n = PyList_Size(data_points);
-    m = PyList_Size(PyList_GetItem(data_points, 0));
-    data_points_mat = from_python_matrix(data_points);
+typedef enum SpectralStage {
+    WAM_STAGE,
+    DDG_STAGE,
+    LAPLACIAN_STAGE,
+    EIGEN_STAGE
+} SpectralStage;
 
-    wam = weighted_adjacency_matrix(data_points_mat, n, m);
-    ddg = diagonal_degree_matrix(wam, n);
-    gl = graph_laplacian(ddg, wam, n);
+static PyTypeObject SpectralModelType;
 
-    res = to_python_matrix(gl, n, n);
+static void compute_spectral_stage(SpectralModelObject *model, SpectralStage stage) {
+    size_t n = model -> n;
 
-    free_matrix(data_points_mat, n);
-    free_matrix(wam, n);
-    free_matrix(ddg, n);
-    free_matrix(gl, n);
+    if (model -> wam == NULL) {
+        model -> wam = weighted_adjacency_matrix(model -> data_points, n, model -> m);
+        free_matrix(model -> data_points, n);
+        model -> data_points = NULL;
+    }
+    if (stage >= DDG_STAGE && model -> ddg == NULL) {
+        model -> ddg = diagonal_degree_matrix(model -> wam, n);
+    }
+    if (stage >= LAPLACIAN_STAGE && model -> laplacian == NULL) {
+        model -> laplacian = graph_laplacian(model -> ddg, model -> wam, n);
+    }
+    if (stage >= EIGEN_STAGE && model -> jacobi_result == NULL) {
+        model -> jacobi_result = jacobi(model -> laplacian, n);
+        model -> sorted_eigenvalues = sort_eigenvalues(model -> jacobi_result -> eigenvalues, n);
+    }
+}
 
-    return res;
+static void ensure_spectral_stage(SpectralModelObject *model, SpectralStage stage) {
+    Py_BEGIN_ALLOW_THREADS
+    PyThread_acquire_lock(model -> lock, WAIT_LOCK);
+    compute_spectral_stage(model, stage);
+    PyThread_release_lock(model -> lock);
+    Py_END_ALLOW_THREADS
 }
 
-static PyObject* jacobi_wrapper(PyObject *self, PyObject *args) {
-    Py_ssize_t n;
+static PyObject *spectral_model_new(PyTypeObject *type, PyObject *args, PyObject *kwargs) {
     PyObject *data_points = NULL;
-    Matrix data_points_mat = NULL;
-    JacobiResult *jacobi_result = NULL;
+    PyMatrix data_points_mat;
+    SpectralModelObject *model = NULL;
 
-    PyObject *res = NULL;
-    PyObject *eigenvectors = NULL;
-    PyObject *eigenvalues = NULL;
+    static char* kwlist[] = {"data_points", NULL};
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O", kwlist, &data_points) ||
+        !acquire_python_matrix(data_points, &data_points_mat)) {
+        return NULL;
+    }
 
-    if (!PyArg_ParseTuple(args, "O", &data_points)) {
+    model = (SpectralModelObject *) type -> tp_alloc(type, 0);
+    if (model == NULL) {
+        release_python_matrix(&data_points_mat);
         return NULL;
     }
 
-    n = PyList_Size(data_points);
-    data_points_mat = from_python_matrix(data_points);
-    jacobi_result = jacobi(data_points_mat, n);
+    /* The model outlives the call, so it keeps its own copy of the data points */
+    model -> n = data_points_mat.n;
+    model -> m = data_points_mat.m;
+    model -> data_points = copy_matrix(data_points_mat.rows, data_points_mat.n, data_points_mat.m);
+    model -> lock = PyThread_allocate_lock();
+    release_python_matrix(&data_points_mat);
+    if (model -> lock == NULL) {
+        Py_DECREF(model);
+        return PyErr_NoMemory();
+    }
+
+    return (PyObject *) model;
+}
 
-    eigenvectors = to_python_matrix(jacobi_result -> eigenvectors, n, n);
-    eigenvalues = to_python_vector(jacobi_result -> eigenvalues, n);
-    res = PyTuple_New(2);
-    PyTuple_SetItem(res, 0, eigenvectors);
-    PyTuple_SetItem(res, 1, eigenvalues);
+static void spectral_model_dealloc(PyObject *self) {
+    SpectralModelObject *model = (SpectralModelObject *) self;
 
-    free_matrix(data_points_mat, n);
-    free_matrix(jacobi_result -> eigenvectors, n);
-    free(jacobi_result -> eigenvalues);
-    free(jacobi_result);
+    if (model -> data_points != NULL) {
+        free_matrix(model -> data_points, model -> n);
+    }
+    if (model -> wam != NULL) {
+        free_matrix(model -> wam, model -> n);
+    }
+    if (model -> ddg != NULL) {
+        free_matrix(model -> ddg, model -> n);
+    }
+    if (model -> laplacian != NULL) {
+        free_matrix(model -> laplacian, model -> n);
+    }
+    if (model -> jacobi_result != NULL) {
+        free_matrix(model -> jacobi_result -> eigenvectors, model -> n);
+        free(model -> jacobi_result -> eigenvalues);
+        free(model -> jacobi_result);
+    }
+    free(model -> sorted_eigenvalues);
+    if (model -> lock != NULL) {
+        PyThread_free_lock(model -> lock);
+    }
+    Py_TYPE(self) -> tp_free(self);
+}
 
-    return res;
+static PyObject *spectral_model_matrix_view(SpectralModelObject *model, Matrix matrix) {
+    Py_ssize_t shape[2];
+
+    shape[0] = model -> n;
+    shape[1] = model -> n;
+    return to_python_view(matrix_values(matrix, model -> n), "d", sizeof(double), 2, shape, NULL,
+                          (PyObject *) model);
 }
 
-static PyObject* spk_wrapper(PyObject *self, PyObject *args, PyObject *kwargs) {
-    PyObject *data_points_py = NULL;
-    PyObject *optional_k = Py_None;
-    PyObject *res = NULL;
+static PyObject *spectral_model_get_wam(PyObject *self, void *closure) {
+    SpectralModelObject *model = (SpectralModelObject *) self;
+
+    ensure_spectral_stage(model, WAM_STAGE);
+    return spectral_model_matrix_view(model, model -> wam);
+}
+
+static PyObject *spectral_model_get_degrees(PyObject *self, void *closure) {
+    SpectralModelObject *model = (SpectralModelObject *) self;
+    Py_ssize_t stride = (model -> n + 1) * (Py_ssize_t) sizeof(double);
+
+    ensure_spectral_stage(model, DDG_STAGE);
+    /* The degrees are the diagonal of the diagonal degree matrix */
+    return to_python_view(matrix_values(model -> ddg, model -> n), "d", sizeof(double), 1, &model -> n,
+                          &stride, self);
+}
+
+static PyObject *spectral_model_get_laplacian(PyObject *self, void *closure) {
+    SpectralModelObject *model = (SpectralModelObject *) self;
+
+    ensure_spectral_stage(model, LAPLACIAN_STAGE);
+    return spectral_model_matrix_view(model, model -> laplacian);
+}
 
+static PyObject *spectral_model_eigen(PyObject *self, PyObject *args, PyObject *kwargs) {
+    SpectralModelObject *model = (SpectralModelObject *) self;
+    PyObject *optional_k = Py_None, *res = NULL;
     Py_ssize_t k;
+    Vector eigenvalues = NULL;
     SpectralResult *spr = NULL;
 
-    static char* kwlist[] = {"data_points", "k", NULL};
-    if (!PyArg_ParseTupleAndKeywords(
-            args,
-            kwargs,
-            "O|O",
-            kwlist,
-            &data_points_py, &optional_k)) {
+    static char* kwlist[] = {"k", NULL};
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "|O", kwlist, &optional_k) ||
+        !optional_k_from_object(optional_k, &k)) {
         return NULL;
     }
-
-    if (optional_k == Py_None) {
-        k = 0;
-    } else if (PyLong_Check(optional_k)) {
-        k = PyLong_AsLong(optional_k);
-    } else {
-        PyErr_SetString(PyExc_TypeError, "K must be an int or None");
+    k = (optional_k == Py_None) ? model -> n : k;
+    if (k <= 0 || k > model -> n) {
+        PyErr_SetString(PyExc_ValueError, "k must be in the range [1, n]");
         return NULL;
     }
 
-    Py_ssize_t n = PyList_Size(data_points_py);
-    Py_ssize_t m = PyList_Size(PyList_GetItem(data_points_py, 0));
-    if (k > n) {
-        PyErr_SetString(PyExc_ValueError, "k can't be larger than n");
-        return NULL;
-    }
+    ensure_spectral_stage(model, EIGEN_STAGE);
+    Py_BEGIN_ALLOW_THREADS
+    spr = spectral_embedding(model -> jacobi_result, k, model -> n);
+    eigenvalues = copy_vector(model -> sorted_eigenvalues, k);
+    Py_END_ALLOW_THREADS
 
-    Matrix data_points_c = from_python_matrix(data_points_py);
-    spr = spectral_clustering(data_points_c, k, n, m);
     res = PyTuple_New(2);
-    PyTuple_SetItem(res, 0, to_python_matrix(spr -> new_points, spr -> k, n));
-    PyTuple_SetItem(res, 1, PyLong_FromLong(spr -> k));
+    PyTuple_SetItem(res, 0, to_python_matrix_buffer(spr -> new_points, k, model -> n, false));
+    PyTuple_SetItem(res, 1, to_python_buffer(eigenvalues, "d", sizeof(double), 1, &k, NULL));
 
-    free_matrix(data_points_c, n);
     free(spr);
     return res;
 }
 
-static PyObject* kmeans_fit_wrapper(PyObject *self, PyObject *args) {
-    PyObject *initial_centroids_lst = NULL, *data_points = NULL, *res = NULL, *centroid = NULL;
-    Py_ssize_t n, m, k, i;
-    Cluster *clusters = NULL;
-    Matrix initial_centroids_mat = NULL;
-    Matrix data_points_mat = NULL;
-
-    Py_ssize_t iter = DEFAULT_ITERATIONS_COUNT;
-    double epsilon = DEFAULT_EPSILON;
+static PyObject *spectral_model_embed(PyObject *self, PyObject *args, PyObject *kwargs) {
+    SpectralModelObject *model = (SpectralModelObject *) self;
+    PyObject *optional_k = Py_None, *res = NULL;
+    Py_ssize_t k;
+    SpectralResult *spr = NULL;
 
-    if (!PyArg_ParseTuple(args, "OOn|n|d", &initial_centroids_lst, &data_points, &k, &iter, &epsilon)) {
+    static char* kwlist[] = {"k", NULL};
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "|O", kwlist, &optional_k) ||
+        !optional_k_from_object(optional_k, &k)) {
         return NULL;
     }
-
-    n = PyList_Size(data_points);
-    m = PyList_Size(PyList_GetItem(data_points, 0));
-
-    data_points_mat = from_python_matrix(data_points);
-    initial_centroids_mat = from_python_matrix(initial_centroids_lst);
-    clusters = (Cluster *) malloc(sizeof(Cluster) * k);
-
-    for (i = 0; i < k; i++) {
-        clusters[i].centroid = initial_centroids_mat[i];
+    if (k > model -> n) {
+        PyErr_SetString(PyExc_ValueError, "k must be in the range [0, n]");
+        return NULL;
     }
 
-    fit(clusters, data_points_mat, n, m, k, iter, epsilon);
-
-    res = PyList_New(k);
-    for (i = 0; i < k; i++) {
-        centroid = to_python_vector(clusters[i].centroid, m);
-        PyList_SetItem(res, i, centroid);
-        free(clusters[i].centroid);
-    }
+    ensure_spectral_stage(model, EIGEN_STAGE);
+    Py_BEGIN_ALLOW_THREADS
+    spr = spectral_embedding(model -> jacobi_result, k, model -> n);
+    Py_END_ALLOW_THREADS
 
-    free(clusters);
-    free_matrix(data_points_mat, n);
+    res = PyTuple_New(2);
+    PyTuple_SetItem(res, 0, to_python_matrix_buffer(spr -> new_points, spr -> k, model -> n, false));
+    PyTuple_SetItem(res, 1, PyLong_FromSize_t(spr -> k));
 
+    free(spr);
     return res;
 }
 
+static PyGetSetDef spectral_model_getset[] = {
+    {"wam", spectral_model_get_wam, NULL, "The weighted adjacency matrix of the data points.", NULL},
+    {"degrees", spectral_model_get_degrees, NULL, "The degree of every data point, which is the diagonal of the "
+     "diagonal degree matrix.", NULL},
+    {"laplacian", spectral_model_get_laplacian, NULL, "The graph Laplacian of the data points.", NULL},
+    {NULL, NULL, NULL, NULL, NULL}
+};
+
+static PyMethodDef spectral_model_methods[] = {
+    {
+        .ml_name = "eigen",
+        .ml_meth = (PyCFunction) spectral_model_eigen,
+        .ml_flags = METH_VARARGS | METH_KEYWORDS,
+        .ml_doc = PyDoc_STR(
+            "eigen(k=None)\n"
+            "--\n"
+            "\n"
+            "Returns the k smallest eigenvalues of the graph Laplacian in ascending order, and their eigenvectors "
+            "as the rows of a k x n matrix, as a tuple (eigenvectors, eigenvalues).\n\n"
+            "Parameters\n"
+            "----------\n"
+            "k:\n"
+            "    The number of eigenpairs to return, or None for all of them."
+        )
+    },
+    {
+        .ml_name = "embed",
+        .ml_meth = (PyCFunction) spectral_model_embed,
+        .ml_flags = METH_VARARGS | METH_KEYWORDS,
+        .ml_doc = PyDoc_STR(
+            "embed(k=None)\n"
+            "--\n"
+            "\n"
+            "Returns the same (new_points, k) tuple spk returns for the data points, without recomputing the "
+            "eigendecomposition.\n\n"
+            "Parameters\n"
+            "----------\n"
+            "k:\n"
+            "    The number of clusters, or None to use the eigengap heuristic."
+        )
+    },
+    {NULL, NULL, 0, NULL}
+};
+
+static PyTypeObject SpectralModelType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "mykmeanssp.SpectralModel",
+    .tp_doc = PyDoc_STR(
+        "SpectralModel(data_points)\n"
+        "--\n"
+        "\n"
+        "The spectral clustering stages of the data points, each computed once when first used and then cached. "
+        "The wam, degrees and laplacian attributes are read-only buffers of the cached stages."
+    ),
+    .tp_basicsize = sizeof(SpectralModelObject),
+    .tp_itemsize = 0,
+    .tp_flags = Py_TPFLAGS_DEFAULT,
+    .tp_new = spectral_model_new,
+    .tp_dealloc = spectral_model_dealloc,
+    .tp_getset = spectral_model_getset,
+    .tp_methods = spectral_model_methods
+};
+
 static PyMethodDef spkmeans_methods[] = {
     {
         .ml_name = "wam",
@@ -261,9 +1421,9 @@ static PyMethodDef spkmeans_methods[] = {
     {
         .ml_name = "jacobi",
         .ml_meth = (PyCFunction) jacobi_wrapper,
-        .ml_flags = METH_VARARGS,
+        .ml_flags = METH_VARARGS | METH_KEYWORDS,
         .ml_doc = PyDoc_STR(
-            "jacobi(matrix)\n"
+            "jacobi(matrix, columns=False)\n"
             "--\n"
             "Receive a symmetric matrix and run the Jacobi algorithm to return the eigenvectors and eigenvalues of the matrix."
             "Notice that the JacobiResult holds the eigenvectors, and mathematically, Jacobi returns a matrix that its "
@@ -275,7 +1435,36 @@ static PyMethodDef spkmeans_methods[] = {
             "Parameters\n"
             "----------\n"
             "Matrix:\n"
-            "    The matrix to calculate the eigenvalues and eigenvectors of."
+            "    The matrix to calculate the eigenvalues and eigenvectors of.\n"
+            "columns:\n"
+            "    If True, the returned eigenvectors buffer is the transpose, with the eigenvectors as its columns. "
+            "Both orientations share the same memory, so neither is a copy."
+        )
+    },
+    {
+        .ml_name = "jacobi_batched",
+        .ml_meth = (PyCFunction) jacobi_batched_wrapper,
+        .ml_flags = METH_VARARGS | METH_KEYWORDS,
+        .ml_doc = PyDoc_STR(
+            "jacobi_batched(matrices, columns=False, threads=0)\n"
+            "--\n"
+            "\n"
+            "Receive many small symmetric matrices of the same order and return the eigenvectors and eigenvalues of "
+            "each, like jacobi does for one matrix. The matrices are processed in interleaved groups, where every "
+            "rotation of the cyclic Jacobi method is applied to all matrices of a group at once. Returns a tuple "
+            "of a B x n x n buffer of the eigenvectors of every matrix (as rows, like in jacobi), a B x n buffer "
+            "of the eigenvalues, a buffer telling whether every matrix converged, and a buffer of the number of "
+            "sweeps every matrix took.\n\n"
+            "Parameters\n"
+            "----------\n"
+            "matrices:\n"
+            "    A C-contiguous B x n x n buffer of float64 items, read without copying, or a list of B square "
+            "matrices of order n.\n"
+            "columns:\n"
+            "    If True, the returned eigenvectors are the transpose of every matrix, with the eigenvectors as "
+            "its columns, without copying.\n"
+            "threads:\n"
+            "    The number of threads to run the groups of matrices on, or 0 for one per online processor."
         )
     },
     {
@@ -283,7 +1472,9 @@ static PyMethodDef spkmeans_methods[] = {
         .ml_meth = (PyCFunction) spk_wrapper,
         .ml_flags = METH_VARARGS | METH_KEYWORDS,
         .ml_doc = PyDoc_STR(
-            "spk(data_points, k=None)\n"
+            "spk(data_points, k=None, graph=\"dense\", neighbors=10, radius=3.0, eigensolver=\"auto\", "
+            "engine=\"graph\", landmarks=100, sampling=\"uniform\", nearest_landmarks=5, "
+            "features=500)\n"
             "--\n"
             "Receives datapoints and k and runs the spectral clustering algorithm on them.\n"
             "The return value of the function is the new points which will be the input of the k-means++ algorithm.\n"
@@ -292,19 +1483,238 @@ static PyMethodDef spkmeans_methods[] = {
             "Parameters\n"
             "----------\n"
             "datapoints:\n"
-            "    The datapoints to calculate spectral clustering on."
+            "    The datapoints to calculate spectral clustering on.\n"
+            "graph:\n"
+            "    The affinity graph, \"dense\" to connect every two datapoints, \"knn\" to connect every "
+            "datapoint to its nearest neighbors only, which builds a sparse graph Laplacian, \"hnsw\" to connect "
+            "every datapoint to its approximately nearest neighbors, found with a HNSW index, or \"radius\" to "
+            "connect every two datapoints within the radius of each other.\n"
+            "neighbors:\n"
+            "    The number of nearest neighbors of every datapoint in the \"knn\" and \"hnsw\" graphs.\n"
+            "radius:\n"
+            "    The distance up to which datapoints are connected in the \"radius\" graph.\n"
+            "eigensolver:\n"
+            "    How the eigenvectors of a sparse graph Laplacian are found, \"jacobi\" to decompose it densely, "
+            "\"lanczos\" to find only the first ones with the Lanczos method, from its products with vectors, "
+            "or \"auto\" to use the Lanczos method from 1000 datapoints on. If k is None, the eigengap heuristic "
+            "of the Lanczos method only looks at the first 32 eigenvalues. The \"dense\" graph is always "
+            "decomposed densely.\n"
+            "engine:\n"
+            "    \"graph\" to embed the datapoints with the eigenvectors of the graph Laplacian of the affinity "
+            "graph, or \"nystrom\" to approximate them from the affinities of all the datapoints to a sample of "
+            "landmarks only, in O(n * landmarks * (m + landmarks) + landmarks^3) time. The Nystrom engine ignores "
+            "the graph options, and finds the eigenvectors of the random-walk Laplacian of the dense graph with a "
+            "self loop at every datapoint. \"lsc\" chooses the landmarks with K-means instead, codes every datapoint "
+            "by the gaussian affinities to its nearest landmarks, and embeds the datapoints with the left singular "
+            "vectors of the normalized codes, in O(n * landmarks * m) time for the landmarks and linear time in n "
+            "for the rest. It also ignores the graph options. \"rff\" approximates the affinities of the dense graph "
+            "with random Fourier features instead, and finds the eigenvectors of its graph Laplacian with the "
+            "Lanczos method through products that take O(n * features) time, never forming the n x n matrices.\n"
+            "landmarks:\n"
+            "    The number of landmarks of the \"nystrom\" and \"lsc\" engines, at least k, which trades their "
+            "speed for their accuracy.\n"
+            "sampling:\n"
+            "    How the landmarks of the \"nystrom\" engine are sampled, \"uniform\" or \"kmeans++\".\n"
+            "nearest_landmarks:\n"
+            "    The number of nearest landmarks every datapoint is coded by in the \"lsc\" engine.\n"
+            "features:\n"
+            "    The number of random Fourier features of the \"rff\" engine, which trades its speed for its "
+            "accuracy. They are drawn with a seed of 0."
+        )
+    },
+    {
+        .ml_name = "knn_wam",
+        .ml_meth = (PyCFunction) knn_wam_wrapper,
+        .ml_flags = METH_VARARGS | METH_KEYWORDS,
+        .ml_doc = PyDoc_STR(
+            "knn_wam(data_points, neighbors=10, threads=0)\n"
+            "--\n"
+            "\n"
+            "Calculate the weighted adjacency matrix of the symmetric k-nearest-neighbors graph of the datapoints, "
+            "with the weights of wam between every datapoint and its neighbors, and 0 elsewhere. The neighbors are "
+            "found with a KD-tree. Returns the sparse matrix in CSR form, as a tuple of buffers of the row starts "
+            "(indptr), the column indices and the values.\n\n"
+            "Parameters\n"
+            "----------\n"
+            "data_points:\n"
+            "    The datapoints to calculate the matrix of.\n"
+            "neighbors:\n"
+            "    The number of nearest neighbors of every datapoint. Two datapoints are connected if either is a "
+            "neighbor of the other.\n"
+            "threads:\n"
+            "    The number of threads to find the neighbors on, or 0 for one per online processor."
+        )
+    },
+    {
+        .ml_name = "hnsw_wam",
+        .ml_meth = (PyCFunction) hnsw_wam_wrapper,
+        .ml_flags = METH_VARARGS | METH_KEYWORDS,
+        .ml_doc = PyDoc_STR(
+            "hnsw_wam(data_points, neighbors=10, M=16, ef_construction=200, ef_search=50, seed=0, threads=0, "
+            "recall_sample=0)\n"
+            "--\n"
+            "\n"
+            "Calculate the weighted adjacency matrix of the symmetric k-nearest-neighbors graph of the datapoints like "
+            "knn_wam, with the neighbors found approximately by a HNSW (hierarchical navigable small world) index, "
+            "which stays fast in high dimensions where a KD-tree doesn't. Returns a tuple of the buffers of the "
+            "sparse matrix in CSR form, as in knn_wam, and the recall of the index, or None if recall_sample is 0.\n\n"
+            "Parameters\n"
+            "----------\n"
+            "data_points:\n"
+            "    The datapoints to calculate the matrix of.\n"
+            "neighbors:\n"
+            "    The number of nearest neighbors of every datapoint.\n"
+            "M:\n"
+            "    The maximal number of links of a datapoint in every layer of the index, and twice that in its base "
+            "layer. Larger values raise the recall and the memory and time the index takes.\n"
+            "ef_construction:\n"
+            "    The number of candidates searched when inserting a datapoint into the index.\n"
+            "ef_search:\n"
+            "    The number of candidates searched when finding the neighbors of a datapoint, at least neighbors + 1.\n"
+            "seed:\n"
+            "    The seed of the random layers of the datapoints and of the recall sample.\n"
+            "threads:\n"
+            "    The number of threads to build the index and find the neighbors on, or 0 for one per online "
+            "processor. The datapoints are inserted concurrently, so the graph depends on the number of threads.\n"
+            "recall_sample:\n"
+            "    If positive, the number of random datapoints whose exact neighbors are found by brute force, to "
+            "report the fraction of them the index finds."
+        )
+    },
+    {
+        .ml_name = "radius_wam",
+        .ml_meth = (PyCFunction) radius_wam_wrapper,
+        .ml_flags = METH_VARARGS | METH_KEYWORDS,
+        .ml_doc = PyDoc_STR(
+            "radius_wam(data_points, radius=3.0, threads=0)\n"
+            "--\n"
+            "\n"
+            "Calculate the weighted adjacency matrix of the radius graph of the datapoints, with the weights of wam "
+            "between every two datapoints within the radius of each other, and 0 elsewhere. The datapoints are "
+            "hashed into a uniform grid of cells of the radius over their first 3 coordinates, so only datapoints "
+            "of adjacent cells are compared, and the weights of farther ones are never computed. Returns a tuple of "
+            "the buffers of the sparse matrix in CSR form, as in knn_wam, followed by an upper bound on the sum of "
+            "the dropped weights, and an upper bound on the spectral norm of the error it makes in the graph "
+            "Laplacian, which bounds the error of every eigenvalue too.\n\n"
+            "Parameters\n"
+            "----------\n"
+            "data_points:\n"
+            "    The datapoints to calculate the matrix of.\n"
+            "radius:\n"
+            "    The distance up to which datapoints are connected.\n"
+            "threads:\n"
+            "    The number of threads to find the neighbors on, or 0 for one per online processor."
+        )
+    },
+    {
+        .ml_name = "spk_batch",
+        .ml_meth = (PyCFunction) spk_batch_wrapper,
+        .ml_flags = METH_VARARGS | METH_KEYWORDS,
+        .ml_doc = PyDoc_STR(
+            "spk_batch(datasets, k=None, threads=0)\n"
+            "--\n"
+            "\n"
+            "Runs spk on every dataset of a sequence, concurrently on a pool of threads, and returns the list of "
+            "their results in order. A dataset that fails, e.g. since it isn't a matrix or has less than k data "
+            "points, gets the exception instance it raised in place of its result, and the other datasets aren't "
+            "affected.\n\n"
+            "Parameters\n"
+            "----------\n"
+            "datasets:\n"
+            "    The sequence of datasets to calculate spectral clustering on.\n"
+            "k:\n"
+            "    The k value of all datasets, or None to use the eigengap heuristic on each of them.\n"
+            "threads:\n"
+            "    The number of threads to run the datasets on, or 0 for one per online processor."
+        )
+    },
+    {
+        .ml_name = "jacobi_batch",
+        .ml_meth = (PyCFunction) jacobi_batch_wrapper,
+        .ml_flags = METH_VARARGS | METH_KEYWORDS,
+        .ml_doc = PyDoc_STR(
+            "jacobi_batch(matrices, columns=False, threads=0)\n"
+            "--\n"
+            "\n"
+            "Runs jacobi on every matrix of a sequence, concurrently on a pool of threads, and returns the list of "
+            "their results in order. A matrix that fails, e.g. since it isn't square, gets the exception instance "
+            "it raised in place of its result, and the other matrices aren't affected.\n\n"
+            "Parameters\n"
+            "----------\n"
+            "matrices:\n"
+            "    The sequence of symmetric matrices to calculate the eigenvalues and eigenvectors of.\n"
+            "columns:\n"
+            "    As in jacobi.\n"
+            "threads:\n"
+            "    The number of threads to run the matrices on, or 0 for one per online processor."
+        )
+    },
+    {
+        .ml_name = "kmeanspp_init",
+        .ml_meth = (PyCFunction) kmeanspp_init_wrapper,
+        .ml_flags = METH_VARARGS | METH_KEYWORDS,
+        .ml_doc = PyDoc_STR(
+            "kmeanspp_init(points, k, seed=0, numpy_compatible=False)\n"
+            "--\n"
+            "\n"
+            "Chooses k initial centroids out of the points using the K-means++ algorithm, and returns their indices.\n"
+            "By default, points are sampled proportionally to their squared distance from the closest chosen "
+            "centroid. With numpy_compatible=True, they are sampled proportionally to the distance itself, "
+            "reproducing the choices np.random.choice makes after np.random.seed(seed).\n\n"
+            "Parameters\n"
+            "----------\n"
+            "points:\n"
+            "    The list of vectors to choose the centroids from.\n"
+            "k:\n"
+            "    The number of centroids to choose.\n"
+            "seed:\n"
+            "    The seed of the random generator.\n"
+            "numpy_compatible:\n"
+            "    Whether to reproduce the choices of the NumPy based implementation."
+        )
+    },
+    {
+        .ml_name = "kmeans_parallel_init",
+        .ml_meth = (PyCFunction) kmeans_parallel_init_wrapper,
+        .ml_flags = METH_VARARGS | METH_KEYWORDS,
+        .ml_doc = PyDoc_STR(
+            "kmeans_parallel_init(points, k, seed=0, rounds=0, oversampling_factor=0.0, threads=0)\n"
+            "--\n"
+            "\n"
+            "Chooses k initial centroids out of the points using the K-means|| (scalable K-means++) algorithm, "
+            "and returns their indices.\n"
+            "Each round samples about oversampling_factor candidates in a single pass over the points, and the "
+            "weighted candidates are then reclustered down to k with K-means++.\n\n"
+            "Parameters\n"
+            "----------\n"
+            "points:\n"
+            "    The list of vectors to choose the centroids from.\n"
+            "k:\n"
+            "    The number of centroids to choose.\n"
+            "seed:\n"
+            "    The seed of the random generator.\n"
+            "rounds:\n"
+            "    The number of oversampling rounds, or 0 for ceil(ln(n)).\n"
+            "oversampling_factor:\n"
+            "    The expected number of candidates sampled per round, or 0 for 2 * k.\n"
+            "threads:\n"
+            "    The number of threads to pass over the points on, or 0 for one per online processor. The "
+            "chosen centroids don't depend on it."
         )
     },
     {
         .ml_name = "fit",
         .ml_meth = (PyCFunction) kmeans_fit_wrapper,
-        .ml_flags = METH_VARARGS,
+        .ml_flags = METH_VARARGS | METH_KEYWORDS,
         .ml_doc = PyDoc_STR(
-            "fit(centroids_lst, vectors_lst, k, iter=300, epsilon=0.001)\n"
+            "fit(centroids_lst, vectors_lst, k, iter=300, epsilon=0.001, algorithm=\"lloyd\", batch_size=0, seed=0, "
+            "threads=0)\n"
             "--\n"
             "\n"
             "Fits the Kmeans model. The centroids and vectors are represented as a list vectors, "
-            "each represented as a list of floats.\n\n"
+            "each represented as a list of floats. Returns a KmeansResult of the final centroids, a buffer of "
+            "the cluster index of every vector (np.asarray wraps it without copying), the cluster sizes, the "
+            "inertia, the number of iterations run and whether they converged.\n\n"
             "Parameters\n"
             "----------\n"
             "centroids_lst:\n"
@@ -316,7 +1726,108 @@ static PyMethodDef spkmeans_methods[] = {
             "iter:\n"
             "    The number of iterations of the algorithm to run.\n"
             "epsilon:\n"
-            "    Epsilon value used for convergence."
+            "    Epsilon value used for convergence.\n"
+            "algorithm:\n"
+            "    The engine running the iterations, one of \"lloyd\", \"elkan\", \"hamerly\", \"yinyang\" or "
+            "\"auto\". All engines but Lloyd's skip distance computations using the triangle inequality, and "
+            "give the same clusters. \"auto\" picks Hamerly's algorithm for small k, and Yinyang otherwise.\n"
+            "batch_size:\n"
+            "    If positive, run mini-batch K-means instead, where every iteration updates the centroids from "
+            "batch_size randomly sampled vectors, with a per-centroid learning rate.\n"
+            "seed:\n"
+            "    The seed of the random generator sampling the mini-batches.\n"
+            "threads:\n"
+            "    The number of threads the iterations run on, or 0 for one per online processor. The clusters "
+            "don't depend on the number of threads."
+        )
+    },
+    {
+        .ml_name = "fit_multi",
+        .ml_meth = (PyCFunction) kmeans_fit_multi_wrapper,
+        .ml_flags = METH_VARARGS | METH_KEYWORDS,
+        .ml_doc = PyDoc_STR(
+            "fit_multi(points, k, restarts=10, iter=300, epsilon=0.0, algorithm=\"auto\", seed=0, "
+            "numpy_compatible=False, threads=0)\n"
+            "--\n"
+            "\n"
+            "Runs restarts independent K-means++ seedings and fits concurrently, and keeps the one with the "
+            "lowest inertia (the sum of squared distances of the points from their closest centroid). "
+            "Returns a tuple of the kept centroids, the indices of the points its seeding chose, and the "
+            "inertia of every restart.\n\n"
+            "Parameters\n"
+            "----------\n"
+            "points:\n"
+            "    The list of points to partition to different clusters.\n"
+            "k:\n"
+            "    The number of clusters to partition.\n"
+            "restarts:\n"
+            "    The number of seedings and fits to run.\n"
+            "iter:\n"
+            "    The number of iterations of every fit.\n"
+            "epsilon:\n"
+            "    Epsilon value used for convergence.\n"
+            "algorithm:\n"
+            "    The engine running the iterations, as in fit.\n"
+            "seed:\n"
+            "    The seed of the first restart. Restart r is seeded with seed + r.\n"
+            "numpy_compatible:\n"
+            "    Whether the seedings are done like in kmeanspp_init with numpy_compatible=True.\n"
+            "threads:\n"
+            "    The number of threads to run the restarts on, or 0 for one per online processor."
+        )
+    },
+    {
+        .ml_name = "spkmeans",
+        .ml_meth = (PyCFunction) spkmeans_wrapper,
+        .ml_flags = METH_VARARGS | METH_KEYWORDS,
+        .ml_doc = PyDoc_STR(
+            "spkmeans(data_points, k=None, seed=0, iter=300, epsilon=0.0, algorithm=\"auto\", batch_size=0, "
+            "threads=0, graph=\"dense\", neighbors=10, radius=3.0, eigensolver=\"auto\", engine=\"graph\", "
+            "landmarks=100, sampling=\"uniform\", nearest_landmarks=5, "
+            "features=500)\n"
+            "--\n"
+            "\n"
+            "Runs the full spectral clustering of the data points: the spectral embedding, the K-means++ seeding "
+            "(as in kmeanspp_init with numpy_compatible=True) and fit, all in one call, so the embedded points "
+            "never leave native memory. Returns a SpkmeansResult of the labels, the centroids, k, the indices "
+            "of the initial centroids, the inertia, the number of iterations run and whether they converged.\n\n"
+            "Parameters\n"
+            "----------\n"
+            "data_points:\n"
+            "    The data points to cluster.\n"
+            "k:\n"
+            "    The number of clusters, or None to choose it with the eigengap heuristic.\n"
+            "seed:\n"
+            "    The seed of the K-means++ seeding, of the mini-batches sampling, of the landmarks sampling or "
+            "seeding and of the random Fourier features.\n"
+            "iter:\n"
+            "    The number of iterations of the fit.\n"
+            "epsilon:\n"
+            "    Epsilon value used for convergence.\n"
+            "algorithm:\n"
+            "    The engine running the iterations, as in fit.\n"
+            "batch_size:\n"
+            "    If positive, run mini-batch K-means instead, as in fit.\n"
+            "threads:\n"
+            "    The number of threads the iterations run on, or 0 for one per online processor.\n"
+            "graph:\n"
+            "    The affinity graph, as in spk.\n"
+            "neighbors:\n"
+            "    The number of nearest neighbors of every datapoint in the \"knn\" and \"hnsw\" graphs.\n"
+            "radius:\n"
+            "    The distance up to which datapoints are connected in the \"radius\" graph.\n"
+            "eigensolver:\n"
+            "    How the eigenvectors of the graph Laplacian are found, as in spk.\n"
+            "engine:\n"
+            "    The engine of the spectral embedding, as in spk.\n"
+            "landmarks:\n"
+            "    The number of landmarks of the \"nystrom\" and \"lsc\" engines.\n"
+            "sampling:\n"
+            "    How the landmarks are sampled, as in spk, with the seed of the K-means++ seeding.\n"
+            "nearest_landmarks:\n"
+            "    The number of nearest landmarks of every datapoint in the \"lsc\" engine.\n"
+            "features:\n"
+            "    The number of random Fourier features of the \"rff\" engine, drawn with the seed."
         )
     },
     {NULL, NULL, 0, NULL}
@@ -325,7 +1836,15 @@ static PyMethodDef spkmeans_methods[] = {
 static struct PyModuleDef spkmeans_module = {
     PyModuleDef_HEAD_INIT,
     .m_name = "mykmeanssp",
-    .m_doc = NULL,
+    .m_doc = PyDoc_STR(
+        "The C implementation of spkmeans.\n\n"
+        "Every matrix argument may be a C-contiguous 2-dimensional buffer of float64 items, like a numpy array "
+        "or a memoryview, which is read without copying, or a list of equally long lists of floats. Matrices "
+        "and vectors are returned as Buffer objects owning the computed memory, which np.asarray wraps without "
+        "copying.\n"
+        "The computations run without holding the GIL, so calls from different threads run in parallel. "
+        "Buffer inputs are pinned, not copied, so they mustn't be written to while a call reads them."
+    ),
     .m_size = -1,
     .m_methods = spkmeans_methods
 };
@@ -338,6 +1857,21 @@ PyMODINIT_FUNC PyInit_mykmeanssp(void) {
         return NULL;
     }
 
+    if (PyType_Ready(&BufferType) < 0 || PyType_Ready(&SpectralModelType) < 0 ||
+        PyStructSequence_InitType2(&KmeansResultType, &kmeans_result_desc) < 0 ||
+        PyStructSequence_InitType2(&SpkmeansResultType, &spkmeans_result_desc) < 0) {
+        Py_DECREF(module);
+        return NULL;
+    }
+    Py_INCREF(&BufferType);
+    PyModule_AddObject(module, "Buffer", (PyObject *) &BufferType);
+    Py_INCREF(&KmeansResultType);
+    PyModule_AddObject(module, "KmeansResult", (PyObject *) &KmeansResultType);
+    Py_INCREF(&SpkmeansResultType);
+    PyModule_AddObject(module, "SpkmeansResult", (PyObject *) &SpkmeansResultType);
+    Py_INCREF(&SpectralModelType);
+    PyModule_AddObject(module, "SpectralModel", (PyObject *) &SpectralModelType);
+
     PyModule_AddIntConstant(module, "DEFAULT_ITERATIONS_COUNT", DEFAULT_ITERATIONS_COUNT);
     PyModule_AddObject(module, "DEFAULT_EPSILON", default_epsilon);
 
@@ -7,7 +7,7 @@ from typing import List, Optional
 import numpy as np
 
 import mykmeanssp
-from kmeanspp import kmeanspp
+from kmeanspp import SEED
 
 Vector = List[float]
 Matrix = List[Vector]
@@ -50,13 +50,8 @@ def handle_args() -> CommandLineArguments:
     sys.exit(DEFAULT_ERR_MSG)
 
 
-def read_matrix_from_file(file_path: Path) -> Matrix:
-    result = []
-    with open(file_path, "r") as fd:
-        for line in fd.readlines():
-            row = [float(x) for x in line.split(",")]
-            result.append(row)
-    return result
+def read_matrix_from_file(file_path: Path) -> np.ndarray:
+    return np.loadtxt(file_path, delimiter=",", ndmin=2)
 
 
 def print_matrix(matrix: Matrix) -> None:
@@ -84,18 +79,18 @@ def main():
     cmd_args = handle_args()
     input_matrix = read_matrix_from_file(cmd_args.file_path)
     if cmd_args.goal == Goal.JACOBI:
-        eigenvectors, eigenvalues = mykmeanssp.jacobi(input_matrix)
-        output = np.array(eigenvectors).T.tolist()
-        print_vector(eigenvalues)
+        eigenvectors, eigenvalues = mykmeanssp.jacobi(input_matrix, columns=True)
+        output = np.asarray(eigenvectors)
+        print_vector(np.asarray(eigenvalues))
     elif cmd_args.goal == Goal.SPK:
         try:
-            new_points, k = mykmeanssp.spk(input_matrix, cmd_args.k)
+            result = mykmeanssp.spkmeans(input_matrix, cmd_args.k, seed=SEED)
         except Exception:
             sys.exit(DEFAULT_ERR_MSG)
-        output, centroids_idxs = kmeanspp(np.array(new_points).T, k)
-        print_int_list(centroids_idxs)
+        output = np.asarray(result.centroids)
+        print_int_list(result.centroids_idxs)
     else:
-        output = goal_map[cmd_args.goal](input_matrix)
+        output = np.asarray(goal_map[cmd_args.goal](input_matrix))
     print_matrix(output)
 
 
@@ -1,5 +1,12 @@
+#include <math.h>
+#include <string.h>
+#include "csr.h"
+#include "kmeans.h"
+#include "lanczos.h"
 #include "munit.h"
+#include "rng.h"
 #include "strutils.h"
+#include "vector.h"
 
 static MunitResult test_strcount(const MunitParameter params[], void* data) {
     char* example_string = "The way to get started is to quit talking and begin doing. -Walt Disney";
@@ -15,6 +22,213 @@ static MunitResult test_strcount(const MunitParameter params[], void* data) {
     return MUNIT_OK;
 }
 
+static MunitResult test_random_state_matches_numpy(const MunitParameter params[], void* data) {
+    RandomState rs;
+
+    (void) params;
+    (void) data;
+
+    // Expected values were drawn after np.random.seed(0)
+    seed_random_state(&rs, 0);
+    munit_assert_uint32(random_uint32(&rs), ==, 2357136044U);
+    munit_assert_uint32(random_uint32(&rs), ==, 2546248239U);
+
+    seed_random_state(&rs, 0);
+    munit_assert_size(random_index(&rs, 1000), ==, 684);
+    munit_assert_size(random_index(&rs, 1000), ==, 559);
+    munit_assert_size(random_index(&rs, 1000), ==, 629);
+    munit_assert_double_equal(random_double(&rs), 0.8442657485810173, 15);
+
+    // The second draw of a pair outlives the uniform draws between them
+    seed_random_state(&rs, 0);
+    munit_assert_double_equal(random_gaussian(&rs), 1.764052345967664, 14);
+    munit_assert_double_equal(random_gaussian(&rs), 0.4001572083672233, 14);
+    munit_assert_double_equal(random_gaussian(&rs), 0.9787379841057392, 14);
+    munit_assert_double_equal(random_double(&rs), 0.4236547993389047, 15);
+    munit_assert_double_equal(random_gaussian(&rs), 2.240893199201458, 14);
+
+    return MUNIT_OK;
+}
+
+static MunitResult test_fit_two_clusters(const MunitParameter params[], void* data) {
+    double raw_vectors[6][2] = {{0.0, 0.0}, {1.0, 0.0}, {0.0, 1.0},
+                                {10.0, 10.0}, {11.0, 10.0}, {10.0, 11.0}};
+    double first_centroid[2] = {0.0, 0.0};
+    double second_centroid[2] = {1.0, 0.0};
+    Vector vectors[6];
+    Cluster clusters[2];
+    size_t i;
+
+    (void) params;
+    (void) data;
+
+    for (i = 0; i < 6; i++) {
+        vectors[i] = raw_vectors[i];
+    }
+    clusters[0].centroid = first_centroid;
+    clusters[1].centroid = second_centroid;
+
+    fit(clusters, vectors, 6, 2, 2, DEFAULT_ITERATIONS_COUNT, 0.001);
+
+    munit_assert_double_equal(first_centroid[0], 1.0 / 3, 9);
+    munit_assert_double_equal(first_centroid[1], 1.0 / 3, 9);
+    munit_assert_double_equal(second_centroid[0], 31.0 / 3, 9);
+    munit_assert_double_equal(second_centroid[1], 31.0 / 3, 9);
+
+    return MUNIT_OK;
+}
+
+static MunitResult test_fit_bounded_engines_match_lloyd(const MunitParameter params[], void* data) {
+    KmeansAlgorithm algorithms[] = {ELKAN, HAMERLY, YINYANG};
+    size_t n = 500, d = 3, k = 24, i, j, a;
+    double *raw_vectors = malloc(n * d * sizeof(double));
+    double *lloyd_centroids = malloc(k * d * sizeof(double));
+    double *other_centroids = malloc(k * d * sizeof(double));
+    Vector *vectors = malloc(n * sizeof(Vector));
+    Cluster *lloyd_clusters = malloc(k * sizeof(Cluster));
+    Cluster *other_clusters = malloc(k * sizeof(Cluster));
+    double *initial_centroids = malloc(k * d * sizeof(double));
+    KmeansOptions options;
+    KmeansResult lloyd_result, other_result;
+    RandomState rs;
+
+    (void) params;
+    (void) data;
+
+    seed_random_state(&rs, 42);
+    for (i = 0; i < n; i++) {
+        vectors[i] = raw_vectors + i * d;
+        for (j = 0; j < d; j++) {
+            vectors[i][j] = random_double(&rs) + (double) (i % 6) * 3.0;
+        }
+    }
+    for (i = 0; i < k; i++) {
+        lloyd_clusters[i].centroid = lloyd_centroids + i * d;
+        other_clusters[i].centroid = other_centroids + i * d;
+        for (j = 0; j < d; j++) {
+            initial_centroids[i * d + j] = vectors[i * 7][j];
+        }
+    }
+
+    init_kmeans_options(&options);
+    memcpy(lloyd_centroids, initial_centroids, k * d * sizeof(double));
+    fit_with_options(lloyd_clusters, vectors, n, d, k, &options, &lloyd_result);
+    munit_assert_size(lloyd_result.statistics.skipped_distance_computations, ==, 0);
+    munit_assert_size(lloyd_result.iterations, ==, options.iter);
+
+    for (a = 0; a < sizeof(algorithms) / sizeof(algorithms[0]); a++) {
+        options.algorithm = algorithms[a];
+        memcpy(other_centroids, initial_centroids, k * d * sizeof(double));
+        fit_with_options(other_clusters, vectors, n, d, k, &options, &other_result);
+
+        munit_assert_memory_equal(k * d * sizeof(double), lloyd_centroids, other_centroids);
+        munit_assert_memory_equal(n * sizeof(size_t), lloyd_result.labels, other_result.labels);
+        munit_assert_memory_equal(k * sizeof(size_t), lloyd_result.cluster_sizes,
+                                  other_result.cluster_sizes);
+        munit_assert_double(lloyd_result.inertia, ==, other_result.inertia);
+        munit_assert_size(lloyd_result.iterations, ==, other_result.iterations);
+        munit_assert_size(other_result.statistics.distance_computations +
+                          other_result.statistics.skipped_distance_computations, ==,
+                          lloyd_result.statistics.distance_computations);
+        munit_assert_size(other_result.statistics.skipped_distance_computations, >,
+                          other_result.statistics.distance_computations);
+        free_kmeans_result(&other_result);
+    }
+
+    free_kmeans_result(&lloyd_result);
+
+    free(raw_vectors);
+    free(lloyd_centroids);
+    free(other_centroids);
+    free(vectors);
+    free(lloyd_clusters);
+    free(other_clusters);
+    free(initial_centroids);
+    return MUNIT_OK;
+}
+
+static MunitResult test_vector_kernels_match_generic(const MunitParameter params[], void* data) {
+    double p[MAX_UNROLLED_SIZE + 3], q[MAX_UNROLLED_SIZE + 3];
+    double sum[MAX_UNROLLED_SIZE + 3], weight;
+    Vector points[1];
+    const VectorKernels *kernels;
+    size_t m, i;
+
+    (void) params;
+    (void) data;
+
+    for (i = 0; i < MAX_UNROLLED_SIZE + 3; i++) {
+        p[i] = munit_rand_double() * 10 - 5;
+        q[i] = munit_rand_double() * 10 - 5;
+    }
+    points[0] = q;
+
+    // Every order gets kernels, and they give bit-identical results to the generic functions
+    for (m = 1; m <= MAX_UNROLLED_SIZE + 2; m++) {
+        kernels = vector_kernels(m);
+        munit_assert_double(kernels -> squared_distance(p, q, m), ==, squared_euclidean_distance(p, q, m));
+
+        kernels -> gaussian_weights(p, points, 1, &weight, m);
+        munit_assert_double(weight, ==, exp(-squared_euclidean_distance(p, q, m) / 2));
+
+        memcpy(sum, p, sizeof(sum));
+        kernels -> add_vector(sum, q, m);
+        for (i = 0; i < MAX_UNROLLED_SIZE + 3; i++) {
+            munit_assert_double(sum[i], ==, (i < m) ? p[i] + q[i] : p[i]);
+        }
+    }
+    munit_assert_ptr_equal(vector_kernels(MAX_UNROLLED_SIZE + 1), vector_kernels(MAX_UNROLLED_SIZE + 2));
+
+    return MUNIT_OK;
+}
+
+static void multiply_csr_matrix(void *context, const double *x, Vector y) {
+    csr_multiply_vector((const CsrMatrix *) context, x, y, 2);
+}
+
+static MunitResult test_lanczos_finds_repeated_eigenvalues(const MunitParameter params[], void* data) {
+    size_t i, j, nonzeros_count = 0, n = 200, path_length = 100;
+    double expected[] = {0.0, 0.0, 2 - 2 * cos(acos(-1.0) / 100)};
+    CsrMatrix *l = build_csr_matrix(n, n, 3 * n);
+    Vector product = (Vector) malloc(n * sizeof(double));
+    LanczosOptions options;
+    LanczosResult *result = NULL;
+
+    (void) params;
+    (void) data;
+
+    // The Laplacian of two paths, whose smallest eigenvalue is 0 twice
+    for (i = 0; i < n; i++) {
+        if (i % path_length > 0) {
+            l -> columns[nonzeros_count] = i - 1;
+            l -> values[nonzeros_count++] = -1.0;
+        }
+        l -> columns[nonzeros_count] = i;
+        l -> values[nonzeros_count++] = (i % path_length == 0 || i % path_length == path_length - 1) ? 1.0 : 2.0;
+        if (i % path_length < path_length - 1) {
+            l -> columns[nonzeros_count] = i + 1;
+            l -> values[nonzeros_count++] = -1.0;
+        }
+        l -> row_starts[i + 1] = nonzeros_count;
+    }
+
+    init_lanczos_options(&options);
+    result = lanczos(multiply_csr_matrix, l, n, 3, &options);
+    munit_assert_true(result -> converged);
+    for (i = 0; i < 3; i++) {
+        munit_assert_double_equal(result -> eigenvalues[i], expected[i], 8);
+        multiply_csr_matrix(l, result -> eigenvectors[i], product);
+        for (j = 0; j < n; j++) {
+            munit_assert_double_equal(product[j], result -> eigenvalues[i] * result -> eigenvectors[i][j], 6);
+        }
+    }
+
+    free_lanczos_result(result);
+    free(product);
+    free_csr_matrix(l);
+    return MUNIT_OK;
+}
+
 static MunitTest test_suite_tests[] = {
     {
         .name = (char*) "/strutils/test_strcount",
@@ -24,6 +238,46 @@ static MunitTest test_suite_tests[] = {
         .options = MUNIT_TEST_OPTION_NONE,
         .parameters = NULL
     },
+    {
+        .name = (char*) "/rng/test_random_state_matches_numpy",
+        .test = test_random_state_matches_numpy,
+        .setup = NULL,
+        .tear_down = NULL,
+        .options = MUNIT_TEST_OPTION_NONE,
+        .parameters = NULL
+    },
+    {
+        .name = (char*) "/kmeans/test_fit_two_clusters",
+        .test = test_fit_two_clusters,
+        .setup = NULL,
+        .tear_down = NULL,
+        .options = MUNIT_TEST_OPTION_NONE,
+        .parameters = NULL
+    },
+    {
+        .name = (char*) "/kmeans/test_fit_bounded_engines_match_lloyd",
+        .test = test_fit_bounded_engines_match_lloyd,
+        .setup = NULL,
+        .tear_down = NULL,
+        .options = MUNIT_TEST_OPTION_NONE,
+        .parameters = NULL
+    },
+    {
+        .name = (char*) "/vector/test_vector_kernels_match_generic",
+        .test = test_vector_kernels_match_generic,
+        .setup = NULL,
+        .tear_down = NULL,
+        .options = MUNIT_TEST_OPTION_NONE,
+        .parameters = NULL
+    },
+    {
+        .name = (char*) "/lanczos/test_lanczos_finds_repeated_eigenvalues",
+        .test = test_lanczos_finds_repeated_eigenvalues,
+        .setup = NULL,
+        .tear_down = NULL,
+        .options = MUNIT_TEST_OPTION_NONE,
+        .parameters = NULL
+    },
     { NULL, NULL, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL }
 };
 
@@ -82,3 +82,539 @@ def test_jacobi(inputs_folder: str, output_folder: str):
             np.array(our_eigenvectors).T, other_eigenvectors, decimal=4
         )
         np.testing.assert_almost_equal(our_eigenvalues, other_eigenvalues, decimal=4)
+
+
+def as_arrays(result) -> List[np.ndarray]:
+    results = result if isinstance(result, tuple) else (result,)
+    return [np.asarray(x) for x in results]
+
+
+@pytest.mark.parametrize("goal", ["wam", "ddg", "gl", "jacobi", "spk"])
+def test_buffer_inputs_match_lists(goal: str):
+    suffix = "_j" if goal == "jacobi" else ""
+    for i in range(1, TESTS_COUNT + 1):
+        our_mat = read_matrix_from_file(
+            str(Path(__file__).parent.joinpath(f"testfiles/test{i}{suffix}.txt"))
+        )
+        array = np.array(our_mat)
+
+        function = getattr(mykmeanssp, goal)
+        expected = as_arrays(function(our_mat))
+        for data in (array, memoryview(array)):
+            for ours, other in zip(as_arrays(function(data)), expected):
+                np.testing.assert_array_equal(ours, other)
+
+
+def test_invalid_buffer_inputs():
+    array = np.arange(12.0).reshape(3, 4)
+    with pytest.raises(ValueError):
+        mykmeanssp.wam(array.T)
+    with pytest.raises(ValueError):
+        mykmeanssp.wam(array.astype(np.float32))
+    with pytest.raises(ValueError):
+        mykmeanssp.wam(array.ravel())
+    with pytest.raises(ValueError):
+        mykmeanssp.jacobi(array)
+    with pytest.raises(TypeError):
+        mykmeanssp.wam([[1.0, 2.0], [3.0]])
+
+
+def test_results_are_buffers():
+    our_mat = read_matrix_from_file(
+        str(Path(__file__).parent.joinpath("testfiles/test1_j.txt"))
+    )
+
+    eigenvectors, eigenvalues = mykmeanssp.jacobi(our_mat)
+    columns, _ = mykmeanssp.jacobi(our_mat, columns=True)
+    assert isinstance(eigenvectors, mykmeanssp.Buffer)
+    assert isinstance(eigenvalues, mykmeanssp.Buffer)
+    rows = np.asarray(eigenvectors)
+    assert rows.flags.c_contiguous
+    assert np.asarray(columns).flags.f_contiguous
+    np.testing.assert_array_equal(np.asarray(columns), rows.T)
+    np.testing.assert_allclose(
+        np.array(our_mat) @ rows.T, rows.T * np.asarray(eigenvalues), atol=1e-3
+    )
+    assert not memoryview(columns).c_contiguous
+    # The transposed layout is refused where row-major items are read
+    with pytest.raises(BufferError):
+        mykmeanssp.jacobi(columns)
+    np.testing.assert_array_equal(
+        np.asarray(mykmeanssp.jacobi(np.ascontiguousarray(columns))[1]),
+        np.asarray(mykmeanssp.jacobi(np.asarray(columns).tolist())[1]),
+    )
+
+    wam = np.asarray(mykmeanssp.wam(np.array(our_mat)))
+    assert wam.shape == (len(our_mat), len(our_mat))
+    assert wam.base is not None
+
+
+def test_spectral_model_matches_functions():
+    for i in range(1, TESTS_COUNT + 1):
+        our_mat = np.array(
+            read_matrix_from_file(
+                str(Path(__file__).parent.joinpath(f"testfiles/test{i}.txt"))
+            )
+        )
+        model = mykmeanssp.SpectralModel(our_mat)
+
+        wam = np.asarray(model.wam)
+        assert not wam.flags.writeable
+        np.testing.assert_array_equal(wam, np.asarray(mykmeanssp.wam(our_mat)))
+        np.testing.assert_array_equal(
+            np.asarray(model.degrees), np.diag(np.asarray(mykmeanssp.ddg(our_mat)))
+        )
+        np.testing.assert_array_equal(
+            np.asarray(model.laplacian), np.asarray(mykmeanssp.gl(our_mat))
+        )
+
+        new_points, k = mykmeanssp.spk(our_mat)
+        model_points, model_k = model.embed()
+        assert model_k == k
+        np.testing.assert_array_equal(np.asarray(model_points), np.asarray(new_points))
+
+        eigenvectors, eigenvalues = model.eigen(k)
+        _, all_eigenvalues = mykmeanssp.jacobi(np.asarray(model.laplacian))
+        np.testing.assert_array_equal(
+            np.asarray(eigenvalues), np.sort(np.asarray(all_eigenvalues))[:k]
+        )
+        np.testing.assert_array_equal(np.asarray(eigenvectors), np.asarray(new_points))
+
+
+def test_spectral_model_caches_stages():
+    model = mykmeanssp.SpectralModel(np.arange(12.0).reshape(6, 2))
+    assert np.shares_memory(np.asarray(model.wam), np.asarray(model.wam))
+    assert np.asarray(model.laplacian).shape == (6, 6)
+    with pytest.raises(ValueError):
+        model.eigen(7)
+    with pytest.raises(ValueError):
+        model.embed(7)
+
+
+def test_spkmeans_matches_stages():
+    for i in range(1, TESTS_COUNT + 1):
+        our_mat = np.array(
+            read_matrix_from_file(
+                str(Path(__file__).parent.joinpath(f"testfiles/test{i}.txt"))
+            )
+        )
+        result = mykmeanssp.spkmeans(our_mat, seed=3)
+
+        new_points, k = mykmeanssp.spk(our_mat)
+        points = np.asarray(new_points).T.copy()
+        centroids, centroids_idxs, inertias = mykmeanssp.fit_multi(
+            points, k, 1, seed=3, numpy_compatible=True
+        )
+        assert result.k == k
+        assert result.centroids_idxs == centroids_idxs
+        np.testing.assert_array_equal(np.asarray(result.centroids), centroids)
+        assert result.inertia == inertias[0]
+
+        labels = np.asarray(result.labels)
+        assert labels.shape == (len(our_mat),)
+        distances = ((points[:, None, :] - np.asarray(centroids)) ** 2).sum(axis=2)
+        np.testing.assert_array_equal(labels, distances.argmin(axis=1))
+
+
+def test_spkmeans_invalid_k():
+    with pytest.raises(ValueError):
+        mykmeanssp.spkmeans(np.arange(12.0).reshape(6, 2), 7)
+
+
+@pytest.mark.parametrize("k", [-1, 7, 2**70])
+def test_spk_invalid_k(k: int):
+    points = np.arange(12.0).reshape(6, 2)
+    with pytest.raises((ValueError, OverflowError)):
+        mykmeanssp.spk(points, k)
+    with pytest.raises((ValueError, OverflowError)):
+        mykmeanssp.spkmeans(points, k)
+
+
+def test_batches_match_single_calls():
+    datasets = [
+        np.array(
+            read_matrix_from_file(
+                str(Path(__file__).parent.joinpath(f"testfiles/test{i}.txt"))
+            )
+        )
+        for i in range(1, TESTS_COUNT + 1)
+    ]
+    for threads in (1, 3):
+        for dataset, (new_points, k) in zip(
+            datasets, mykmeanssp.spk_batch(datasets, threads=threads)
+        ):
+            expected_points, expected_k = mykmeanssp.spk(dataset)
+            assert k == expected_k
+            np.testing.assert_array_equal(
+                np.asarray(new_points), np.asarray(expected_points)
+            )
+
+        laplacians = [np.asarray(mykmeanssp.gl(dataset)) for dataset in datasets]
+        results = mykmeanssp.jacobi_batch(laplacians, columns=True, threads=threads)
+        for laplacian, (eigenvectors, eigenvalues) in zip(laplacians, results):
+            expected_vectors, expected_values = mykmeanssp.jacobi(
+                laplacian, columns=True
+            )
+            np.testing.assert_array_equal(
+                np.asarray(eigenvectors), np.asarray(expected_vectors)
+            )
+            np.testing.assert_array_equal(
+                np.asarray(eigenvalues), np.asarray(expected_values)
+            )
+
+
+def test_batch_failures_are_isolated():
+    square = np.eye(3)
+    results = mykmeanssp.spk_batch([square, "oops", np.eye(2), [[1.0]] * 4], k=3)
+    assert len(results) == 4
+    assert np.asarray(results[0][0]).shape == (3, 3)
+    assert isinstance(results[1], TypeError)
+    assert isinstance(results[2], ValueError)
+    assert np.asarray(results[3][0]).shape == (3, 4)
+
+    symmetric = np.array([[2.0, 1.0], [1.0, 2.0]])
+    results = mykmeanssp.jacobi_batch([np.ones((2, 3)), symmetric, None])
+    assert isinstance(results[0], ValueError)
+    np.testing.assert_allclose(np.sort(np.asarray(results[1][1])), [1.0, 3.0])
+    assert isinstance(results[2], TypeError)
+    assert mykmeanssp.jacobi_batch([]) == []
+    with pytest.raises(TypeError):
+        mykmeanssp.spk_batch(5)
+
+
+def test_jacobi_batched():
+    rng = np.random.default_rng(0)
+    for n in (1, 4, 13, 32):
+        matrices = rng.normal(size=(11, n, n))
+        matrices = matrices + matrices.transpose(0, 2, 1)
+        eigenvectors, eigenvalues, converged, sweeps = mykmeanssp.jacobi_batched(
+            matrices, threads=2
+        )
+        eigenvectors, eigenvalues = np.asarray(eigenvectors), np.asarray(eigenvalues)
+        assert eigenvectors.shape == (11, n, n)
+        assert eigenvalues.shape == (11, n)
+        assert np.asarray(converged).all()
+        assert (np.asarray(sweeps) <= 20).all()
+        for matrix, vectors, values in zip(matrices, eigenvectors, eigenvalues):
+            np.testing.assert_allclose(
+                np.sort(values), np.linalg.eigvalsh(matrix), atol=1e-9
+            )
+            np.testing.assert_allclose(
+                matrix @ vectors.T, vectors.T * values, atol=1e-9
+            )
+
+        columns, *_ = mykmeanssp.jacobi_batched(list(matrices), columns=True)
+        np.testing.assert_array_equal(
+            np.asarray(columns), eigenvectors.transpose(0, 2, 1)
+        )
+        if n > 1:
+            with pytest.raises(BufferError):
+                mykmeanssp.jacobi_batched(columns)
+        np.testing.assert_array_equal(
+            np.asarray(mykmeanssp.jacobi_batched(np.ascontiguousarray(columns))[1]),
+            np.asarray(mykmeanssp.jacobi_batched(np.asarray(columns).tolist())[1]),
+        )
+
+
+def test_jacobi_batched_invalid_inputs():
+    with pytest.raises(ValueError):
+        mykmeanssp.jacobi_batched(np.ones((2, 3, 4)))
+    with pytest.raises(ValueError):
+        mykmeanssp.jacobi_batched([np.eye(2), np.eye(3)])
+    with pytest.raises(TypeError):
+        mykmeanssp.jacobi_batched([])
+
+
+def csr_to_dense(indptr, indices, values) -> np.ndarray:
+    indptr, indices = np.asarray(indptr), np.asarray(indices)
+    dense = np.zeros((len(indptr) - 1, len(indptr) - 1))
+    for i in range(len(indptr) - 1):
+        dense[i, indices[indptr[i] : indptr[i + 1]]] = values[indptr[i] : indptr[i + 1]]
+    return dense
+
+
+def four_blobs(spread: float = 1.0) -> np.ndarray:
+    rng = np.random.default_rng(0)
+    centers = 6 * np.vstack([np.zeros(3), np.eye(3)])
+    return np.concatenate(
+        [center + spread * rng.normal(size=(40, 3)) for center in centers]
+    )
+
+
+def test_knn_wam_matches_brute_force():
+    rng = np.random.default_rng(0)
+    for points in (
+        rng.normal(size=(500, 3)),
+        np.repeat(rng.normal(size=(40, 2)), 3, 0),
+    ):
+        for neighbors in (1, 7):
+            indptr, indices, values = mykmeanssp.knn_wam(points, neighbors, threads=2)
+            wam = csr_to_dense(indptr, indices, np.asarray(values))
+
+            squared_distances = ((points[:, None, :] - points) ** 2).sum(axis=2)
+            np.fill_diagonal(squared_distances, np.inf)
+            kth = np.sort(squared_distances, axis=1)[:, neighbors - 1]
+            near = squared_distances <= kth[:, None]
+            assert np.all(wam == wam.T)
+            assert np.all(wam.diagonal() == 0)
+            # Neighbors at a tie with the farthest one may be either of them
+            assert np.all((wam > 0) <= (near | near.T))
+            assert np.all((wam > 0).sum(axis=1) >= neighbors)
+            connected = wam > 0
+            np.testing.assert_allclose(
+                wam[connected], np.exp(-squared_distances[connected] / 2)
+            )
+
+
+def test_hnsw_wam_recall():
+    rng = np.random.default_rng(0)
+    points = rng.normal(size=(1000, 32))
+    neighbors = 10
+    indptr, indices, values, recall = mykmeanssp.hnsw_wam(
+        points, neighbors, threads=2, recall_sample=200
+    )
+    wam = csr_to_dense(indptr, indices, np.asarray(values))
+
+    squared_distances = ((points[:, None, :] - points) ** 2).sum(axis=2)
+    np.fill_diagonal(squared_distances, np.inf)
+    exact = np.argsort(squared_distances, axis=1)[:, :neighbors]
+    found = (wam[np.arange(len(points))[:, None], exact] > 0).mean()
+    assert recall > 0.9
+    assert found > 0.9
+    assert np.all(wam == wam.T)
+    assert np.all(wam.diagonal() == 0)
+    assert np.all((wam > 0).sum(axis=1) >= neighbors)
+    connected = wam > 0
+    np.testing.assert_allclose(
+        wam[connected], np.exp(-squared_distances[connected] / 2)
+    )
+
+    assert mykmeanssp.hnsw_wam(points[:50], neighbors)[3] is None
+    with pytest.raises(ValueError):
+        mykmeanssp.hnsw_wam(points, M=1)
+    with pytest.raises(ValueError):
+        mykmeanssp.hnsw_wam(points, ef_search=0)
+
+
+def test_radius_wam_matches_brute_force():
+    rng = np.random.default_rng(0)
+    for points, radius in (
+        (rng.uniform(0, 10, size=(300, 2)), 1.5),
+        (rng.uniform(0, 3, size=(300, 5)), 2.0),
+        (np.repeat(rng.normal(size=(40, 3)), 3, 0), 0.5),
+    ):
+        indptr, indices, values, dropped_mass, laplacian_error = mykmeanssp.radius_wam(
+            points, radius, threads=2
+        )
+        wam = csr_to_dense(indptr, indices, np.asarray(values))
+        indptr, indices = np.asarray(indptr), np.asarray(indices)
+        for i in range(len(points)):
+            row = indices[indptr[i] : indptr[i + 1]]
+            assert np.all(np.diff(row) > 0)
+
+        squared_distances = ((points[:, None, :] - points) ** 2).sum(axis=2)
+        dense_wam = np.exp(-squared_distances / 2)
+        np.fill_diagonal(dense_wam, 0)
+        near = squared_distances <= radius**2
+        np.fill_diagonal(near, False)
+        assert np.all((wam > 0) == near)
+        np.testing.assert_allclose(wam[near], dense_wam[near])
+
+        dropped = dense_wam - wam
+        assert dropped.sum() <= dropped_mass
+        eigenvalues = np.linalg.eigvalsh(np.diag(wam.sum(axis=1)) - wam)
+        dense_eigenvalues = np.linalg.eigvalsh(
+            np.diag(dense_wam.sum(axis=1)) - dense_wam
+        )
+        assert np.abs(eigenvalues - dense_eigenvalues).max() <= laplacian_error + 1e-9
+
+    with pytest.raises(ValueError):
+        mykmeanssp.radius_wam(points, 0)
+
+
+def test_knn_graph_spk():
+    for i in range(1, TESTS_COUNT + 1):
+        our_mat = np.array(
+            read_matrix_from_file(
+                str(Path(__file__).parent.joinpath(f"testfiles/test{i}.txt"))
+            )
+        )
+        # A graph of all the other datapoints as neighbors is the dense graph
+        new_points, k = mykmeanssp.spk(our_mat, graph="knn", neighbors=len(our_mat))
+        expected_points, expected_k = mykmeanssp.spk(our_mat)
+        assert k == expected_k
+        np.testing.assert_array_equal(
+            np.asarray(new_points), np.asarray(expected_points)
+        )
+
+        # Searches as wide as the whole index find every other datapoint
+        new_points, k = mykmeanssp.spk(our_mat, graph="hnsw", neighbors=len(our_mat))
+        assert k == expected_k
+        np.testing.assert_array_equal(
+            np.asarray(new_points), np.asarray(expected_points)
+        )
+
+        # A radius beyond every distance keeps all of the dense graph's weights
+        new_points, k = mykmeanssp.spk(our_mat, graph="radius", radius=1e6)
+        assert k == expected_k
+        np.testing.assert_array_equal(
+            np.asarray(new_points), np.asarray(expected_points)
+        )
+
+        result = mykmeanssp.spkmeans(our_mat, 2, graph="knn", neighbors=3)
+        assert np.asarray(result.labels).shape == (len(our_mat),)
+
+    with pytest.raises(ValueError):
+        mykmeanssp.spk(our_mat, graph="grid")
+    with pytest.raises(ValueError):
+        mykmeanssp.spk(our_mat, graph="knn", neighbors=0)
+
+
+def test_lanczos_spk_matches_eigh():
+    rng = np.random.default_rng(0)
+    centers = 8 * np.vstack([np.zeros(3), np.eye(3)])
+    points = np.concatenate([center + rng.normal(size=(100, 3)) for center in centers])
+    indptr, indices, values = mykmeanssp.knn_wam(points, 10)
+    wam = csr_to_dense(indptr, indices, np.asarray(values))
+    eigenvalues, eigenvectors = np.linalg.eigh(np.diag(wam.sum(axis=1)) - wam)
+
+    # Eigenvectors of a repeated eigenvalue are only unique up to their span
+    new_points, k = mykmeanssp.spk(
+        points, 4, graph="knn", neighbors=10, eigensolver="lanczos"
+    )
+    new_points = np.asarray(new_points)
+    expected = eigenvectors[:, :4]
+    np.testing.assert_allclose(
+        new_points.T @ new_points, expected @ expected.T, atol=1e-8
+    )
+    # The eigengap heuristic only looks at the first eigenvalues it found
+    expected_k = np.diff(eigenvalues[:32]).argmax() + 1
+    assert mykmeanssp.spk(points, graph="knn", eigensolver="lanczos")[1] == expected_k
+
+    with pytest.raises(ValueError):
+        mykmeanssp.spk(points, eigensolver="lanczos")
+    with pytest.raises(ValueError):
+        mykmeanssp.spk(points, graph="knn", eigensolver="arpack")
+
+
+def test_nystrom_spk_matches_eigh():
+    points = four_blobs()
+    # The Nystrom engine embeds with the random-walk Laplacian of the dense
+    # graph with self loops, I - D^-1 (W + I)
+    affinities = np.exp(-((points[:, None, :] - points) ** 2).sum(axis=2) / 2)
+    degrees = affinities.sum(axis=1)
+    eigenvalues, eigenvectors = np.linalg.eigh(
+        affinities / np.sqrt(degrees[:, None] * degrees[None, :])
+    )
+    expected = eigenvectors[:, ::-1][:, :4] / np.sqrt(degrees)[:, None]
+    expected_projector = expected @ np.linalg.pinv(expected)
+
+    # All the datapoints as landmarks make the approximation exact
+    for landmarks, sampling, tolerance in (
+        (len(points), "uniform", 1e-8),
+        (40, "uniform", 0.05),
+        (40, "kmeans++", 0.05),
+    ):
+        new_points, _ = mykmeanssp.spk(
+            points, 4, engine="nystrom", landmarks=landmarks, sampling=sampling
+        )
+        basis, _ = np.linalg.qr(np.asarray(new_points).T)
+        np.testing.assert_allclose(basis @ basis.T, expected_projector, atol=tolerance)
+
+    expected_k = np.diff(1 - eigenvalues[::-1][:32]).argmax() + 1
+    _, k = mykmeanssp.spk(points, engine="nystrom", landmarks=len(points))
+    assert k == expected_k
+
+    result = mykmeanssp.spkmeans(points, 4, engine="nystrom", landmarks=20)
+    labels = np.asarray(result.labels).reshape(4, 40)
+    majorities = [np.bincount(blob_labels).argmax() for blob_labels in labels]
+    assert len(set(majorities)) == 4
+    assert (labels == np.array(majorities)[:, None]).mean() > 0.9
+
+    with pytest.raises(ValueError):
+        mykmeanssp.spk(points, engine="nystrom", landmarks=0)
+    with pytest.raises(ValueError):
+        mykmeanssp.spk(points, engine="nystrom", sampling="random")
+    with pytest.raises(ValueError):
+        mykmeanssp.spk(points, engine="spectral")
+
+
+def test_lsc_spk_matches_svd():
+    points = four_blobs()
+    # With all the datapoints as landmarks, K-means leaves them in place, so
+    # the codes are the gaussian affinities to the nearest datapoints
+    squared_distances = ((points[:, None, :] - points) ** 2).sum(axis=2)
+    nearest = np.argsort(squared_distances, axis=1)[:, :5]
+    rows = np.arange(len(points))[:, None]
+    codes = np.zeros_like(squared_distances)
+    codes[rows, nearest] = np.exp(-squared_distances[rows, nearest] / 2)
+    codes /= codes.sum(axis=1, keepdims=True)
+    codes /= np.sqrt(codes.sum(axis=0))
+    left_vectors, singular_values, _ = np.linalg.svd(codes)
+    expected = left_vectors[:, :4]
+
+    new_points, _ = mykmeanssp.spk(
+        points, 4, engine="lsc", landmarks=len(points), nearest_landmarks=5
+    )
+    basis, _ = np.linalg.qr(np.asarray(new_points).T)
+    np.testing.assert_allclose(basis @ basis.T, expected @ expected.T, atol=1e-8)
+
+    expected_k = np.diff(1 - singular_values[:32] ** 2).argmax() + 1
+    _, k = mykmeanssp.spk(points, engine="lsc", landmarks=len(points))
+    assert k == expected_k
+
+    result = mykmeanssp.spkmeans(points, 4, engine="lsc", landmarks=20)
+    labels = np.asarray(result.labels).reshape(4, 40)
+    majorities = [np.bincount(blob_labels).argmax() for blob_labels in labels]
+    assert len(set(majorities)) == 4
+    assert (labels == np.array(majorities)[:, None]).mean() > 0.9
+
+    with pytest.raises(ValueError):
+        mykmeanssp.spk(points, engine="lsc", nearest_landmarks=0)
+
+
+def test_rff_spk_matches_eigh():
+    points = four_blobs(spread=0.5)
+
+    def laplacian_projector(affinities):
+        np.fill_diagonal(affinities, 0)
+        eigenvalues, eigenvectors = np.linalg.eigh(
+            np.diag(affinities.sum(axis=1)) - affinities
+        )
+        return eigenvalues, eigenvectors[:, :4] @ eigenvectors[:, :4].T
+
+    def rff_projector(**kwargs):
+        new_points, _ = mykmeanssp.spk(points, 4, engine="rff", **kwargs)
+        basis, _ = np.linalg.qr(np.asarray(new_points).T)
+        return basis @ basis.T
+
+    # The features are drawn in the order of NumPy's legacy generator
+    np.random.seed(0)
+    frequencies = np.random.standard_normal((500, 3))
+    offsets = 2 * np.pi * np.random.random_sample(500)
+    features = np.sqrt(2 / 500) * np.cos(points @ frequencies.T + offsets)
+    _, expected_projector = laplacian_projector(features @ features.T)
+    np.testing.assert_allclose(
+        rff_projector(features=500), expected_projector, atol=1e-8
+    )
+
+    # More features approximate the dense graph better
+    eigenvalues, expected_projector = laplacian_projector(
+        np.exp(-((points[:, None, :] - points) ** 2).sum(axis=2) / 2)
+    )
+    np.testing.assert_allclose(
+        rff_projector(features=8000), expected_projector, atol=0.02
+    )
+
+    expected_k = np.diff(eigenvalues[:32]).argmax() + 1
+    _, k = mykmeanssp.spk(points, engine="rff", features=2000)
+    assert k == expected_k
+
+    result = mykmeanssp.spkmeans(points, 4, engine="rff")
+    labels = np.asarray(result.labels).reshape(4, 40)
+    majorities = [np.bincount(blob_labels).argmax() for blob_labels in labels]
+    assert len(set(majorities)) == 4
+    assert (labels == np.array(majorities)[:, None]).mean() > 0.9
+
+    with pytest.raises(ValueError):
+        mykmeanssp.spk(points, engine="rff", features=0)
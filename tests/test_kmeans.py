@@ -0,0 +1,158 @@
+from concurrent.futures import ThreadPoolExecutor
+
+import numpy as np
+import pytest
+
+import mykmeanssp
+
+
+def make_blobs(n: int, m: int, centers_count: int, seed: int) -> np.ndarray:
+    rng = np.random.default_rng(seed)
+    centers = rng.uniform(-20, 20, size=(centers_count, m))
+    return centers[rng.integers(centers_count, size=n)] + rng.normal(size=(n, m))
+
+
+@pytest.mark.parametrize("algorithm", ["elkan", "hamerly", "yinyang", "auto"])
+@pytest.mark.parametrize(
+    "n, m, k", [(100, 2, 3), (1000, 5, 10), (2000, 10, 25), (3000, 3, 60)]
+)
+def test_fit_bounded_engines_match_lloyd(algorithm: str, n: int, m: int, k: int):
+    points = make_blobs(n, m, k, n)
+    idxs = mykmeanssp.kmeanspp_init(points.tolist(), k, 0)
+    centroids = points[idxs].tolist()
+
+    lloyd = mykmeanssp.fit(centroids, points.tolist(), k, 100, 0.0)
+    other = mykmeanssp.fit(centroids, points.tolist(), k, 100, 0.0, algorithm=algorithm)
+    assert lloyd.centroids == other.centroids
+    assert np.array_equal(np.asarray(lloyd.labels), np.asarray(other.labels))
+    assert lloyd.cluster_sizes == other.cluster_sizes
+    assert lloyd.inertia == other.inertia
+
+
+def test_fit_unknown_algorithm():
+    with pytest.raises(ValueError):
+        mykmeanssp.fit([[0.0]], [[0.0], [1.0]], 1, algorithm="unknown")
+
+
+def test_fit_minibatch():
+    points = make_blobs(5000, 4, 8, 3)
+    idxs = mykmeanssp.kmeans_parallel_init(points.tolist(), 8, 0)
+    centroids = points[idxs].tolist()
+
+    def inertia(result) -> float:
+        distances = np.linalg.norm(points[:, None, :] - np.array(result), axis=2)
+        return float(np.sum(np.min(distances, axis=1) ** 2))
+
+    full = mykmeanssp.fit(centroids, points.tolist(), 8, 100, 0.0).centroids
+    minibatch = mykmeanssp.fit(
+        centroids, points.tolist(), 8, 100, 0.0, batch_size=256, seed=1
+    ).centroids
+    assert minibatch != full
+    assert inertia(minibatch) < 1.05 * inertia(full)
+    assert (
+        minibatch
+        == mykmeanssp.fit(
+            centroids, points.tolist(), 8, 100, 0.0, batch_size=256, seed=1
+        ).centroids
+    )
+
+
+@pytest.mark.parametrize("algorithm", ["lloyd", "elkan", "hamerly", "yinyang"])
+def test_fit_does_not_depend_on_threads(algorithm: str):
+    points = make_blobs(20000, 4, 12, 5)
+    idxs = mykmeanssp.kmeanspp_init(points.tolist(), 12, 0)
+    centroids = points[idxs].tolist()
+
+    single = mykmeanssp.fit(
+        centroids, points.tolist(), 12, 50, 0.0, algorithm=algorithm, threads=1
+    )
+    for threads in (2, 3, 4, 8):
+        other = mykmeanssp.fit(
+            centroids,
+            points.tolist(),
+            12,
+            50,
+            0.0,
+            algorithm=algorithm,
+            threads=threads,
+        )
+        assert single.centroids == other.centroids
+        assert bytes(single.labels) == bytes(other.labels)
+        assert single.inertia == other.inertia
+
+
+def test_fit_result():
+    points = make_blobs(2000, 3, 5, 11)
+    idxs = mykmeanssp.kmeanspp_init(points.tolist(), 5, 0)
+    result = mykmeanssp.fit(points[idxs].tolist(), points.tolist(), 5, 300, 1e-9)
+
+    labels = np.asarray(result.labels)
+    centroids = np.array(result.centroids)
+    assert isinstance(result.labels, mykmeanssp.Buffer)
+    assert labels.shape == (2000,)
+    assert np.shares_memory(labels, np.asarray(result.labels))
+    assert result.converged
+    assert 0 < result.iterations < 300
+    assert np.array_equal(
+        labels,
+        np.argmin(np.linalg.norm(points[:, None, :] - centroids, axis=2), axis=1),
+    )
+    assert result.cluster_sizes == np.bincount(labels, minlength=5).tolist()
+    assert result.inertia == pytest.approx(np.sum((points - centroids[labels]) ** 2))
+
+    capped = mykmeanssp.fit(points[idxs].tolist(), points.tolist(), 5, 1, 0.0)
+    assert capped.iterations == 1
+    assert not capped.converged
+
+
+def test_fit_multi_first_restart_matches_fit():
+    points = make_blobs(3000, 3, 10, 7)
+    idxs = mykmeanssp.kmeanspp_init(points.tolist(), 10, 4, numpy_compatible=True)
+    single = mykmeanssp.fit(
+        points[idxs].tolist(), points.tolist(), 10, 100, 0.0
+    ).centroids
+
+    centroids, multi_idxs, inertias = mykmeanssp.fit_multi(
+        points.tolist(), 10, 1, 100, 0.0, seed=4, numpy_compatible=True
+    )
+    assert centroids == single
+    assert multi_idxs == idxs
+    assert len(inertias) == 1
+
+
+def test_fit_multi_keeps_lowest_inertia():
+    points = make_blobs(3000, 3, 10, 7)
+    centroids, idxs, inertias = mykmeanssp.fit_multi(points.tolist(), 10, 8, seed=1)
+
+    distances = np.linalg.norm(points[:, None, :] - np.array(centroids), axis=2)
+    assert len(inertias) == 8
+    assert min(inertias) == pytest.approx(np.sum(np.min(distances, axis=1) ** 2))
+    assert (centroids, idxs, inertias) == mykmeanssp.fit_multi(
+        points.tolist(), 10, 8, seed=1, threads=1
+    )
+    restart = int(np.argmin(inertias))
+    result = mykmeanssp.fit(points[idxs].tolist(), points.tolist(), 10, 300, 0.0)
+    assert centroids == result.centroids
+    assert min(inertias) == result.inertia
+    assert idxs == mykmeanssp.kmeanspp_init(points.tolist(), 10, 1 + restart)
+
+
+def test_fit_multi_invalid_restarts():
+    with pytest.raises(ValueError):
+        mykmeanssp.fit_multi([[0.0], [1.0]], 1, 0)
+
+
+def test_concurrent_calls_match_serial():
+    points = make_blobs(4000, 4, 6, 9)
+    idxs = mykmeanssp.kmeanspp_init(points, 6, 0)
+    centroids = points[idxs]
+
+    def run(_) -> tuple:
+        result = mykmeanssp.fit(centroids, points, 6, 100, 0.0, algorithm="hamerly")
+        wam = np.asarray(mykmeanssp.wam(points[:300]))
+        return result.centroids, bytes(result.labels), wam.tobytes()
+
+    expected = run(None)
+    with ThreadPoolExecutor(max_workers=4) as executor:
+        results = list(executor.map(run, range(8)))
+    assert all(result == expected for result in results)
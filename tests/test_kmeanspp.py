@@ -0,0 +1,90 @@
+from typing import List
+
+import numpy as np
+import pytest
+
+import mykmeanssp
+
+
+def numpy_kmeanspp_idxs(points: np.ndarray, k: int, seed: int) -> List[int]:
+    np.random.seed(seed)
+    N = points.shape[0]
+    centroids_idxs = [np.random.choice(N)]
+
+    for _ in range(1, k):
+        dx_arr = np.min(
+            np.linalg.norm(points[:, None, :] - points[centroids_idxs], axis=2),
+            axis=1,
+        )
+        centroids_idxs.append(np.random.choice(N, p=dx_arr / np.sum(dx_arr)))
+
+    return [int(idx) for idx in centroids_idxs]
+
+
+@pytest.mark.parametrize(
+    "n, m, k, seed", [(10, 2, 3, 0), (200, 5, 8, 1), (500, 3, 20, 7)]
+)
+def test_kmeanspp_init_numpy_compatible(n: int, m: int, k: int, seed: int):
+    points = np.random.default_rng(seed).normal(size=(n, m))
+
+    our_idxs = mykmeanssp.kmeanspp_init(points.tolist(), k, seed, numpy_compatible=True)
+    assert our_idxs == numpy_kmeanspp_idxs(points, k, seed)
+
+
+def test_kmeanspp_init_standard():
+    points = np.random.default_rng(0).normal(size=(300, 4))
+
+    idxs = mykmeanssp.kmeanspp_init(points.tolist(), 10, 3)
+    assert len(set(idxs)) == 10
+    assert idxs == mykmeanssp.kmeanspp_init(points.tolist(), 10, 3)
+
+
+def test_kmeanspp_init_invalid_k():
+    with pytest.raises(ValueError):
+        mykmeanssp.kmeanspp_init([[1.0], [2.0]], 3)
+
+
+@pytest.mark.parametrize("n, m, k", [(5, 2, 5), (300, 3, 4), (2000, 4, 30)])
+def test_kmeans_parallel_init(n: int, m: int, k: int):
+    points = np.random.default_rng(n).normal(size=(n, m))
+
+    idxs = mykmeanssp.kmeans_parallel_init(points.tolist(), k, 5)
+    assert len(idxs) == k
+    assert all(0 <= idx < n for idx in idxs)
+    assert idxs == mykmeanssp.kmeans_parallel_init(points.tolist(), k, 5)
+
+
+def test_kmeans_parallel_init_threads():
+    points = np.random.default_rng(0).normal(size=(5000, 3)).tolist()
+
+    idxs = mykmeanssp.kmeans_parallel_init(points, 20, 3, threads=1)
+    for threads in (2, 3, 0):
+        assert idxs == mykmeanssp.kmeans_parallel_init(points, 20, 3, threads=threads)
+    with pytest.raises(ValueError):
+        mykmeanssp.kmeans_parallel_init(points, 20, threads=-1)
+
+
+def test_kmeans_parallel_init_completes_few_candidates():
+    points = np.random.default_rng(0).normal(size=(300, 3)).tolist()
+    for seed in range(5):
+        idxs = mykmeanssp.kmeans_parallel_init(
+            points, 30, seed, rounds=1, oversampling_factor=1.0
+        )
+        assert len(set(idxs)) == 30
+
+    # Only 5 distinct vectors, so the indices are distinct but the vectors not
+    repeated = (np.arange(40) % 5)[:, None].astype(float).tolist()
+    idxs = mykmeanssp.kmeans_parallel_init(
+        repeated, 8, 0, rounds=1, oversampling_factor=1.0
+    )
+    assert len(set(idxs)) == 8
+    assert {repeated[idx][0] for idx in idxs} == {0.0, 1.0, 2.0, 3.0, 4.0}
+
+
+def test_kmeans_parallel_init_separated_blobs():
+    rng = np.random.default_rng(0)
+    centers = np.array([[0.0, 0.0], [50.0, 0.0], [0.0, 50.0], [50.0, 50.0]])
+    points = np.concatenate([c + rng.normal(size=(100, 2)) for c in centers])
+
+    idxs = mykmeanssp.kmeans_parallel_init(points.tolist(), 4, 0, rounds=3)
+    assert sorted(idx // 100 for idx in idxs) == [0, 1, 2, 3]